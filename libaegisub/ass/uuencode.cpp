@@ -17,69 +17,146 @@
 #include <libaegisub/ass/uuencode.h>
 
 #include <algorithm>
+#include <cstring>
 
 // Despite being called uuencoding by ass_specs.doc, the format is actually
 // somewhat different from real uuencoding.  Each 3-byte chunk is split into 4
 // 6-bit pieces, then 33 is added to each piece. Lines are wrapped after 80
 // characters, and files with non-multiple-of-three lengths are padded with
 // zero.
+//
+// Both directions work on as many whole 3-byte/4-character groups at a time
+// as possible, writing directly into the output with no per-character
+// checks, and only fall back to going a character at a time for groups which
+// are split up by line breaks or are at the end of the data.
+
+namespace {
+inline void encode_group(const unsigned char *src, char *dst) {
+	dst[0] = static_cast<char>((src[0] >> 2) + 33);
+	dst[1] = static_cast<char>((((src[0] & 0x3) << 4) | (src[1] >> 4)) + 33);
+	dst[2] = static_cast<char>((((src[1] & 0xF) << 2) | (src[2] >> 6)) + 33);
+	dst[3] = static_cast<char>((src[2] & 0x3F) + 33);
+}
+
+inline void decode_group(const unsigned char *src, char *dst) {
+	unsigned char a = src[0] - 33, b = src[1] - 33, c = src[2] - 33, d = src[3] - 33;
+	dst[0] = static_cast<char>((a << 2) | (b >> 4));
+	dst[1] = static_cast<char>(((b & 0xF) << 4) | (c >> 2));
+	dst[2] = static_cast<char>(((c & 0x3) << 6) | d);
+}
+
+inline bool is_skipped(char c) {
+	return !c || c == '\n' || c == '\r';
+}
+}
 
 namespace agi { namespace ass {
 
 std::string UUEncode(const char *begin, const char *end, bool insert_linebreaks) {
-	size_t size = std::distance(begin, end);
 	std::string ret;
-	ret.reserve((size * 4 + 2) / 3 + size / 80 * 2);
+	UUEncode(begin, end, ret, insert_linebreaks);
+	return ret;
+}
 
+void UUEncode(const char *begin, const char *end, std::string &out, bool insert_linebreaks) {
+	auto src = reinterpret_cast<const unsigned char *>(begin);
+	size_t size = std::distance(begin, end);
+	out.reserve(out.size() + (size * 4 + 2) / 3 + size / 60 * 2);
+
+	const size_t line_length = 80;
 	size_t written = 0;
-	for (size_t pos = 0; pos < size; pos += 3) {
-		unsigned char src[3] = { '\0', '\0', '\0' };
-		memcpy(src, begin + pos, std::min<size_t>(3u, size - pos));
+	if (insert_linebreaks) {
+		auto last_line = out.rfind('\n');
+		written = (last_line == out.npos ? out.size() : out.size() - last_line - 1) % line_length;
+		// A full line counts as a line which is done, but which the next
+		// character needs a line break before
+		if (written == 0 && !out.empty() && out.back() != '\n')
+			written = line_length;
+	}
 
-		unsigned char dst[4] = {
-			static_cast<unsigned char>(src[0] >> 2),
-			static_cast<unsigned char>(((src[0] & 0x3) << 4) | ((src[1] & 0xF0) >> 4)),
-			static_cast<unsigned char>(((src[1] & 0xF) << 2) | ((src[2] & 0xC0) >> 6)),
-			static_cast<unsigned char>(src[2] & 0x3F)
-		};
+	size_t pos = 0;
+	while (pos < size) {
+		if (insert_linebreaks && written == line_length) {
+			out += "\r\n";
+			written = 0;
+		}
 
-		for (size_t i = 0; i < std::min<size_t>(size - pos + 1, 4u); ++i) {
-			ret += dst[i] + 33;
+		// Whole groups which fit on the current line
+		size_t groups = (size - pos) / 3;
+		if (insert_linebreaks)
+			groups = std::min(groups, (line_length - written) / 4);
+		if (groups) {
+			size_t old_size = out.size();
+			out.resize(old_size + groups * 4);
+			char *dst = &out[old_size];
+			for (size_t i = 0; i < groups; ++i)
+				encode_group(src + pos + i * 3, dst + i * 4);
+			pos += groups * 3;
+			written += groups * 4;
+			continue;
+		}
 
-			if (insert_linebreaks && ++written == 80 && pos + 3 < size) {
+		// The final partial group, or a group split by a line break
+		unsigned char group_src[3] = { '\0', '\0', '\0' };
+		memcpy(group_src, src + pos, std::min<size_t>(3u, size - pos));
+		char dst[4];
+		encode_group(group_src, dst);
+		for (size_t i = 0; i < std::min<size_t>(size - pos + 1, 4u); ++i) {
+			if (insert_linebreaks && written == line_length) {
+				out += "\r\n";
 				written = 0;
-				ret += "\r\n";
 			}
+			out += dst[i];
+			++written;
 		}
+		pos += 3;
 	}
-
-	return ret;
 }
 
 std::vector<char> UUDecode(const char *begin, const char *end) {
 	std::vector<char> ret;
+	UUDecode(begin, end, ret);
+	return ret;
+}
+
+void UUDecode(const char *begin, const char *end, std::vector<char> &out) {
+	auto src = reinterpret_cast<const unsigned char *>(begin);
 	size_t len = end - begin;
-	ret.reserve(len * 3 / 4);
+	out.reserve(out.size() + len * 3 / 4);
 
 	for (size_t pos = 0; pos + 1 < len; ) {
+		// Whole groups up to the next line break
+		size_t run = 0;
+		while (pos + run < len && !is_skipped(begin[pos + run]))
+			++run;
+		size_t groups = run / 4;
+		if (groups) {
+			size_t old_size = out.size();
+			out.resize(old_size + groups * 3);
+			char *dst = &out[old_size];
+			for (size_t i = 0; i < groups; ++i)
+				decode_group(src + pos + i * 4, dst + i * 3);
+			pos += groups * 4;
+			continue;
+		}
+
+		// A group split by a line break, or the final partial group
 		size_t bytes = 0;
-		unsigned char src[4] = { '\0', '\0', '\0', '\0' };
+		unsigned char group[4] = { '\0', '\0', '\0', '\0' };
 		for (size_t i = 0; i < 4 && pos < len; ++pos) {
 			char c = begin[pos];
-			if (c && c != '\n' && c != '\r') {
-				src[i++] = c - 33;
+			if (!is_skipped(c)) {
+				group[i++] = c - 33;
 				++bytes;
 			}
 		}
 
 		if (bytes > 1)
-			ret.push_back((src[0] << 2) | (src[1] >> 4));
+			out.push_back((group[0] << 2) | (group[1] >> 4));
 		if (bytes > 2)
-			ret.push_back(((src[1] & 0xF) << 4) | (src[2] >> 2));
+			out.push_back(((group[1] & 0xF) << 4) | (group[2] >> 2));
 		if (bytes > 3)
-			ret.push_back(((src[2] & 0x3) << 6) | (src[3]));
+			out.push_back(((group[2] & 0x3) << 6) | (group[3]));
 	}
-
-	return ret;
 }
 } }
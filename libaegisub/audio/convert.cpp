@@ -0,0 +1,454 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "convert.h"
+
+#include <libaegisub/cpu.h>
+
+#include <cstring>
+
+#ifdef AGI_CPU_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// The SIMD versions of each kernel process as many whole vectors as they can
+// and then hand the remainder off to the scalar version.
+
+namespace {
+// Scalar versions
+
+void u8_scalar(const uint8_t *src, int16_t *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i)
+		dst[i] = static_cast<int16_t>((src[i] - 128) * 256);
+}
+
+const float int_scale = 1.f / 2147483648.f;
+
+void int_scalar(const uint8_t *src, int bytes_per_sample, float *dst, size_t count) {
+	if (bytes_per_sample == 3) {
+		for (size_t i = 0; i < count; ++i, src += 3) {
+			auto sample = uint32_t(src[0]) << 8 | uint32_t(src[1]) << 16 | uint32_t(src[2]) << 24;
+			dst[i] = static_cast<float>(static_cast<int32_t>(sample)) * int_scale;
+		}
+		return;
+	}
+
+	// Only the most significant four bytes can affect the result, so treat
+	// everything as a 32-bit sample
+	for (size_t i = 0; i < count; ++i, src += bytes_per_sample) {
+		uint32_t sample = 0;
+		for (int j = 0; j < 4 && j < bytes_per_sample; ++j)
+			sample |= uint32_t(src[bytes_per_sample - 1 - j]) << (24 - 8 * j);
+		dst[i] = static_cast<float>(static_cast<int32_t>(sample)) * int_scale;
+	}
+}
+
+void double_to_float_scalar(const double *src, float *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i)
+		dst[i] = static_cast<float>(src[i]);
+}
+
+template<typename Source>
+int16_t to_s16(Source sample) {
+	Source expanded = sample < 0 ? sample * 32768 : sample * 32767;
+	return expanded <= -32768 ? -32768 :
+	       expanded >= 32767 ? 32767 :
+	                           static_cast<int16_t>(expanded);
+}
+
+template<typename Source>
+void float_scalar(const Source *src, int16_t *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i)
+		dst[i] = to_s16(src[i]);
+}
+
+template<typename Source>
+void downmix_float_scalar(const Source *src, int channels, int16_t *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i, src += channels) {
+		Source sum = 0;
+		for (int c = 0; c < channels; ++c)
+			sum += src[c];
+		dst[i] = to_s16(sum / channels);
+	}
+}
+
+void downmix_scalar(const int16_t *src, int channels, int16_t *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i, src += channels) {
+		int sum = 0;
+		for (int c = 0; c < channels; ++c)
+			sum += src[c];
+		dst[i] = static_cast<int16_t>(sum / channels);
+	}
+}
+
+void upsample_scalar(const int16_t *src, int16_t *dst, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		dst[i * 2] = src[i];
+		dst[i * 2 + 1] = static_cast<int16_t>(((int32_t)src[i] + src[i + 1]) / 2);
+	}
+}
+
+#ifdef AGI_CPU_X86
+// SSE2 versions
+
+AGI_TARGET("sse2")
+void u8_sse2(const uint8_t *src, int16_t *dst, size_t count) {
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		// x ^ 0x80 is x - 128 as a signed byte, which then just needs to be
+		// moved to the high byte
+		__m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), bias);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(zero, v));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(zero, v));
+	}
+	u8_scalar(src + i, dst + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void int_sse2(const uint8_t *src, int bytes_per_sample, float *dst, size_t count) {
+	const __m128 scale = _mm_set1_ps(int_scale);
+	size_t i = 0;
+	if (bytes_per_sample == 4) {
+		for (; i + 4 <= count; i += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+		}
+	}
+	int_scalar(src + i * bytes_per_sample, bytes_per_sample, dst + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void double_to_float_sse2(const double *src, float *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 a = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+		__m128 b = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+		_mm_storeu_ps(dst + i, _mm_movelh_ps(a, b));
+	}
+	double_to_float_scalar(src + i, dst + i, count - i);
+}
+
+/// Scale, clamp and truncate four floats to 32-bit ints
+AGI_TARGET("sse2")
+inline __m128i to_s16_sse2(__m128 v) {
+	const __m128 neg = _mm_cmplt_ps(v, _mm_setzero_ps());
+	const __m128 scale = _mm_or_ps(_mm_and_ps(neg, _mm_set1_ps(32768.f)), _mm_andnot_ps(neg, _mm_set1_ps(32767.f)));
+	v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v, scale), _mm_set1_ps(-32768.f)), _mm_set1_ps(32767.f));
+	return _mm_cvttps_epi32(v);
+}
+
+AGI_TARGET("sse2")
+void float_sse2(const float *src, int16_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = to_s16_sse2(_mm_loadu_ps(src + i));
+		__m128i b = to_s16_sse2(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+	}
+	float_scalar(src + i, dst + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void double_sse2(const double *src, int16_t *dst, size_t count) {
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d neg_scale = _mm_set1_pd(32768.);
+	const __m128d pos_scale = _mm_set1_pd(32767.);
+	const __m128d lo = _mm_set1_pd(-32768.);
+	const __m128d hi = _mm_set1_pd(32767.);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i out[4];
+		for (int j = 0; j < 4; ++j) {
+			__m128d v = _mm_loadu_pd(src + i + j * 2);
+			__m128d neg = _mm_cmplt_pd(v, zero);
+			__m128d scale = _mm_or_pd(_mm_and_pd(neg, neg_scale), _mm_andnot_pd(neg, pos_scale));
+			v = _mm_min_pd(_mm_max_pd(_mm_mul_pd(v, scale), lo), hi);
+			out[j] = _mm_cvttpd_epi32(v); // Converted values are in the low half
+		}
+		__m128i a = _mm_unpacklo_epi64(out[0], out[1]);
+		__m128i b = _mm_unpacklo_epi64(out[2], out[3]);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+	}
+	float_scalar(src + i, dst + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void downmix_sse2(const int16_t *src, int channels, int16_t *dst, size_t count) {
+	size_t i = 0;
+	if (channels == 2) {
+		const __m128i ones = _mm_set1_epi16(1);
+		for (; i + 8 <= count; i += 8) {
+			__m128i a = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2)), ones);
+			__m128i b = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 8)), ones);
+			// Add one to negative sums so that the shift rounds towards zero
+			a = _mm_srai_epi32(_mm_add_epi32(a, _mm_srli_epi32(a, 31)), 1);
+			b = _mm_srai_epi32(_mm_add_epi32(b, _mm_srli_epi32(b, 31)), 1);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+		}
+	}
+	downmix_scalar(src + i * channels, channels, dst + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void downmix_float_sse2(const float *src, int channels, int16_t *dst, size_t count) {
+	if (channels != 2)
+		return downmix_float_scalar(src, channels, dst, count);
+
+	const __m128 half = _mm_set1_ps(.5f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i out[2];
+		for (int j = 0; j < 2; ++j) {
+			__m128 a = _mm_loadu_ps(src + (i + j * 4) * 2);
+			__m128 b = _mm_loadu_ps(src + (i + j * 4) * 2 + 4);
+			__m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+			out[j] = to_s16_sse2(_mm_mul_ps(_mm_add_ps(left, right), half));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(out[0], out[1]));
+	}
+	downmix_float_scalar(src + i * 2, 2, dst + i, count - i);
+}
+
+AGI_TARGET("sse2")
+void upsample_sse2(const int16_t *src, int16_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 1));
+
+		// Widen to 32 bits to sum without overflow
+		__m128i sum_lo = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16), _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16));
+		__m128i sum_hi = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16), _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16));
+		sum_lo = _mm_srai_epi32(_mm_add_epi32(sum_lo, _mm_srli_epi32(sum_lo, 31)), 1);
+		sum_hi = _mm_srai_epi32(_mm_add_epi32(sum_hi, _mm_srli_epi32(sum_hi, 31)), 1);
+		__m128i avg = _mm_packs_epi32(sum_lo, sum_hi);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), _mm_unpacklo_epi16(a, avg));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2 + 8), _mm_unpackhi_epi16(a, avg));
+	}
+	upsample_scalar(src + i, dst + i * 2, count - i);
+}
+
+// AVX2 versions
+
+AGI_TARGET("avx2")
+void u8_avx2(const uint8_t *src, int16_t *dst, size_t count) {
+	const __m128i bias = _mm_set1_epi8((char)0x80);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), bias);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_slli_epi16(_mm256_cvtepi8_epi16(v), 8));
+	}
+	u8_scalar(src + i, dst + i, count - i);
+}
+
+AGI_TARGET("avx2")
+void int_avx2(const uint8_t *src, int bytes_per_sample, float *dst, size_t count) {
+	const __m256 scale = _mm256_set1_ps(int_scale);
+	size_t i = 0;
+	if (bytes_per_sample == 4) {
+		for (; i + 8 <= count; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+		}
+	}
+	int_scalar(src + i * bytes_per_sample, bytes_per_sample, dst + i, count - i);
+}
+
+/// Scale, clamp and truncate eight floats to 32-bit ints
+AGI_TARGET("avx2")
+inline __m256i to_s16_avx2(__m256 v) {
+	const __m256 scale = _mm256_blendv_ps(_mm256_set1_ps(32767.f), _mm256_set1_ps(32768.f), _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ));
+	v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v, scale), _mm256_set1_ps(-32768.f)), _mm256_set1_ps(32767.f));
+	return _mm256_cvttps_epi32(v);
+}
+
+AGI_TARGET("avx2")
+void float_avx2(const float *src, int16_t *dst, size_t count) {
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i a = to_s16_avx2(_mm256_loadu_ps(src + i));
+		__m256i b = to_s16_avx2(_mm256_loadu_ps(src + i + 8));
+		// packs works within each 128-bit lane, so put the quarters back in order
+		__m256i packed = _mm256_packs_epi32(a, b);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+	float_scalar(src + i, dst + i, count - i);
+}
+
+AGI_TARGET("avx2")
+void downmix_avx2(const int16_t *src, int channels, int16_t *dst, size_t count) {
+	size_t i = 0;
+	if (channels == 2) {
+		const __m256i ones = _mm256_set1_epi16(1);
+		for (; i + 16 <= count; i += 16) {
+			__m256i a = _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2)), ones);
+			__m256i b = _mm256_madd_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 2 + 16)), ones);
+			a = _mm256_srai_epi32(_mm256_add_epi32(a, _mm256_srli_epi32(a, 31)), 1);
+			b = _mm256_srai_epi32(_mm256_add_epi32(b, _mm256_srli_epi32(b, 31)), 1);
+			__m256i packed = _mm256_packs_epi32(a, b);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+		}
+	}
+	downmix_scalar(src + i * channels, channels, dst + i, count - i);
+}
+
+AGI_TARGET("avx2")
+void downmix_float_avx2(const float *src, int channels, int16_t *dst, size_t count) {
+	if (channels != 2)
+		return downmix_float_scalar(src, channels, dst, count);
+
+	const __m256 half = _mm256_set1_ps(.5f);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256i out[2];
+		for (int j = 0; j < 2; ++j) {
+			__m256 a = _mm256_loadu_ps(src + (i + j * 8) * 2);
+			__m256 b = _mm256_loadu_ps(src + (i + j * 8) * 2 + 8);
+			__m256 sum = _mm256_add_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+			                           _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+			// The shuffles work within lanes, leaving the frames in the
+			// order 0 1 4 5 2 3 6 7
+			sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), 0xD8));
+			out[j] = to_s16_avx2(_mm256_mul_ps(sum, half));
+		}
+		__m256i packed = _mm256_packs_epi32(out[0], out[1]);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+	downmix_float_scalar(src + i * 2, 2, dst + i, count - i);
+}
+#endif
+
+/// Pick the best of the available implementations of a kernel
+template<typename Fn>
+Fn select(Fn scalar, Fn sse2, Fn avx2) {
+#ifdef AGI_CPU_X86
+	if (agi::cpu::HasAVX2()) return avx2;
+	if (agi::cpu::HasSSE2()) return sse2;
+#endif
+	return scalar;
+}
+
+#ifdef AGI_CPU_X86
+#define KERNELS(name, sse2, avx2) select(name##_scalar, name##_##sse2, name##_##avx2)
+#else
+#define KERNELS(name, sse2, avx2) name##_scalar
+#endif
+}
+
+namespace agi { namespace audio_convert {
+void U8ToS16(const uint8_t *src, int16_t *dst, size_t count) {
+	static const auto impl = KERNELS(u8, sse2, avx2);
+	impl(src, dst, count);
+}
+
+void IntToFloat(const uint8_t *src, int bytes_per_sample, float *dst, size_t count) {
+	static const auto impl = KERNELS(int, sse2, avx2);
+	impl(src, bytes_per_sample, dst, count);
+}
+
+void DoubleToFloat(const double *src, float *dst, size_t count) {
+	// Not worth an AVX2 version as the conversion is the bottleneck
+	static const auto impl = KERNELS(double_to_float, sse2, sse2);
+	impl(src, dst, count);
+}
+
+void FloatToS16(const float *src, int16_t *dst, size_t count) {
+	static const auto impl = select<void (*)(const float *, int16_t *, size_t)>(
+		float_scalar<float>,
+#ifdef AGI_CPU_X86
+		float_sse2, float_avx2
+#else
+		nullptr, nullptr
+#endif
+	);
+	impl(src, dst, count);
+}
+
+void FloatToS16(const double *src, int16_t *dst, size_t count) {
+	// The SSE2 version is limited by the conversion rather than the vector
+	// width, so there's nothing to gain from an AVX2 version
+	static const auto impl = select<void (*)(const double *, int16_t *, size_t)>(
+		float_scalar<double>,
+#ifdef AGI_CPU_X86
+		double_sse2, double_sse2
+#else
+		nullptr, nullptr
+#endif
+	);
+	impl(src, dst, count);
+}
+
+void Downmix(const int16_t *src, int channels, int16_t *dst, size_t count) {
+	static const auto impl = KERNELS(downmix, sse2, avx2);
+	impl(src, channels, dst, count);
+}
+
+void DownmixToS16(const float *src, int channels, int16_t *dst, size_t count) {
+	static const auto impl = select<void (*)(const float *, int, int16_t *, size_t)>(
+		downmix_float_scalar<float>,
+#ifdef AGI_CPU_X86
+		downmix_float_sse2, downmix_float_avx2
+#else
+		nullptr, nullptr
+#endif
+	);
+	impl(src, channels, dst, count);
+}
+
+void DownmixToS16(const double *src, int channels, int16_t *dst, size_t count) {
+	downmix_float_scalar(src, channels, dst, count);
+}
+
+bool CanConvertToMonoS16(int bytes_per_sample, bool is_float) {
+	return is_float ? bytes_per_sample == sizeof(float) || bytes_per_sample == sizeof(double)
+	                : bytes_per_sample == 2;
+}
+
+bool ToMonoS16(const void *src, int bytes_per_sample, bool is_float, int channels, int16_t *dst, size_t count) {
+	if (!is_float && bytes_per_sample == 2) {
+		if (channels == 1)
+			memcpy(dst, src, count * sizeof(int16_t));
+		else
+			Downmix(static_cast<const int16_t *>(src), channels, dst, count);
+	}
+	else if (is_float && bytes_per_sample == sizeof(float)) {
+		if (channels == 1)
+			FloatToS16(static_cast<const float *>(src), dst, count);
+		else
+			DownmixToS16(static_cast<const float *>(src), channels, dst, count);
+	}
+	else if (is_float && bytes_per_sample == sizeof(double)) {
+		if (channels == 1)
+			FloatToS16(static_cast<const double *>(src), dst, count);
+		else
+			DownmixToS16(static_cast<const double *>(src), channels, dst, count);
+	}
+	else
+		return false;
+	return true;
+}
+
+void DoubleSampleRate(const int16_t *src, int16_t *dst, size_t count) {
+	// Only used for very low sample rate audio, so not worth an AVX2 version
+	static const auto impl = KERNELS(upsample, sse2, sse2);
+	impl(src, dst, count);
+}
+} }
@@ -0,0 +1,68 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+/// @file convert.h
+/// @brief Sample format conversion kernels used by the converting audio providers
+///
+/// Each of these picks the fastest implementation supported by the CPU the
+/// first time it's called, and all of them produce identical results.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace agi { namespace audio_convert {
+	/// Unsigned 8-bit samples with a bias of 128 -> signed 16-bit
+	void U8ToS16(const uint8_t *src, int16_t *dst, size_t count);
+
+	/// Little-endian signed integer samples of 3 to 8 bytes -> float in
+	/// [-1, 1), keeping as much precision as a float can hold
+	void IntToFloat(const uint8_t *src, int bytes_per_sample, float *dst, size_t count);
+
+	/// Double precision samples -> single precision
+	void DoubleToFloat(const double *src, float *dst, size_t count);
+
+	/// Floating point samples in [-1, 1] -> signed 16-bit
+	void FloatToS16(const float *src, int16_t *dst, size_t count);
+	void FloatToS16(const double *src, int16_t *dst, size_t count);
+
+	/// Average interleaved channels together
+	/// @param src Interleaved samples, count * channels of them
+	/// @param channels Number of channels in src
+	/// @param dst Buffer for count mono samples
+	/// @param count Number of samples per channel
+	void Downmix(const int16_t *src, int channels, int16_t *dst, size_t count);
+
+	/// Average interleaved floating point channels together and convert the
+	/// result to signed 16-bit in a single pass
+	void DownmixToS16(const float *src, int channels, int16_t *dst, size_t count);
+	void DownmixToS16(const double *src, int channels, int16_t *dst, size_t count);
+
+	/// Can ToMonoS16 handle audio in the given format?
+	bool CanConvertToMonoS16(int bytes_per_sample, bool is_float);
+
+	/// Convert audio in any of the formats the audio providers pass around
+	/// (16-bit integer, float or double) to mono 16-bit
+	/// @return false if the format isn't one of the supported ones
+	bool ToMonoS16(const void *src, int bytes_per_sample, bool is_float, int channels, int16_t *dst, size_t count);
+
+	/// Double the sample rate with linear interpolation
+	/// @param src count + 1 samples
+	/// @param dst Buffer for count * 2 samples
+	/// @param count Number of source samples to expand
+	void DoubleSampleRate(const int16_t *src, int16_t *dst, size_t count);
+} }
@@ -0,0 +1,212 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/peak_index.h"
+
+#include "libaegisub/exception.h"
+#include "libaegisub/io.h"
+#include "libaegisub/log.h"
+#include "libaegisub/make_unique.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace {
+const char magic[] = "AGIPEAK1";
+
+struct accumulator {
+	int16_t min = 0;
+	int16_t max = 0;
+	int64_t neg = 0;
+	int64_t pos = 0;
+	int64_t count = 0;
+
+	void add(agi::AudioPeak const& peak, int64_t samples) {
+		min = std::min(min, peak.min);
+		max = std::max(max, peak.max);
+		neg += peak.avg_min * samples;
+		pos += peak.avg_max * samples;
+		count += samples;
+	}
+
+	agi::AudioPeak get() const {
+		agi::AudioPeak ret;
+		ret.min = min;
+		ret.max = max;
+		if (count) {
+			ret.avg_min = static_cast<int16_t>(neg / count);
+			ret.avg_max = static_cast<int16_t>(pos / count);
+		}
+		return ret;
+	}
+};
+}
+
+namespace agi {
+AudioPeakIndex::AudioPeakIndex(int64_t num_samples)
+: num_samples(num_samples)
+{
+	size_t buckets = static_cast<size_t>((num_samples + (1 << BucketBits) - 1) >> BucketBits);
+	do {
+		levels.emplace_back(buckets);
+		buckets = (buckets + (1 << LevelBits) - 1) >> LevelBits;
+	} while (levels.back().size() > 1);
+}
+
+int64_t AudioPeakIndex::BucketSamples(size_t level, size_t bucket) const {
+	int64_t start = static_cast<int64_t>(bucket) << Shift(level);
+	return std::min<int64_t>(int64_t(1) << Shift(level), num_samples - start);
+}
+
+void AudioPeakIndex::Combine(size_t level, size_t bucket) {
+	auto const& children = levels[level - 1];
+	size_t first = bucket << LevelBits;
+	size_t last = std::min(children.size(), first + (1 << LevelBits));
+
+	accumulator acc;
+	for (size_t i = first; i < last; ++i)
+		acc.add(children[i], BucketSamples(level - 1, i));
+	levels[level][bucket] = acc.get();
+}
+
+void AudioPeakIndex::EmitBucket(size_t bucket, int64_t count) {
+	auto& peak = levels[0][bucket];
+	peak.min = cur_min;
+	peak.max = cur_max;
+	peak.avg_min = static_cast<int16_t>(cur_neg / count);
+	peak.avg_max = static_cast<int16_t>(cur_pos / count);
+	cur_min = cur_max = 0;
+	cur_neg = cur_pos = 0;
+
+	// Fill in each parent bucket once its last child is done
+	for (size_t level = 1; level < levels.size(); ++level) {
+		if ((bucket + 1) % (1 << LevelBits) != 0) break;
+		bucket >>= LevelBits;
+		Combine(level, bucket);
+	}
+}
+
+void AudioPeakIndex::Add(const int16_t *samples, int64_t count) {
+	// Every bucket may be being read once the index is complete, so nothing
+	// can be written to it after that
+	int64_t pos = indexed_samples;
+	if (pos == num_samples) return;
+	count = std::min(count, num_samples - pos);
+
+	for (const int16_t *end = samples + count; samples < end; ++samples) {
+		int16_t sample = *samples;
+		if (sample > 0) {
+			cur_max = std::max(cur_max, sample);
+			cur_pos += sample;
+		}
+		else {
+			cur_min = std::min(cur_min, sample);
+			cur_neg += sample;
+		}
+
+		if ((++pos & ((1 << BucketBits) - 1)) == 0)
+			EmitBucket(static_cast<size_t>((pos - 1) >> BucketBits), 1 << BucketBits);
+	}
+
+	// The final buckets of each level are partial and need to be flushed
+	// explicitly once everything has been added. Readers can't see them
+	// until indexed_samples reaches num_samples, so they're published along
+	// with everything else by the store below.
+	if (pos == num_samples && pos > 0) {
+		if (int64_t partial = pos & ((1 << BucketBits) - 1))
+			EmitBucket(levels[0].size() - 1, partial);
+		for (size_t level = 1; level < levels.size(); ++level)
+			Combine(level, levels[level].size() - 1);
+	}
+
+	indexed_samples = pos;
+}
+
+bool AudioPeakIndex::Get(int64_t start, int64_t count, AudioPeak &out) const {
+	if (count < (1 << BucketBits)) return false;
+
+	int64_t end = std::min(start + count, num_samples);
+	start = std::max<int64_t>(start, 0);
+	if (start >= end) {
+		out = AudioPeak();
+		return true;
+	}
+
+	size_t level = 0;
+	while (level + 1 < levels.size() && (int64_t(1) << Shift(level + 1)) <= count)
+		++level;
+
+	auto const& buckets = levels[level];
+	const int shift = Shift(level);
+	const int64_t half = int64_t(1) << (shift - 1);
+	size_t first = std::min(static_cast<size_t>((start + half) >> shift), buckets.size() - 1);
+	size_t last = std::min(static_cast<size_t>((end + half) >> shift), buckets.size());
+	if (last <= first)
+		last = first + 1;
+
+	// Each level's last bucket ends at or after num_samples, so until the
+	// index is complete this also rules out the partial final buckets
+	const int64_t indexed = indexed_samples;
+	if (indexed < num_samples && (static_cast<int64_t>(last) << shift) > indexed)
+		return false;
+
+	accumulator acc;
+	for (size_t i = first; i < last; ++i)
+		acc.add(buckets[i], BucketSamples(level, i));
+	out = acc.get();
+	return true;
+}
+
+void AudioPeakIndex::Save(fs::path const& filename) const {
+	if (!IsComplete())
+		throw InternalError("Tried to save an incomplete audio peak index");
+
+	io::Save file(filename, true);
+	auto& out = file.Get();
+	out.write(magic, sizeof(magic) - 1);
+	out.write(reinterpret_cast<const char *>(&num_samples), sizeof(num_samples));
+	for (auto const& level : levels)
+		out.write(reinterpret_cast<const char *>(level.data()), level.size() * sizeof(AudioPeak));
+}
+
+std::unique_ptr<AudioPeakIndex> AudioPeakIndex::Load(fs::path const& filename, int64_t num_samples) {
+	try {
+		auto in = io::Open(filename, true);
+
+		char header[sizeof(magic) - 1];
+		int64_t file_samples = 0;
+		in->read(header, sizeof(header));
+		in->read(reinterpret_cast<char *>(&file_samples), sizeof(file_samples));
+		if (!in->good() || memcmp(header, magic, sizeof(header)) || file_samples != num_samples)
+			return nullptr;
+
+		auto index = agi::make_unique<AudioPeakIndex>(num_samples);
+		for (auto& level : index->levels)
+			in->read(reinterpret_cast<char *>(level.data()), level.size() * sizeof(AudioPeak));
+		if (!in->good())
+			return nullptr;
+
+		index->indexed_samples = num_samples;
+		return index;
+	}
+	catch (agi::Exception const& e) {
+		LOG_D("audio/peak_index") << "Could not load peak index: " << e.GetMessage();
+		return nullptr;
+	}
+}
+}
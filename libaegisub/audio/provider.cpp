@@ -16,6 +16,8 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "convert.h"
+
 #include "libaegisub/fs.h"
 #include "libaegisub/io.h"
 #include "libaegisub/log.h"
@@ -26,14 +28,47 @@ void AudioProvider::GetAudioWithVolume(void *buf, int64_t start, int64_t count,
 	GetAudio(buf, start, count);
 
 	if (volume == 1.0) return;
-	if (bytes_per_sample != 2)
+
+	const size_t samples = static_cast<size_t>(count) * channels;
+	if (float_samples && bytes_per_sample == sizeof(float)) {
+		auto buffer = static_cast<float *>(buf);
+		for (size_t i = 0; i < samples; ++i)
+			buffer[i] = static_cast<float>(buffer[i] * volume);
+		return;
+	}
+
+	if (float_samples || bytes_per_sample != 2)
 		throw agi::InternalError("GetAudioWithVolume called on unconverted audio stream");
 
 	auto buffer = static_cast<int16_t *>(buf);
-	for (size_t i = 0; i < (size_t)count; ++i)
+	for (size_t i = 0; i < samples; ++i)
 		buffer[i] = util::mid(-0x8000, static_cast<int>(buffer[i] * volume + 0.5), 0x7FFF);
 }
 
+void AudioProvider::GetInt16MonoAudio(int16_t *buf, int64_t start, int64_t count) const {
+	if (channels == 1 && bytes_per_sample == 2 && !float_samples)
+		return GetAudio(buf, start, count);
+
+	// Convert a bit at a time to keep the scratch buffer small
+	const int64_t chunk = 4096;
+	std::vector<char> native(static_cast<size_t>(std::min(chunk, count) * bytes_per_sample * channels));
+	for (int64_t i = 0; i < count; i += chunk) {
+		auto n = std::min(chunk, count - i);
+		GetAudio(native.data(), start + i, n);
+		if (!audio_convert::ToMonoS16(native.data(), bytes_per_sample, float_samples, channels, buf + i, static_cast<size_t>(n)))
+			throw agi::InternalError("GetInt16MonoAudio called on unconverted audio stream");
+	}
+}
+
+void AudioProvider::GetInt16MonoAudioWithVolume(int16_t *buf, int64_t start, int64_t count, double volume) const {
+	GetInt16MonoAudio(buf, start, count);
+
+	if (volume == 1.0) return;
+
+	for (size_t i = 0; i < (size_t)count; ++i)
+		buf[i] = util::mid(-0x8000, static_cast<int>(buf[i] * volume + 0.5), 0x7FFF);
+}
+
 void AudioProvider::ZeroFill(void *buf, int64_t count) const {
 	if (bytes_per_sample == 1)
 		// 8 bit formats are usually unsigned with bias 128
@@ -108,19 +143,33 @@ void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int star
 	const size_t bytes_per_sample = provider.GetBytesPerSample() * provider.GetChannels();
 	const size_t bufsize = (end_sample - start_sample) * bytes_per_sample;
 
+	// Formats other than integer PCM need the full WAVEFORMATEX, with an
+	// empty cbSize, and a fact chunk with the number of samples
+	const bool is_float = provider.AreSamplesFloat();
+	const int32_t fmt_size = is_float ? 18 : 16;
+	const int32_t fact_size = is_float ? 12 : 0;
+
 	writer out{path};
 	out.write("RIFF");
-	out.write<int32_t>(bufsize + 36);
+	out.write<int32_t>(bufsize + 4 + 8 + fmt_size + fact_size + 8);
 
 	out.write("WAVEfmt ");
-	out.write<int32_t>(16); // Size of chunk
-	out.write<int16_t>(1);  // compression format (PCM)
+	out.write<int32_t>(fmt_size); // Size of chunk
+	out.write<int16_t>(is_float ? 3 : 1); // compression format (IEEE float or PCM)
 	out.write<int16_t>(provider.GetChannels());
 	out.write<int32_t>(provider.GetSampleRate());
 	out.write<int32_t>(provider.GetSampleRate() * provider.GetChannels() * provider.GetBytesPerSample());
 	out.write<int16_t>(provider.GetChannels() * provider.GetBytesPerSample());
 	out.write<int16_t>(provider.GetBytesPerSample() * 8);
 
+	if (is_float) {
+		out.write<int16_t>(0); // cbSize
+
+		out.write("fact");
+		out.write<int32_t>(4);
+		out.write<int32_t>(end_sample - start_sample);
+	}
+
 	out.write("data");
 	out.write<int32_t>(bufsize);
 
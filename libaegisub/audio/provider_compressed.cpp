@@ -0,0 +1,484 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/provider.h"
+
+#include "convert.h"
+
+#include "libaegisub/audio/peak_index.h"
+#include "libaegisub/fs.h"
+#include "libaegisub/log.h"
+#include "libaegisub/make_unique.h"
+
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <thread>
+
+// Blocks are compressed with FLAC-style fixed linear prediction followed by
+// Rice coding of the residuals. Each channel of each block is split into
+// subblocks which each pick the predictor order which works best for them,
+// and the subblocks are split into partitions which each have their own
+// Rice parameter.
+//
+// Samples are handled as integers. Float samples which came from integer
+// audio are scaled back to integers, and any others are mapped to integers
+// such that nearby values map to nearby integers, which lets the same
+// prediction work on them, albeit far less effectively.
+
+namespace {
+using namespace agi;
+
+const int64_t BlockFrames = 1 << 15;
+const int SubblockBits = 12;
+const int PartitionBits = 8;
+const int MaxOrder = 3;
+const int MaxRiceParameter = 40;
+/// Quotients this large are written as an escape code followed by the raw value
+const int EscapeQuotient = 24;
+/// Number of decompressed blocks to keep around
+const size_t HotBlocks = 16;
+
+class BitWriter {
+	std::vector<uint8_t>& out;
+	uint64_t acc = 0;
+	int bits = 0;
+
+public:
+	BitWriter(std::vector<uint8_t>& out) : out(out) { }
+
+	/// Write the low count bits of value; count must be at most 56
+	void Write(uint64_t value, int count) {
+		if (count < 64)
+			value &= (uint64_t(1) << count) - 1;
+		acc |= value << bits;
+		bits += count;
+		while (bits >= 8) {
+			out.push_back(static_cast<uint8_t>(acc));
+			acc >>= 8;
+			bits -= 8;
+		}
+	}
+
+	void Flush() {
+		if (bits > 0)
+			out.push_back(static_cast<uint8_t>(acc));
+		acc = 0;
+		bits = 0;
+	}
+};
+
+class BitReader {
+	const uint8_t *cur;
+	const uint8_t *end;
+	uint64_t acc = 0;
+	int bits = 0;
+
+	void Refill() {
+		while (bits <= 56) {
+			uint64_t byte = cur < end ? *cur++ : 0;
+			acc |= byte << bits;
+			bits += 8;
+		}
+	}
+
+public:
+	BitReader(std::vector<uint8_t> const& data) : cur(data.data()), end(data.data() + data.size()) { }
+
+	/// Read count bits; count must be at most 56
+	uint64_t Read(int count) {
+		if (bits < count) Refill();
+		uint64_t value = count ? acc & ((uint64_t(1) << count) - 1) : 0;
+		acc >>= count;
+		bits -= count;
+		return value;
+	}
+
+	/// Count and consume set bits up to max, and the clear bit after them
+	/// if there were fewer than max
+	int ReadOnes(int max) {
+		if (bits < max + 1) Refill();
+		int count = 0;
+		while (count < max && (acc & 1)) {
+			acc >>= 1;
+			++count;
+		}
+		if (count < max)
+			acc >>= 1;
+		bits -= count < max ? count + 1 : count;
+		return count;
+	}
+};
+
+uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+/// Predict a sample from the three before it, with all of them scaled down
+/// by the subblock's shift
+int64_t predict(int order, const int64_t *history, int shift) {
+	switch (order) {
+		case 0: return 0;
+		case 1: return history[-1] >> shift;
+		case 2: return 2 * (history[-1] >> shift) - (history[-2] >> shift);
+		default: return 3 * (history[-1] >> shift) - 3 * (history[-2] >> shift) + (history[-3] >> shift);
+	}
+}
+
+/// Map float bits to integers which preserve the ordering of the floats.
+/// This is its own inverse.
+int32_t map_float_bits(int32_t bits) {
+	return bits ^ ((bits >> 31) & 0x7FFFFFFF);
+}
+
+/// Float samples which are exact multiples of this can be stored as integers
+const float FloatScale = 8388608.f; // 2^23
+
+enum FloatMode {
+	/// Samples are stored as their remapped bits
+	FloatBits = 0,
+	/// Samples are stored as integer multiples of 1 / FloatScale, which is
+	/// the case for audio which was decoded from 24 bits or less
+	FloatScaled = 1
+};
+
+class SampleCodec {
+	int channels;
+	int bytes_per_sample;
+	bool is_float;
+
+	int64_t Load(const char *data, size_t i, FloatMode mode) const {
+		if (bytes_per_sample == 2) {
+			int16_t v;
+			memcpy(&v, data + i * 2, 2);
+			return v;
+		}
+		int32_t v;
+		memcpy(&v, data + i * 4, 4);
+		if (!is_float) return v;
+		if (mode == FloatBits) return map_float_bits(v);
+		float f;
+		memcpy(&f, &v, 4);
+		return static_cast<int64_t>(f * FloatScale);
+	}
+
+	void Store(char *data, size_t i, int64_t value, FloatMode mode) const {
+		if (bytes_per_sample == 2) {
+			auto v = static_cast<int16_t>(value);
+			memcpy(data + i * 2, &v, 2);
+			return;
+		}
+		if (is_float && mode == FloatScaled) {
+			float f = static_cast<float>(value) / FloatScale;
+			memcpy(data + i * 4, &f, 4);
+			return;
+		}
+		auto v = static_cast<int32_t>(value);
+		if (is_float) v = map_float_bits(v);
+		memcpy(data + i * 4, &v, 4);
+	}
+
+	/// Can every sample of the channel be stored exactly in scaled mode?
+	bool CanScale(const char *data, int c, size_t frames) const {
+		for (size_t i = 0; i < frames; ++i) {
+			float f;
+			memcpy(&f, data + (i * channels + c) * 4, 4);
+			if (!(std::abs(f) < 256.f)) return false;
+			float scaled = f * FloatScale;
+			float restored = static_cast<float>(static_cast<int32_t>(scaled)) / FloatScale;
+			// Compare bits so that negative zero isn't turned into zero
+			if (memcmp(&restored, &f, 4) != 0) return false;
+		}
+		return true;
+	}
+
+public:
+	SampleCodec(int channels, int bytes_per_sample, bool is_float)
+	: channels(channels), bytes_per_sample(bytes_per_sample), is_float(is_float)
+	{
+	}
+
+	std::vector<uint8_t> Compress(const char *data, size_t frames) const {
+		std::vector<uint8_t> out;
+		BitWriter writer(out);
+		// Three samples of history before the first one
+		std::vector<int64_t> samples(frames + MaxOrder);
+		std::vector<uint64_t> residuals(size_t(1) << SubblockBits);
+
+		for (int c = 0; c < channels; ++c) {
+			FloatMode mode = FloatBits;
+			if (is_float) {
+				if (CanScale(data, c, frames))
+					mode = FloatScaled;
+				writer.Write(mode, 1);
+			}
+
+			for (size_t i = 0; i < frames; ++i)
+				samples[i + MaxOrder] = Load(data, i * channels + c, mode);
+
+			for (size_t sub = 0; sub < frames; sub += size_t(1) << SubblockBits) {
+				size_t sub_len = std::min(frames - sub, size_t(1) << SubblockBits);
+				const int64_t *base = &samples[sub + MaxOrder];
+
+				// Drop low bits which are zero in every sample, as happens
+				// when audio was converted up from a lower bit depth
+				uint64_t all_bits = 0;
+				for (size_t i = 0; i < sub_len; ++i)
+					all_bits |= static_cast<uint64_t>(base[i]);
+				int shift = 0;
+				while (all_bits && shift < 31 && !(all_bits & 1)) {
+					all_bits >>= 1;
+					++shift;
+				}
+
+				// Pick whichever order gives the smallest residuals
+				int best_order = 0;
+				uint64_t best_sum = UINT64_MAX;
+				for (int order = 0; order <= MaxOrder; ++order) {
+					uint64_t sum = 0;
+					for (size_t i = 0; i < sub_len; ++i)
+						sum += zigzag((base[i] >> shift) - predict(order, base + i, shift)) >> 1;
+					if (sum < best_sum) {
+						best_sum = sum;
+						best_order = order;
+					}
+				}
+				writer.Write(best_order, 2);
+				writer.Write(shift, 5);
+
+				for (size_t i = 0; i < sub_len; ++i)
+					residuals[i] = zigzag((base[i] >> shift) - predict(best_order, base + i, shift));
+
+				for (size_t part = 0; part < sub_len; part += size_t(1) << PartitionBits) {
+					size_t part_len = std::min(sub_len - part, size_t(1) << PartitionBits);
+					uint64_t sum = 0;
+					for (size_t i = 0; i < part_len; ++i)
+						sum += residuals[part + i];
+
+					int k = 0;
+					while (k < MaxRiceParameter && (uint64_t(part_len) << (k + 1)) <= sum)
+						++k;
+					writer.Write(k, 6);
+
+					for (size_t i = 0; i < part_len; ++i) {
+						uint64_t u = residuals[part + i];
+						uint64_t q = u >> k;
+						if (q < EscapeQuotient) {
+							writer.Write((uint64_t(1) << q) - 1, static_cast<int>(q) + 1);
+							writer.Write(u, k);
+						}
+						else {
+							writer.Write((uint64_t(1) << EscapeQuotient) - 1, EscapeQuotient);
+							writer.Write(u, 32);
+							writer.Write(u >> 32, 32);
+						}
+					}
+				}
+			}
+		}
+
+		writer.Flush();
+		out.shrink_to_fit();
+		return out;
+	}
+
+	void Decompress(std::vector<uint8_t> const& compressed, char *data, size_t frames) const {
+		BitReader reader(compressed);
+		std::vector<int64_t> samples(frames + MaxOrder);
+
+		for (int c = 0; c < channels; ++c) {
+			FloatMode mode = FloatBits;
+			if (is_float)
+				mode = static_cast<FloatMode>(reader.Read(1));
+
+			for (size_t sub = 0; sub < frames; sub += size_t(1) << SubblockBits) {
+				size_t sub_len = std::min(frames - sub, size_t(1) << SubblockBits);
+				int64_t *base = &samples[sub + MaxOrder];
+				int order = static_cast<int>(reader.Read(2));
+				int shift = static_cast<int>(reader.Read(5));
+
+				for (size_t part = 0; part < sub_len; part += size_t(1) << PartitionBits) {
+					size_t part_len = std::min(sub_len - part, size_t(1) << PartitionBits);
+					int k = static_cast<int>(reader.Read(6));
+
+					for (size_t i = part; i < part + part_len; ++i) {
+						uint64_t u;
+						int q = reader.ReadOnes(EscapeQuotient);
+						if (q < EscapeQuotient)
+							u = (uint64_t(q) << k) | reader.Read(k);
+						else {
+							u = reader.Read(32);
+							u |= reader.Read(32) << 32;
+						}
+						base[i] = static_cast<int64_t>(static_cast<uint64_t>(predict(order, base + i, shift) + unzigzag(u)) << shift);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < frames; ++i)
+				Store(data, i * channels + c, samples[i + MaxOrder], mode);
+		}
+	}
+};
+
+class CompressedRAMAudioProvider final : public AudioProviderWrapper {
+	SampleCodec codec;
+	std::vector<std::vector<uint8_t>> blocks;
+	std::unique_ptr<AudioPeakIndex> peaks;
+	std::atomic<bool> cancelled = {false};
+	std::thread decoder;
+
+	typedef std::shared_ptr<const std::vector<char>> DecodedBlock;
+	/// Recently used decompressed blocks with the most recent at the front
+	mutable std::list<std::pair<size_t, DecodedBlock>> hot;
+	mutable std::mutex hot_lock;
+
+	size_t BlockBytes(size_t i) const {
+		auto frames = std::min<int64_t>(BlockFrames, num_samples - i * BlockFrames);
+		return static_cast<size_t>(frames * bytes_per_sample * channels);
+	}
+
+	/// Find a block in the hot list and move it to the front
+	/// @return The block, or null if it isn't hot; hot_lock must be held
+	DecodedBlock FindHot(size_t i) const {
+		for (auto it = hot.begin(); it != hot.end(); ++it) {
+			if (it->first == i) {
+				hot.splice(hot.begin(), hot, it); // Move to front
+				return hot.front().second;
+			}
+		}
+		return nullptr;
+	}
+
+	DecodedBlock GetBlock(size_t i) const {
+		{
+			std::lock_guard<std::mutex> lock(hot_lock);
+			if (auto block = FindHot(i))
+				return block;
+		}
+
+		// Decompress without holding the lock so that readers which hit the
+		// cache aren't held up
+		auto decoded = std::make_shared<std::vector<char>>(BlockBytes(i));
+		codec.Decompress(blocks[i], decoded->data(), decoded->size() / (bytes_per_sample * channels));
+
+		// Another reader may have decompressed the same block meanwhile, and
+		// a second copy would push a different block out of the list
+		std::lock_guard<std::mutex> lock(hot_lock);
+		if (auto block = FindHot(i))
+			return block;
+		hot.emplace_front(i, decoded);
+		if (hot.size() > HotBlocks)
+			hot.pop_back();
+		return decoded;
+	}
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto charbuf = static_cast<char *>(buf);
+		const int frame = bytes_per_sample * channels;
+		while (count > 0) {
+			if (start >= decoded_samples) {
+				ZeroFill(charbuf, count);
+				break;
+			}
+
+			const size_t i = static_cast<size_t>(start / BlockFrames);
+			const int64_t block_offset = start % BlockFrames;
+			const int64_t read_count = std::min(count, BlockFrames - block_offset);
+
+			auto block = GetBlock(i);
+			memcpy(charbuf, block->data() + block_offset * frame, read_count * frame);
+			charbuf += read_count * frame;
+			count -= read_count;
+			start += read_count;
+		}
+	}
+
+public:
+	CompressedRAMAudioProvider(std::unique_ptr<AudioProvider> src, fs::path const& peak_cache)
+	: AudioProviderWrapper(std::move(src))
+	, codec(channels, bytes_per_sample, float_samples)
+	{
+		if (bytes_per_sample != 2 && bytes_per_sample != 4)
+			throw AudioProviderError("Compressed audio cache: only 16 and 32 bit audio is supported");
+
+		decoded_samples = 0;
+
+		bool build_peaks = false;
+		if (audio_convert::CanConvertToMonoS16(bytes_per_sample, float_samples)) {
+			if (!peak_cache.empty())
+				peaks = AudioPeakIndex::Load(peak_cache, num_samples);
+			if (!peaks) {
+				peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+				build_peaks = true;
+			}
+		}
+
+		blocks.resize(static_cast<size_t>((num_samples + BlockFrames - 1) / BlockFrames));
+
+		decoder = std::thread([=] {
+			std::vector<char> raw;
+			std::vector<int16_t> mono;
+			size_t compressed_size = 0;
+			for (size_t i = 0; i < blocks.size(); ++i) {
+				if (cancelled) break;
+				auto frames = std::min<int64_t>(BlockFrames, num_samples - i * BlockFrames);
+				raw.resize(BlockBytes(i));
+				source->GetAudio(raw.data(), i * BlockFrames, frames);
+				blocks[i] = codec.Compress(raw.data(), static_cast<size_t>(frames));
+				compressed_size += blocks[i].size();
+				if (build_peaks) {
+					mono.resize(static_cast<size_t>(frames));
+					audio_convert::ToMonoS16(raw.data(), bytes_per_sample, float_samples, channels, mono.data(), mono.size());
+					peaks->Add(mono.data(), frames);
+				}
+				decoded_samples += frames;
+			}
+
+			if (!cancelled && num_samples > 0) {
+				LOG_D("audio_provider/compressed") << "Compressed "
+					<< num_samples * bytes_per_sample * channels << " bytes of audio to " << compressed_size;
+			}
+
+			if (build_peaks && !cancelled && !peak_cache.empty()) {
+				try {
+					peaks->Save(peak_cache);
+				}
+				catch (agi::Exception const& e) {
+					LOG_W("audio_provider/compressed") << "Failed to save peak index: " << e.GetMessage();
+				}
+			}
+		});
+	}
+
+	~CompressedRAMAudioProvider() {
+		cancelled = true;
+		decoder.join();
+	}
+
+	AudioPeakIndex const* GetPeakIndex() const override { return peaks.get(); }
+};
+}
+
+namespace agi {
+std::unique_ptr<AudioProvider> CreateCompressedRAMAudioProvider(std::unique_ptr<AudioProvider> src) {
+	return agi::make_unique<CompressedRAMAudioProvider>(std::move(src), fs::path());
+}
+
+std::unique_ptr<AudioProvider> CreateCompressedRAMAudioProvider(std::unique_ptr<AudioProvider> src, fs::path const& peak_cache) {
+	return agi::make_unique<CompressedRAMAudioProvider>(std::move(src), peak_cache);
+}
+}
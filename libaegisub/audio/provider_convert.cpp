@@ -16,16 +16,20 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "convert.h"
+
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
 
-#include <limits>
+#include <cstring>
 
 using namespace agi;
 
-/// Anything integral -> 16 bit signed machine-endian audio converter
+/// Integral -> 16 bit signed machine-endian or float audio converter
+///
+/// 8-bit audio becomes 16-bit as that's lossless, while anything more precise
+/// becomes float to avoid throwing away the extra precision.
 namespace {
-template<class Target>
 class BitdepthConvertAudioProvider final : public AudioProviderWrapper {
 	int src_bytes_per_sample;
 	mutable std::vector<uint8_t> src_buf;
@@ -36,108 +40,63 @@ public:
 			throw AudioProviderError("Audio format converter: audio with bitdepths greater than 64 bits/sample is currently unsupported");
 
 		src_bytes_per_sample = bytes_per_sample;
-		bytes_per_sample = sizeof(Target);
+		float_samples = src_bytes_per_sample > 1;
+		bytes_per_sample = float_samples ? sizeof(float) : sizeof(int16_t);
 	}
 
 	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
 		auto count = static_cast<size_t>(count64);
-		assert(count == count64);
+		assert(static_cast<int64_t>(count) == count64);
 
 		src_buf.resize(count * src_bytes_per_sample * channels);
 		source->GetAudio(src_buf.data(), start, count);
 
-		auto dest = static_cast<int16_t*>(buf);
-
-		for (int64_t i = 0; i < count * channels; ++i) {
-			int64_t sample = 0;
-
-			// 8 bits per sample is assumed to be unsigned with a bias of 127,
-			// while everything else is assumed to be signed with zero bias
-			if (src_bytes_per_sample == 1)
-				sample = src_buf[i] - 128;
-			else {
-				for (int j = src_bytes_per_sample; j > 0; --j) {
-					sample <<= 8;
-					sample += src_buf[i * src_bytes_per_sample + j - 1];
-				}
-			}
-
-			if (static_cast<size_t>(src_bytes_per_sample) > sizeof(Target))
-				sample /= 1LL << (src_bytes_per_sample - sizeof(Target)) * 8;
-			else if (static_cast<size_t>(src_bytes_per_sample) < sizeof(Target))
-				sample *=  1LL << (sizeof(Target) - src_bytes_per_sample ) * 8;
-
-			dest[i] = static_cast<Target>(sample);
-		}
+		// 8 bits per sample is assumed to be unsigned with a bias of 127,
+		// while everything else is assumed to be signed with zero bias
+		if (src_bytes_per_sample == 1)
+			audio_convert::U8ToS16(src_buf.data(), static_cast<int16_t*>(buf), count * channels);
+		else
+			audio_convert::IntToFloat(src_buf.data(), src_bytes_per_sample, static_cast<float*>(buf), count * channels);
 	}
 };
 
-/// Floating point -> 16 bit signed machine-endian audio converter
-template<class Source, class Target>
+/// Double -> float audio converter
 class FloatConvertAudioProvider final : public AudioProviderWrapper {
-	mutable std::vector<Source> src_buf;
+	mutable std::vector<double> src_buf;
 
 public:
 	FloatConvertAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
-		bytes_per_sample = sizeof(Target);
-		float_samples = false;
+		bytes_per_sample = sizeof(float);
 	}
 
 	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
 		auto count = static_cast<size_t>(count64);
-		assert(count == count64);
+		assert(static_cast<int64_t>(count) == count64);
 
 		src_buf.resize(count * channels);
 		source->GetAudio(&src_buf[0], start, count);
-
-		auto dest = static_cast<Target*>(buf);
-
-		for (size_t i = 0; i < static_cast<size_t>(count * channels); ++i) {
-			Source expanded;
-			if (src_buf[i] < 0)
-				expanded = static_cast<Target>(-src_buf[i] * std::numeric_limits<Target>::min());
-			else
-				expanded = static_cast<Target>(src_buf[i] * std::numeric_limits<Target>::max());
-
-			dest[i] = expanded < std::numeric_limits<Target>::min() ? std::numeric_limits<Target>::min() :
-			          expanded > std::numeric_limits<Target>::max() ? std::numeric_limits<Target>::max() :
-			                                                          static_cast<Target>(expanded);
-		}
+		audio_convert::DoubleToFloat(src_buf.data(), static_cast<float*>(buf), count * channels);
 	}
 };
 
-/// Non-mono 16-bit signed machine-endian -> mono 16-bit signed machine endian converter
-class DownmixAudioProvider final : public AudioProviderWrapper {
-	int src_channels;
-	mutable std::vector<int16_t> src_buf;
-
-public:
-	DownmixAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
-		src_channels = channels;
-		channels = 1;
-	}
-
-	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
-		auto count = static_cast<size_t>(count64);
-		assert(count == count64);
-
-		src_buf.resize(count * src_channels);
-		source->GetAudio(&src_buf[0], start, count);
-
-		auto dst = static_cast<int16_t*>(buf);
-		// Just average the channels together
-		while (count-- > 0) {
-			int sum = 0;
-			for (int c = 0; c < src_channels; ++c)
-				sum += src_buf[count * src_channels + c];
-			dst[count] = static_cast<int16_t>(sum / src_channels);
+/// Sample doubler with linear interpolation for the samples provider
+/// Requires 16-bit or float input
+class SampleDoublingAudioProvider final : public AudioProviderWrapper {
+	mutable std::vector<char> src_buf;
+	mutable std::vector<char> doubled;
+
+	template<typename Sample>
+	void Interpolate(const char *src_bytes, char *dst_bytes, size_t count) const {
+		auto src = reinterpret_cast<const Sample *>(src_bytes);
+		auto dst = reinterpret_cast<Sample *>(dst_bytes);
+		for (size_t i = 0; i < count; ++i, src += channels, dst += channels * 2) {
+			for (int c = 0; c < channels; ++c) {
+				dst[c] = src[c];
+				dst[channels + c] = static_cast<Sample>((src[c] + src[channels + c]) / 2);
+			}
 		}
 	}
-};
 
-/// Sample doubler with linear interpolation for the samples provider
-/// Requires 16-bit mono input
-class SampleDoublingAudioProvider final : public AudioProviderWrapper {
 public:
 	SampleDoublingAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
 		sample_rate *= 2;
@@ -145,52 +104,46 @@ public:
 		decoded_samples = decoded_samples * 2;
 	}
 
-	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
-		int16_t *src, *dst = static_cast<int16_t *>(buf);
-
-		// We need to always get at least two samples to be able to interpolate
-		int16_t srcbuf[2];
-		if (count == 1) {
-			source->GetAudio(srcbuf, start / 2, 2);
-			src = srcbuf;
-		}
-		else {
-			source->GetAudio(buf, start / 2, (start + count) / 2 - start / 2 + 1);
-			src = dst;
-		}
-
-		// walking backwards so that the conversion can be done in place
-		for (; count > 0; --count) {
-			auto src_index = (start + count - 1) / 2 - start / 2;
-			auto i = count - 1;
-			if ((start + i) & 1)
-				dst[i] = (int16_t)(((int32_t)src[src_index] + src[src_index + 1]) / 2);
-			else
-				dst[i] = src[src_index];
-		}
+	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
+		auto count = static_cast<size_t>(count64);
+		assert(static_cast<int64_t>(count) == count64);
+
+		// Expand every source sample which contributes to the output, plus
+		// one extra to interpolate the final sample against, and then copy
+		// out the requested range
+		const size_t frame = bytes_per_sample * channels;
+		auto first = start / 2;
+		auto src_count = static_cast<size_t>((start + count64 + 1) / 2 - first);
+		src_buf.resize((src_count + 1) * frame);
+		doubled.resize(src_count * 2 * frame);
+		source->GetAudio(src_buf.data(), first, src_count + 1);
+
+		if (float_samples)
+			Interpolate<float>(src_buf.data(), doubled.data(), src_count);
+		else if (channels == 1)
+			audio_convert::DoubleSampleRate(reinterpret_cast<const int16_t *>(src_buf.data()),
+			                                reinterpret_cast<int16_t *>(doubled.data()), src_count);
+		else
+			Interpolate<int16_t>(src_buf.data(), doubled.data(), src_count);
+		memcpy(buf, &doubled[(start & 1) * frame], count * frame);
 	}
 };
 }
 
 namespace agi {
 std::unique_ptr<AudioProvider> CreateConvertAudioProvider(std::unique_ptr<AudioProvider> provider) {
-	// Ensure 16-bit audio with proper endianness
+	// Reduce everything to either 16-bit integer or float samples, keeping
+	// all of the channels. Things which need mono 16-bit audio convert it
+	// themselves with GetInt16MonoAudio.
 	if (provider->AreSamplesFloat()) {
-		LOG_D("audio_provider") << "Converting float to S16";
-		if (provider->GetBytesPerSample() == sizeof(float))
-			provider = agi::make_unique<FloatConvertAudioProvider<float, int16_t>>(std::move(provider));
-		else
-			provider = agi::make_unique<FloatConvertAudioProvider<double, int16_t>>(std::move(provider));
-	}
-	if (provider->GetBytesPerSample() != 2) {
-		LOG_D("audio_provider") << "Converting " << provider->GetBytesPerSample() << " bytes per sample or wrong endian to S16";
-		provider = agi::make_unique<BitdepthConvertAudioProvider<int16_t>>(std::move(provider));
+		if (provider->GetBytesPerSample() == sizeof(double)) {
+			LOG_D("audio_provider") << "Converting double to float";
+			provider = agi::make_unique<FloatConvertAudioProvider>(std::move(provider));
+		}
 	}
-
-	// We currently only support mono audio
-	if (provider->GetChannels() != 1) {
-		LOG_D("audio_provider") << "Downmixing to mono from " << provider->GetChannels() << " channels";
-		provider = agi::make_unique<DownmixAudioProvider>(std::move(provider));
+	else if (provider->GetBytesPerSample() != 2) {
+		LOG_D("audio_provider") << "Converting " << provider->GetBytesPerSample() << " bytes per sample";
+		provider = agi::make_unique<BitdepthConvertAudioProvider>(std::move(provider));
 	}
 
 	// Some players don't like low sample rate audio
@@ -16,9 +16,13 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "convert.h"
+
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/file_mapping.h>
 #include <libaegisub/format.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/log.h>
 #include <libaegisub/path.h>
 #include <libaegisub/make_unique.h>
 
@@ -31,27 +35,26 @@ namespace {
 using namespace agi;
 
 class HDAudioProvider final : public AudioProviderWrapper {
-	mutable temp_file_mapping file;
+	temp_file_mapping file;
+	std::unique_ptr<AudioPeakIndex> peaks;
 	std::atomic<bool> cancelled = {false};
 	std::thread decoder;
 
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		const int64_t frame = bytes_per_sample * channels;
 		auto missing = std::min(count, start + count - decoded_samples);
 		if (missing > 0) {
-			memset(static_cast<int16_t*>(buf) + count - missing, 0, missing * bytes_per_sample);
+			ZeroFill(static_cast<char *>(buf) + (count - missing) * frame, missing);
 			count -= missing;
 		}
 
-		if (count > 0) {
-			start *= bytes_per_sample;
-			count *= bytes_per_sample;
-			memcpy(buf, file.read(start, count), count);
-		}
+		if (count > 0)
+			file.read(start * frame, count * frame, buf);
 	}
 
 	fs::path CacheFilename(fs::path const& dir) {
 		// Check free space
-		if ((uint64_t)num_samples * bytes_per_sample > fs::FreeSpace(dir))
+		if ((uint64_t)num_samples * bytes_per_sample * channels > fs::FreeSpace(dir))
 			throw AudioProviderError("Not enough free disk space in " + dir.string() + " to cache the audio");
 
 		return format("audio-%lld-%lld", time(nullptr),
@@ -59,19 +62,47 @@ class HDAudioProvider final : public AudioProviderWrapper {
 	}
 
 public:
-	HDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir)
+	HDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir, agi::fs::path const& peak_cache)
 	: AudioProviderWrapper(std::move(src))
-	, file(dir / CacheFilename(dir), num_samples * bytes_per_sample)
+	, file(dir / CacheFilename(dir), num_samples * bytes_per_sample * channels)
 	{
 		decoded_samples = 0;
-		decoder = std::thread([&] {
+
+		bool build_peaks = false;
+		if (audio_convert::CanConvertToMonoS16(bytes_per_sample, float_samples)) {
+			if (!peak_cache.empty())
+				peaks = AudioPeakIndex::Load(peak_cache, num_samples);
+			if (!peaks) {
+				peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+				build_peaks = true;
+			}
+		}
+
+		decoder = std::thread([=] {
+			const int64_t frame = bytes_per_sample * channels;
+			std::vector<int16_t> mono;
 			int64_t block = 65536;
 			for (int64_t i = 0; i < num_samples; i += block) {
 				if (cancelled) break;
 				block = std::min(block, num_samples - i);
-				source->GetAudio(file.write(i * bytes_per_sample, block * bytes_per_sample), i, block);
+				auto buf = file.write(i * frame, block * frame);
+				source->GetAudio(buf, i, block);
+				if (build_peaks) {
+					mono.resize(block);
+					audio_convert::ToMonoS16(buf, bytes_per_sample, float_samples, channels, mono.data(), block);
+					peaks->Add(mono.data(), block);
+				}
 				decoded_samples += block;
 			}
+
+			if (build_peaks && !cancelled && !peak_cache.empty()) {
+				try {
+					peaks->Save(peak_cache);
+				}
+				catch (agi::Exception const& e) {
+					LOG_W("audio_provider/hd") << "Failed to save peak index: " << e.GetMessage();
+				}
+			}
 		});
 	}
 
@@ -79,11 +110,17 @@ public:
 		cancelled = true;
 		decoder.join();
 	}
+
+	AudioPeakIndex const* GetPeakIndex() const override { return peaks.get(); }
 };
 }
 
 namespace agi {
 std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir) {
-	return agi::make_unique<HDAudioProvider>(std::move(src), dir);
+	return agi::make_unique<HDAudioProvider>(std::move(src), dir, agi::fs::path());
+}
+
+std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir, agi::fs::path const& peak_cache) {
+	return agi::make_unique<HDAudioProvider>(std::move(src), dir, peak_cache);
 }
 }
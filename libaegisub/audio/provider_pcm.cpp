@@ -173,9 +173,11 @@ public:
 					if (channels || sample_rate || bytes_per_sample)
 						throw AudioProviderError("Multiple 'fmt ' chunks not supported");
 
+					// Integer PCM or IEEE float
 					auto compression = Read<uint16_t>(&chunk_size);
-					if (compression != 1)
+					if (compression != 1 && compression != 3)
 						throw AudioProviderError("File is not uncompressed PCM");
+					float_samples = compression == 3;
 
 					channels = Read<uint16_t>(&chunk_size);
 					sample_rate = Read<uint32_t>(&chunk_size);
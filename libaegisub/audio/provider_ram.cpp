@@ -16,6 +16,11 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "convert.h"
+
+#include "libaegisub/audio/peak_index.h"
+#include "libaegisub/fs.h"
+#include "libaegisub/log.h"
 #include "libaegisub/make_unique.h"
 
 #include <array>
@@ -34,32 +39,62 @@ class RAMAudioProvider final : public AudioProviderWrapper {
 #else
 	boost::container::stable_vector<std::array<char, CacheBlockSize>> blockcache;
 #endif
+	int64_t frames_per_block;
+	std::unique_ptr<AudioPeakIndex> peaks;
 	std::atomic<bool> cancelled = {false};
 	std::thread decoder;
 
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override;
 
 public:
-	RAMAudioProvider(std::unique_ptr<AudioProvider> src)
+	RAMAudioProvider(std::unique_ptr<AudioProvider> src, fs::path const& peak_cache)
 	: AudioProviderWrapper(std::move(src))
 	{
 		decoded_samples = 0;
 
+		bool build_peaks = false;
+		if (audio_convert::CanConvertToMonoS16(bytes_per_sample, float_samples)) {
+			if (!peak_cache.empty())
+				peaks = AudioPeakIndex::Load(peak_cache, num_samples);
+			if (!peaks) {
+				peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+				build_peaks = true;
+			}
+		}
+
+		// Each block holds a whole number of frames so that no frame is
+		// split across blocks
+		frames_per_block = CacheBlockSize / (bytes_per_sample * channels);
+
 		try {
-			blockcache.resize((source->GetNumSamples() * source->GetBytesPerSample() + CacheBlockSize - 1) >> CacheBits);
+			blockcache.resize((num_samples + frames_per_block - 1) / frames_per_block);
 		}
 		catch (std::bad_alloc const&) {
 			throw AudioProviderError("Not enough memory available to cache in RAM");
 		}
 
-		decoder = std::thread([&] {
-			int64_t readsize = CacheBlockSize / source->GetBytesPerSample();
+		decoder = std::thread([=] {
+			std::vector<int16_t> mono;
 			for (size_t i = 0; i < blockcache.size(); i++) {
 				if (cancelled) break;
-				auto actual_read = std::min<int64_t>(readsize, num_samples - i * readsize);
-				source->GetAudio(&blockcache[i][0], i * readsize, actual_read);
+				auto actual_read = std::min<int64_t>(frames_per_block, num_samples - i * frames_per_block);
+				source->GetAudio(&blockcache[i][0], i * frames_per_block, actual_read);
+				if (build_peaks) {
+					mono.resize(actual_read);
+					audio_convert::ToMonoS16(&blockcache[i][0], bytes_per_sample, float_samples, channels, mono.data(), actual_read);
+					peaks->Add(mono.data(), actual_read);
+				}
 				decoded_samples += actual_read;
 			}
+
+			if (build_peaks && !cancelled && !peak_cache.empty()) {
+				try {
+					peaks->Save(peak_cache);
+				}
+				catch (agi::Exception const& e) {
+					LOG_W("audio_provider/ram") << "Failed to save peak index: " << e.GetMessage();
+				}
+			}
 		});
 	}
 
@@ -67,30 +102,37 @@ public:
 		cancelled = true;
 		decoder.join();
 	}
+
+	AudioPeakIndex const* GetPeakIndex() const override { return peaks.get(); }
 };
 
 void RAMAudioProvider::FillBuffer(void *buf, int64_t start, int64_t count) const {
 	auto charbuf = static_cast<char *>(buf);
-	for (int64_t bytes_remaining = count * bytes_per_sample; bytes_remaining; ) {
+	const int frame = bytes_per_sample * channels;
+	while (count > 0) {
 		if (start >= decoded_samples) {
-			memset(charbuf, 0, bytes_remaining);
+			ZeroFill(charbuf, count);
 			break;
 		}
 
-		const int i = (start * bytes_per_sample) >> CacheBits;
-		const int start_offset = (start * bytes_per_sample) & (CacheBlockSize-1);
-		const int read_size = std::min<int>(bytes_remaining, CacheBlockSize - start_offset);
+		const size_t i = static_cast<size_t>(start / frames_per_block);
+		const int64_t block_offset = start % frames_per_block;
+		const int64_t read_count = std::min(count, frames_per_block - block_offset);
 
-		memcpy(charbuf, &blockcache[i][start_offset], read_size);
-		charbuf += read_size;
-		bytes_remaining -= read_size;
-		start += read_size / bytes_per_sample;
+		memcpy(charbuf, &blockcache[i][block_offset * frame], read_count * frame);
+		charbuf += read_count * frame;
+		count -= read_count;
+		start += read_count;
 	}
 }
 }
 
 namespace agi {
 std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> src) {
-	return agi::make_unique<RAMAudioProvider>(std::move(src));
+	return agi::make_unique<RAMAudioProvider>(std::move(src), fs::path());
+}
+
+std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> src, fs::path const& peak_cache) {
+	return agi::make_unique<RAMAudioProvider>(std::move(src), peak_cache);
 }
 }
@@ -0,0 +1,149 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/alpha_blend.h"
+
+#include "libaegisub/cpu.h"
+
+#include <cstring>
+
+#ifdef AGI_CPU_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+// All of the versions rely on (x + 1 + (x >> 8)) >> 8 being exactly x / 255
+// rounded down for all x from 0 to 255 * 255, which lets the division be
+// done with 16-bit integers.
+//
+// The SIMD versions blend as many whole vectors of each row as they can and
+// then hand the rest of the row off to the scalar version.
+
+namespace {
+inline unsigned div255(unsigned x) {
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+void blend_row_scalar(uint8_t *dst, const uint8_t *mask, int width, const uint8_t *color, unsigned opacity) {
+	for (int x = 0; x < width; ++x, dst += 4) {
+		unsigned k = div255(mask[x] * opacity);
+		unsigned ck = 255 - k;
+		dst[0] = static_cast<uint8_t>(div255(k * color[0] + ck * dst[0]));
+		dst[1] = static_cast<uint8_t>(div255(k * color[1] + ck * dst[1]));
+		dst[2] = static_cast<uint8_t>(div255(k * color[2] + ck * dst[2]));
+		dst[3] = 0;
+	}
+}
+
+#ifdef AGI_CPU_X86
+AGI_TARGET("sse2")
+inline __m128i div255_sse2(__m128i x) {
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+/// Blend one half of a vector of pixels, with everything widened to 16 bits
+AGI_TARGET("sse2")
+inline __m128i blend_half_sse2(__m128i pixels, __m128i k, __m128i color) {
+	__m128i ck = _mm_sub_epi16(_mm_set1_epi16(255), k);
+	return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(k, color), _mm_mullo_epi16(ck, pixels)));
+}
+
+AGI_TARGET("sse2")
+void blend_row_sse2(uint8_t *dst, const uint8_t *mask, int width, const uint8_t *color, unsigned opacity) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i op = _mm_set1_epi16(static_cast<short>(opacity));
+	const __m128i color16 = _mm_setr_epi16(color[0], color[1], color[2], 0, color[0], color[1], color[2], 0);
+	const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+
+	int x = 0;
+	for (; x + 4 <= width; x += 4) {
+		int32_t m;
+		memcpy(&m, mask + x, 4);
+
+		// k for each pixel, then copied to every byte of that pixel
+		__m128i k = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero), op));
+		k = _mm_unpacklo_epi16(k, zero);
+		k = _mm_or_si128(k, _mm_slli_epi32(k, 8));
+		k = _mm_or_si128(k, _mm_slli_epi32(k, 16));
+
+		auto ptr = reinterpret_cast<__m128i *>(dst + x * 4);
+		__m128i pixels = _mm_loadu_si128(ptr);
+		__m128i lo = blend_half_sse2(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(k, zero), color16);
+		__m128i hi = blend_half_sse2(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(k, zero), color16);
+		_mm_storeu_si128(ptr, _mm_and_si128(_mm_packus_epi16(lo, hi), rgb_mask));
+	}
+	blend_row_scalar(dst + x * 4, mask + x, width - x, color, opacity);
+}
+
+AGI_TARGET("avx2")
+inline __m256i div255_avx2(__m256i x) {
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8)), 8);
+}
+
+AGI_TARGET("avx2")
+inline __m256i blend_half_avx2(__m256i pixels, __m256i k, __m256i color) {
+	__m256i ck = _mm256_sub_epi16(_mm256_set1_epi16(255), k);
+	return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(k, color), _mm256_mullo_epi16(ck, pixels)));
+}
+
+AGI_TARGET("avx2")
+void blend_row_avx2(uint8_t *dst, const uint8_t *mask, int width, const uint8_t *color, unsigned opacity) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i op = _mm256_set1_epi32(static_cast<int>(opacity));
+	const __m256i spread = _mm256_set1_epi32(0x01010101);
+	const __m256i color16 = _mm256_setr_epi16(
+		color[0], color[1], color[2], 0, color[0], color[1], color[2], 0,
+		color[0], color[1], color[2], 0, color[0], color[1], color[2], 0);
+	const __m256i rgb_mask = _mm256_set1_epi32(0x00FFFFFF);
+
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		// k for each pixel in 32-bit lanes lined up with the pixels, then
+		// copied to every byte of the lane by multiplying by 0x01010101
+		__m256i m = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(mask + x)));
+		__m256i k = _mm256_mullo_epi32(div255_avx2(_mm256_mullo_epi32(m, op)), spread);
+
+		auto ptr = reinterpret_cast<__m256i *>(dst + x * 4);
+		__m256i pixels = _mm256_loadu_si256(ptr);
+		__m256i lo = blend_half_avx2(_mm256_unpacklo_epi8(pixels, zero), _mm256_unpacklo_epi8(k, zero), color16);
+		__m256i hi = blend_half_avx2(_mm256_unpackhi_epi8(pixels, zero), _mm256_unpackhi_epi8(k, zero), color16);
+		_mm256_storeu_si256(ptr, _mm256_and_si256(_mm256_packus_epi16(lo, hi), rgb_mask));
+	}
+	blend_row_sse2(dst + x * 4, mask + x, width - x, color, opacity);
+}
+#endif
+
+typedef void (*blend_row_fn)(uint8_t *, const uint8_t *, int, const uint8_t *, unsigned);
+
+blend_row_fn select_blend_row() {
+#ifdef AGI_CPU_X86
+	if (agi::cpu::HasAVX2()) return blend_row_avx2;
+	if (agi::cpu::HasSSE2()) return blend_row_sse2;
+#endif
+	return blend_row_scalar;
+}
+}
+
+namespace agi {
+void BlendMask(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *mask, ptrdiff_t mask_stride,
+               int width, int height, uint8_t r, uint8_t g, uint8_t b, uint8_t opacity)
+{
+	static const auto blend_row = select_blend_row();
+	const uint8_t color[3] = {b, g, r};
+	for (int y = 0; y < height; ++y, dst += dst_stride, mask += mask_stride)
+		blend_row(dst, mask, width, color, opacity);
+}
+}
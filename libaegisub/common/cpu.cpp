@@ -0,0 +1,62 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/cpu.h"
+
+#if defined(_MSC_VER) && defined(AGI_CPU_X86)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+struct features {
+	bool sse2 = false;
+	bool avx2 = false;
+
+	features() {
+#if defined(_MSC_VER) && defined(AGI_CPU_X86)
+		int info[4];
+		__cpuid(info, 0);
+		int max_leaf = info[0];
+
+		__cpuid(info, 1);
+		sse2 = (info[3] & (1 << 26)) != 0;
+
+		// AVX registers are only usable if the OS saves them on context switches
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#elif defined(__GNUC__) && defined(AGI_CPU_X86)
+		__builtin_cpu_init();
+		sse2 = __builtin_cpu_supports("sse2");
+		avx2 = __builtin_cpu_supports("avx2");
+#endif
+	}
+};
+
+features const& get() {
+	static const features f;
+	return f;
+}
+}
+
+namespace agi { namespace cpu {
+bool HasSSE2() { return get().sse2; }
+bool HasAVX2() { return get().avx2; }
+} }
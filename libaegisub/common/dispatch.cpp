@@ -18,6 +18,7 @@
 
 #include "libaegisub/util.h"
 
+#include <algorithm>
 #include <atomic>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/strand.hpp>
@@ -52,6 +53,40 @@ namespace {
 		SerialQueue() : strand(*service) { }
 	};
 
+	/// State for one ParallelFor call. Shared with the background jobs, as a
+	/// job can start after the caller has already run every index itself.
+	struct ParallelForState {
+		std::function<void (size_t)> job;
+		size_t count;
+
+		std::atomic<size_t> next{0};
+		std::mutex mutex;
+		std::condition_variable finished;
+		size_t done = 0;
+		size_t error_index = 0;
+		std::exception_ptr error;
+
+		void Run() {
+			for (size_t i; (i = next++) < count; ) {
+				std::exception_ptr e;
+				try {
+					job(i);
+				}
+				catch (...) {
+					e = std::current_exception();
+				}
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if (e && (!error || i < error_index)) {
+					error = e;
+					error_index = i;
+				}
+				if (++done == count)
+					finished.notify_all();
+			}
+		}
+	};
+
 	struct IOServiceThreadPool {
 		boost::asio::io_service io_service;
 		std::unique_ptr<boost::asio::io_service::work> work;
@@ -137,4 +172,22 @@ std::unique_ptr<Queue> Create() {
 	return std::unique_ptr<Queue>(new SerialQueue);
 }
 
+void ParallelFor(size_t count, std::function<void (size_t)> job) {
+	if (count == 0) return;
+	if (count == 1) return job(0);
+
+	auto state = std::make_shared<ParallelForState>();
+	state->job = std::move(job);
+	state->count = count;
+
+	size_t helpers = std::min<size_t>(count - 1, std::thread::hardware_concurrency());
+	for (size_t i = 0; i < helpers; ++i)
+		service->post([=] { state->Run(); });
+	state->Run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&] { return state->done == state->count; });
+	if (state->error) std::rethrow_exception(state->error);
+}
+
 } }
@@ -22,6 +22,7 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
 #include <limits>
 
 #ifdef _WIN32
@@ -158,15 +159,44 @@ temp_file_mapping::temp_file_mapping(fs::path const& filename, uint64_t size)
 		}
 	}
 #endif
+
+	if (sizeof(size_t) > 4 && size > 0) {
+		try {
+			full_region = agi::make_unique<mapped_region>(file, read_write, 0, static_cast<size_t>(size));
+		}
+		catch (interprocess_exception const&) {
+			throw fs::FileSystemUnknownError("Failed mapping a view of the file");
+		}
+	}
 }
 
 temp_file_mapping::~temp_file_mapping() { }
 
-const char *temp_file_mapping::read(int64_t offset, uint64_t length) {
-	return map(offset, length, read_only, file_size, file, read_region, read_mapping_start);
+void temp_file_mapping::read(int64_t offset, uint64_t length, void *dst) const {
+	if (length == 0) return;
+	if (static_cast<uint64_t>(offset) + length > file_size)
+		throw InternalError("Attempted to map beyond end of file");
+
+	if (full_region) {
+		memcpy(dst, static_cast<const char *>(full_region->get_address()) + offset, static_cast<size_t>(length));
+		return;
+	}
+
+	// Map a window just for this read so that concurrent readers don't
+	// fight over a shared one
+	std::unique_ptr<mapped_region> region;
+	uint64_t mapping_start = 0;
+	memcpy(dst, map(offset, length, read_only, file_size, file, region, mapping_start), static_cast<size_t>(length));
 }
 
 char *temp_file_mapping::write(int64_t offset, uint64_t length) {
+	if (full_region) {
+		static char dummy = 0;
+		if (length == 0) return &dummy;
+		if (static_cast<uint64_t>(offset) + length > file_size)
+			throw InternalError("Attempted to map beyond end of file");
+		return static_cast<char *>(full_region->get_address()) + offset;
+	}
 	return map(offset, length, read_write, file_size, file, write_region, write_mapping_start);
 }
 }
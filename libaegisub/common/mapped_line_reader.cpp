@@ -0,0 +1,56 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/mapped_line_reader.h"
+
+#include <cstring>
+
+namespace {
+inline bool is_space(char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+}
+
+namespace agi {
+mapped_line_reader::mapped_line_reader(fs::path const& filename)
+: file(filename)
+, pos(file.read())
+, end(pos + file.size())
+, done(false)
+{
+}
+
+boost::string_ref mapped_line_reader::ReadLine() {
+	auto line_end = pos == end ? nullptr : static_cast<const char *>(memchr(pos, '\n', end - pos));
+	const char *next = line_end ? line_end + 1 : end;
+	// A trailing newline (or an empty file) gives one final empty line, the
+	// same as with line_iterator
+	if (!line_end) {
+		line_end = end;
+		done = true;
+	}
+
+	const char *begin = pos;
+	pos = next;
+
+	while (begin != line_end && is_space(*begin)) ++begin;
+	while (line_end != begin && is_space(line_end[-1])) --line_end;
+	if (line_end - begin >= 3 && !memcmp(begin, "\xEF\xBB\xBF", 3))
+		begin += 3;
+
+	return boost::string_ref(begin, line_end - begin);
+}
+}
@@ -26,8 +26,9 @@
 #include <boost/interprocess/streams/bufferstream.hpp>
 #include <boost/range/algorithm.hpp>
 #include <cmath>
-#include <functional>
+#include <cstdint>
 #include <iterator>
+#include <limits>
 
 namespace {
 static const int64_t default_denominator = 1000000000;
@@ -128,6 +129,94 @@ int64_t v1_parse(line_iterator<std::string> file, std::string line, std::vector<
 	last = int64_t(time * fps * default_denominator);
 	return int64_t(fps * default_denominator);
 }
+
+/// Minimum average number of frames per segment for segments to be used
+/// rather than the list of timecodes
+const size_t min_segment_length = 16;
+
+/// Lookup hint which doesn't point at anything
+const size_t no_hint = SIZE_MAX;
+
+/// Time of the frame offset frames into a segment with the given start and step
+inline int segment_time(double start, double step, size_t offset) {
+	return int(start + offset * step + .5);
+}
+
+/// @brief Try to find a start and step which give a run of timecodes
+/// @param      times Timecodes to fit
+/// @param      len   Number of timecodes
+/// @param[out] start Start of the segment
+/// @param[out] step  Time between frames
+/// @return Does segment_time give exactly the timecodes?
+bool fit_segment(const int *times, size_t len, double &start, double &step) {
+	// A least squares fit gets close enough to the step the times were
+	// rounded from that the start just has to be within half a ms of each
+	// time less its offset
+	double n = (double)len;
+	double sum_i = n * (n - 1) / 2;
+	double sum_ii = (n - 1) * n * (2 * n - 1) / 6;
+	double sum_t = 0, sum_it = 0;
+	for (size_t i = 0; i < len; ++i) {
+		double t = times[i] - times[0];
+		sum_t += t;
+		sum_it += i * t;
+	}
+	step = len > 1 ? (n * sum_it - sum_i * sum_t) / (n * sum_ii - sum_i * sum_i) : 0;
+
+	double lo = -std::numeric_limits<double>::infinity();
+	double hi = std::numeric_limits<double>::infinity();
+	for (size_t i = 0; i < len; ++i) {
+		lo = std::max(lo, times[i] - .5 - i * step);
+		hi = std::min(hi, times[i] + .5 - i * step);
+	}
+	if (lo >= hi) return false;
+	start = (lo + hi) / 2;
+
+	for (size_t i = 0; i < len; ++i) {
+		if (segment_time(start, step, i) != times[i])
+			return false;
+	}
+	return true;
+}
+
+/// @brief Find the last entry which doesn't start after a value
+/// @param v            Entries sorted by start
+/// @param hint         Result of the previous lookup, or no_hint
+/// @param value        Value to look up, which the first entry doesn't start after
+/// @param starts_after Does an entry start after the value?
+///
+/// Sequential lookups usually land on the same or the next entry as the
+/// previous one, so those are checked before searching.
+template<typename Entry, typename Pred>
+size_t find_entry(std::vector<Entry> const& v, size_t hint, int value, Pred starts_after) {
+	if (hint < v.size() && !starts_after(value, v[hint])) {
+		if (hint + 1 == v.size() || starts_after(value, v[hint + 1]))
+			return hint;
+		if (hint + 2 == v.size() || starts_after(value, v[hint + 2]))
+			return hint + 1;
+	}
+	return std::upper_bound(v.begin(), v.end(), value, starts_after) - v.begin() - 1;
+}
+
+/// @brief Get the START or END time of a frame from EXACT times
+/// @param exact Function which returns the EXACT time of a frame
+template<typename Exact>
+int time_at_frame(int frame, Time type, Exact&& exact) {
+	if (type == START) {
+		int prev = exact(frame - 1);
+		int cur = exact(frame);
+		// + 1 as these need to round up for the case of two frames 1 ms apart
+		return prev + (cur - prev + 1) / 2;
+	}
+
+	if (type == END) {
+		int cur = exact(frame);
+		int next = exact(frame + 1);
+		return cur + (next - cur + 1) / 2;
+	}
+
+	return exact(frame);
+}
 }
 
 namespace agi { namespace vfr {
@@ -157,6 +246,57 @@ void Framerate::SetFromTimecodes() {
 	denominator = default_denominator;
 	numerator = (timecodes.size() - 1) * denominator * 1000 / timecodes.back();
 	last = (timecodes.size() - 1) * denominator * 1000;
+	BuildSegments();
+}
+
+void Framerate::BuildSegments() {
+	frame_count = (int)timecodes.size();
+	last_time = timecodes.back();
+	segments.clear();
+
+	// Take the longest run which fits starting from each frame, found by
+	// doubling the length until it doesn't fit and then bisecting
+	const size_t count = timecodes.size();
+	for (size_t first = 0; first < count; ) {
+		const int *times = &timecodes[first];
+		const size_t remaining = count - first;
+		Segment seg{(int)first, times[0], (double)times[0], 0.};
+		size_t good = 1, bad = remaining + 1;
+		double start, step;
+		while (good < remaining && bad > remaining) {
+			size_t len = std::min(good * 2, remaining);
+			if (fit_segment(times, len, start, step)) {
+				good = len;
+				seg.start = start;
+				seg.step = step;
+			}
+			else
+				bad = len;
+		}
+		while (bad <= remaining && bad - good > 1) {
+			size_t len = good + (bad - good) / 2;
+			if (fit_segment(times, len, start, step)) {
+				good = len;
+				seg.start = start;
+				seg.step = step;
+			}
+			else
+				bad = len;
+		}
+
+		segments.push_back(seg);
+		first += good;
+
+		// Too irregular to be worth it, so stick with the timecodes
+		if (segments.size() * min_segment_length > count) {
+			segments.clear();
+			segments.shrink_to_fit();
+			return;
+		}
+	}
+
+	timecodes.clear();
+	timecodes.shrink_to_fit();
 }
 
 Framerate::Framerate(std::vector<int> timecodes)
@@ -186,6 +326,7 @@ Framerate::Framerate(fs::path const& filename)
 		if (line[0] == '#')
 			line = *line_iterator<std::string>(*file, encoding);
 		numerator = v1_parse(line_iterator<std::string>(*file, encoding), line, timecodes, last);
+		BuildSegments();
 		return;
 	}
 
@@ -197,9 +338,9 @@ void Framerate::Save(fs::path const& filename, int length) const {
 	auto &out = file.Get();
 
 	out << "# timecode format v2\n";
-	boost::copy(timecodes, std::ostream_iterator<int>(out, "\n"));
-	for (int written = (int)timecodes.size(); written < length; ++written)
-		out << TimeAtFrame(written) << std::endl;
+	size_t hint = no_hint;
+	for (int frame = 0; frame < std::max(frame_count, length); ++frame)
+		out << ExactTimeAtFrame(frame, hint) << '\n';
 }
 
 int Framerate::FrameAtTime(int ms, Time type) const {
@@ -216,43 +357,78 @@ int Framerate::FrameAtTime(int ms, Time type) const {
 	// Combining these allows us to easily calculate START and END in terms of
 	// EXACT
 
+	size_t hint = no_hint;
 	if (type == START)
-		return FrameAtTime(ms - 1) + 1;
+		return ExactFrameAtTime(ms - 1, hint) + 1;
 	if (type == END)
-		return FrameAtTime(ms - 1);
+		return ExactFrameAtTime(ms - 1, hint);
+	return ExactFrameAtTime(ms, hint);
+}
 
+int Framerate::ExactFrameAtTime(int ms, size_t &hint) const {
 	if (ms < 0)
 		return int((ms * numerator / denominator - 999) / 1000);
 
-	if (ms > timecodes.back())
-		return int((ms * numerator - last + denominator - 1) / denominator / 1000) + (int)timecodes.size() - 1;
+	if (ms > last_time)
+		return int((ms * numerator - last + denominator - 1) / denominator / 1000) + frame_count - 1;
+
+	if (segments.empty()) {
+		hint = find_entry(timecodes, hint, ms, [](int ms, int time) { return ms < time; });
+		return (int)hint;
+	}
 
-	return (int)distance(lower_bound(timecodes.rbegin(), timecodes.rend(), ms, std::greater<int>()), timecodes.rend()) - 1;
+	hint = find_entry(segments, hint, ms, [](int ms, Segment const& seg) { return ms < seg.first_time; });
+	auto const& seg = segments[hint];
+	int len = (hint + 1 < segments.size() ? segments[hint + 1].first_frame : frame_count) - seg.first_frame;
+
+	// Estimate the frame from the step, then step to the last frame which
+	// starts at or before ms, which is at most a frame or two away
+	int offset = len - 1;
+	if (seg.step > 0)
+		offset = int(std::max(0., std::min<double>(offset, (ms - seg.start) / seg.step)));
+	while (offset > 0 && segment_time(seg.start, seg.step, offset) > ms)
+		--offset;
+	while (offset + 1 < len && segment_time(seg.start, seg.step, offset + 1) <= ms)
+		++offset;
+	return seg.first_frame + offset;
 }
 
-int Framerate::TimeAtFrame(int frame, Time type) const {
-	if (type == START) {
-		int prev = TimeAtFrame(frame - 1);
-		int cur = TimeAtFrame(frame);
-		// + 1 as these need to round up for the case of two frames 1 ms apart
-		return prev + (cur - prev + 1) / 2;
-	}
+void Framerate::FramesAtTimes(const int *times, int *frames, size_t count, Time type) const {
+	// START and END are EXACT for the previous ms, as in FrameAtTime
+	const int shift = type == EXACT ? 0 : -1;
+	const int add = type == START ? 1 : 0;
+	size_t hint = no_hint;
+	for (size_t i = 0; i < count; ++i)
+		frames[i] = ExactFrameAtTime(times[i] + shift, hint) + add;
+}
 
-	if (type == END) {
-		int cur = TimeAtFrame(frame);
-		int next = TimeAtFrame(frame + 1);
-		return cur + (next - cur + 1) / 2;
-	}
+int Framerate::TimeAtFrame(int frame, Time type) const {
+	size_t hint = no_hint;
+	return time_at_frame(frame, type, [&](int frame) { return ExactTimeAtFrame(frame, hint); });
+}
 
+int Framerate::ExactTimeAtFrame(int frame, size_t &hint) const {
 	if (frame < 0)
 		return (int)(frame * denominator * 1000 / numerator);
 
-	if (frame >= (signed)timecodes.size()) {
-		int64_t frames_past_end = frame - (int)timecodes.size() + 1;
+	if (frame >= frame_count) {
+		int64_t frames_past_end = frame - frame_count + 1;
 		return int((frames_past_end * 1000 * denominator + last + numerator / 2) / numerator);
 	}
 
-	return timecodes[frame];
+	if (segments.empty())
+		return timecodes[frame];
+
+	hint = find_entry(segments, hint, frame, [](int frame, Segment const& seg) { return frame < seg.first_frame; });
+	auto const& seg = segments[hint];
+	return segment_time(seg.start, seg.step, frame - seg.first_frame);
+}
+
+void Framerate::TimesAtFrames(const int *frames, int *times, size_t count, Time type) const {
+	size_t hint = no_hint;
+	auto exact = [&](int frame) { return ExactTimeAtFrame(frame, hint); };
+	for (size_t i = 0; i < count; ++i)
+		times[i] = time_at_frame(frames[i], type, exact);
 }
 
 void Framerate::SmpteAtFrame(int frame, int *h, int *m, int *s, int *f) const {
@@ -16,6 +16,18 @@
 
 #include "libaegisub/ycbcr_conv.h"
 
+#include "libaegisub/cpu.h"
+#include "libaegisub/dispatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifdef AGI_CPU_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
 namespace {
 double matrix_coefficients[][3] = {
 	{.299, .587, .114},    // BT.601
@@ -40,6 +52,205 @@ void col_mult(std::array<double, 9>& m, std::array<double, 3> v) {
 		m[6] * v[0], m[7] * v[1], m[8] * v[2],
 	}};
 }
+
+// Whole images are converted with fixed-point arithmetic: each channel is
+// (c_y * Y + c_cb * Cb + c_cr * Cr + offset) >> shift in 32-bit integers, with
+// samples of at most 12 bits and coefficients which are the matrix scaled by
+// 2^13. The SIMD versions do exactly the same math with pmaddwd, so all of
+// the versions give the same results.
+//
+// Each row is first loaded into 16-bit rows of Y, Cb and Cr at full width, so
+// that the conversion itself doesn't have to care about the bit depth or
+// chroma subsampling.
+
+/// Fixed-point version of a conversion matrix for one bit depth
+struct fixed_matrix {
+	/// Coefficients of Y, Cb and Cr for each output channel, in the order the
+	/// channels are stored (blue, green, red)
+	int16_t coeff[3][3];
+	/// Includes the shift of the inputs and the rounding
+	int32_t offset[3];
+	int shift;
+};
+
+/// Bits kept from each sample; anything more can't affect 8-bit results
+const int max_precision = 12;
+
+fixed_matrix make_fixed_matrix(std::array<double, 9> const& m, std::array<double, 3> const& shift, int bit_depth) {
+	int precision = std::min(bit_depth, max_precision);
+	fixed_matrix f;
+	f.shift = 13 + precision - 8;
+	for (int c = 0; c < 3; ++c) {
+		// The matrix's rows are red, green, blue
+		const double *row = &m[(2 - c) * 3];
+		// The shifts are whole numbers, so applying them to the rounded
+		// coefficients makes neutral chroma cancel out exactly
+		f.offset[c] = 1 << (f.shift - 1);
+		for (int i = 0; i < 3; ++i) {
+			f.coeff[c][i] = static_cast<int16_t>(std::lround(row[i] * 8192));
+			f.offset[c] += f.coeff[c][i] * static_cast<int32_t>(std::lround(shift[i] * (1 << (precision - 8))));
+		}
+	}
+	return f;
+}
+
+/// Load a row of samples, repeating each one 1 << shift_x times
+void load_row(const uint8_t *src, int bit_depth, int shift_x, int width, int16_t *dst) {
+	if (bit_depth == 8) {
+		for (int x = 0; x < width; ++x)
+			dst[x] = src[x >> shift_x];
+		return;
+	}
+
+	// Samples deeper than max_precision are rounded to it rather than
+	// truncated, as dropping the low bits biases every channel downwards
+	int drop = std::max(bit_depth - max_precision, 0);
+	int round = drop ? 1 << (drop - 1) : 0;
+	int mask = (1 << bit_depth) - 1;
+	int max_value = (1 << (bit_depth - drop)) - 1;
+	for (int x = 0; x < width; ++x) {
+		int i = (x >> shift_x) * 2;
+		int v = ((src[i] | src[i + 1] << 8) & mask) + round;
+		dst[x] = static_cast<int16_t>(std::min(v >> drop, max_value));
+	}
+}
+
+void convert_row_scalar(const int16_t *y, const int16_t *cb, const int16_t *cr, uint8_t *dst, int width, fixed_matrix const& m) {
+	for (int x = 0; x < width; ++x, dst += 4) {
+		for (int c = 0; c < 3; ++c) {
+			int32_t v = (m.coeff[c][0] * y[x] + m.coeff[c][1] * cb[x] + m.coeff[c][2] * cr[x] + m.offset[c]) >> m.shift;
+			dst[c] = static_cast<uint8_t>(v < 0 ? 0 : v > 255 ? 255 : v);
+		}
+		dst[3] = 0;
+	}
+}
+
+#ifdef AGI_CPU_X86
+/// Pair of coefficients to multiply interleaved 16-bit values by with pmaddwd
+inline int32_t coeff_pair(int16_t lo, int16_t hi) {
+	return static_cast<int32_t>(static_cast<uint16_t>(lo) | static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16);
+}
+
+AGI_TARGET("sse2")
+inline __m128i channel_sse2(__m128i y_cb, __m128i cr, __m128i c_ycb, __m128i c_cr, __m128i offset, __m128i shift) {
+	__m128i sum = _mm_add_epi32(_mm_madd_epi16(y_cb, c_ycb), _mm_madd_epi16(cr, c_cr));
+	return _mm_sra_epi32(_mm_add_epi32(sum, offset), shift);
+}
+
+AGI_TARGET("sse2")
+void convert_row_sse2(const int16_t *y, const int16_t *cb, const int16_t *cr, uint8_t *dst, int width, fixed_matrix const& m) {
+	__m128i c_ycb[3], c_cr[3], offset[3];
+	for (int c = 0; c < 3; ++c) {
+		c_ycb[c] = _mm_set1_epi32(coeff_pair(m.coeff[c][0], m.coeff[c][1]));
+		c_cr[c] = _mm_set1_epi32(coeff_pair(m.coeff[c][2], 0));
+		offset[c] = _mm_set1_epi32(m.offset[c]);
+	}
+	const __m128i shift = _mm_cvtsi32_si128(m.shift);
+	const __m128i zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 8 <= width; x += 8) {
+		__m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+		__m128i vcb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cb + x));
+		__m128i vcr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cr + x));
+		__m128i y_cb_lo = _mm_unpacklo_epi16(vy, vcb), y_cb_hi = _mm_unpackhi_epi16(vy, vcb);
+		__m128i cr_lo = _mm_unpacklo_epi16(vcr, zero), cr_hi = _mm_unpackhi_epi16(vcr, zero);
+
+		__m128i channels[3];
+		for (int c = 0; c < 3; ++c) {
+			__m128i lo = channel_sse2(y_cb_lo, cr_lo, c_ycb[c], c_cr[c], offset[c], shift);
+			__m128i hi = channel_sse2(y_cb_hi, cr_hi, c_ycb[c], c_cr[c], offset[c], shift);
+			channels[c] = _mm_packus_epi16(_mm_packs_epi32(lo, hi), zero);
+		}
+
+		__m128i bg = _mm_unpacklo_epi8(channels[0], channels[1]);
+		__m128i r0 = _mm_unpacklo_epi8(channels[2], zero);
+		auto out = reinterpret_cast<__m128i *>(dst + x * 4);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(bg, r0));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg, r0));
+	}
+	convert_row_scalar(y + x, cb + x, cr + x, dst + x * 4, width - x, m);
+}
+
+AGI_TARGET("avx2")
+inline __m256i channel_avx2(__m256i y_cb, __m256i cr, __m256i c_ycb, __m256i c_cr, __m256i offset, __m128i shift) {
+	__m256i sum = _mm256_add_epi32(_mm256_madd_epi16(y_cb, c_ycb), _mm256_madd_epi16(cr, c_cr));
+	return _mm256_sra_epi32(_mm256_add_epi32(sum, offset), shift);
+}
+
+AGI_TARGET("avx2")
+void convert_row_avx2(const int16_t *y, const int16_t *cb, const int16_t *cr, uint8_t *dst, int width, fixed_matrix const& m) {
+	__m256i c_ycb[3], c_cr[3], offset[3];
+	for (int c = 0; c < 3; ++c) {
+		c_ycb[c] = _mm256_set1_epi32(coeff_pair(m.coeff[c][0], m.coeff[c][1]));
+		c_cr[c] = _mm256_set1_epi32(coeff_pair(m.coeff[c][2], 0));
+		offset[c] = _mm256_set1_epi32(m.offset[c]);
+	}
+	const __m128i shift = _mm_cvtsi32_si128(m.shift);
+	const __m256i zero = _mm256_setzero_si256();
+
+	// The unpacks work within each 128-bit lane, so everything is in two
+	// halves of eight pixels until the pixels are put back in order at the end
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + x));
+		__m256i vcb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cb + x));
+		__m256i vcr = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cr + x));
+		__m256i y_cb_lo = _mm256_unpacklo_epi16(vy, vcb), y_cb_hi = _mm256_unpackhi_epi16(vy, vcb);
+		__m256i cr_lo = _mm256_unpacklo_epi16(vcr, zero), cr_hi = _mm256_unpackhi_epi16(vcr, zero);
+
+		__m256i channels[3];
+		for (int c = 0; c < 3; ++c) {
+			__m256i lo = channel_avx2(y_cb_lo, cr_lo, c_ycb[c], c_cr[c], offset[c], shift);
+			__m256i hi = channel_avx2(y_cb_hi, cr_hi, c_ycb[c], c_cr[c], offset[c], shift);
+			channels[c] = _mm256_packus_epi16(_mm256_packs_epi32(lo, hi), zero);
+		}
+
+		__m256i bg = _mm256_unpacklo_epi8(channels[0], channels[1]);
+		__m256i r0 = _mm256_unpacklo_epi8(channels[2], zero);
+		__m256i lo = _mm256_unpacklo_epi16(bg, r0);
+		__m256i hi = _mm256_unpackhi_epi16(bg, r0);
+		auto out = reinterpret_cast<__m256i *>(dst + x * 4);
+		_mm256_storeu_si256(out, _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	convert_row_sse2(y + x, cb + x, cr + x, dst + x * 4, width - x, m);
+}
+#endif
+
+typedef void (*convert_row_fn)(const int16_t *, const int16_t *, const int16_t *, uint8_t *, int, fixed_matrix const&);
+
+convert_row_fn select_convert_row() {
+#ifdef AGI_CPU_X86
+	if (agi::cpu::HasAVX2()) return convert_row_avx2;
+	if (agi::cpu::HasSSE2()) return convert_row_sse2;
+#endif
+	return convert_row_scalar;
+}
+
+/// Rows converted by each background job
+const int rows_per_job = 32;
+/// Images smaller than this many pixels aren't worth splitting between threads
+const int min_parallel_pixels = 1 << 20;
+
+void convert_rows(agi::ycbcr_planar_image const& src, fixed_matrix const& matrix, uint8_t *dst, ptrdiff_t dst_stride, int first, int last) {
+	static const auto convert_row = select_convert_row();
+
+	int width = src.width;
+	std::vector<int16_t> buffer(width * 3);
+	int16_t *y = &buffer[0], *cb = y + width, *cr = cb + width;
+
+	int chroma_row = -1;
+	for (int row = first; row < last; ++row) {
+		load_row(src.planes[0] + row * src.strides[0], src.bit_depth, 0, width, y);
+		if (row >> src.chroma_shift_y != chroma_row) {
+			chroma_row = row >> src.chroma_shift_y;
+			load_row(src.planes[1] + chroma_row * src.strides[1], src.bit_depth, src.chroma_shift_x, width, cb);
+			load_row(src.planes[2] + chroma_row * src.strides[2], src.bit_depth, src.chroma_shift_x, width, cr);
+		}
+		convert_row(y, cb, cr, dst + row * dst_stride, width, matrix);
+	}
+}
 }
 
 namespace agi {
@@ -94,5 +305,19 @@ ycbcr_converter::ycbcr_converter(ycbcr_matrix src_mat, ycbcr_range src_range, yc
 	init_src(src_mat, src_range);
 	init_dst(dst_mat, dst_range);
 }
+
+void ycbcr_converter::planar_to_bgrx(ycbcr_planar_image const& src, uint8_t *dst, ptrdiff_t dst_stride) const {
+	if (src.width <= 0 || src.height <= 0) return;
+
+	auto matrix = make_fixed_matrix(from_ycbcr, shift_from, src.bit_depth);
+
+	if (src.width * src.height < min_parallel_pixels)
+		return convert_rows(src, matrix, dst, dst_stride, 0, src.height);
+
+	dispatch::ParallelFor((src.height + rows_per_job - 1) / rows_per_job, [&](size_t job) {
+		int first = static_cast<int>(job) * rows_per_job;
+		convert_rows(src, matrix, dst, dst_stride, first, std::min(src.height, first + rows_per_job));
+	});
+}
 }
 
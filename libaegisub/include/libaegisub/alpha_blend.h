@@ -0,0 +1,51 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+/// @file alpha_blend.h
+/// @brief Blending of solid colors through coverage masks, as produced by
+///        subtitle renderers
+/// @ingroup libaegisub
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace agi {
+	/// Blend a solid color onto a BGRX image through an 8-bit coverage mask
+	///
+	/// Each channel of each pixel becomes (k * color + (255 - k) * pixel) / 255,
+	/// where k is mask * opacity / 255 and both divisions round down. The X
+	/// byte of every pixel in the blended area is set to zero.
+	///
+	/// Uses the fastest implementation supported by the CPU, all of which
+	/// produce identical results.
+	///
+	/// @param dst First pixel of the area to blend onto
+	/// @param dst_stride Distance in bytes between rows of dst; may be negative
+	/// @param mask Coverage mask of width * height bytes
+	/// @param mask_stride Distance in bytes between rows of mask
+	/// @param width Width in pixels of the area to blend
+	/// @param height Height in pixels of the area to blend
+	/// @param r Red component of the color to blend
+	/// @param g Green component of the color to blend
+	/// @param b Blue component of the color to blend
+	/// @param opacity Opacity of the color, with 255 being fully opaque
+	void BlendMask(uint8_t *dst, ptrdiff_t dst_stride,
+	               const uint8_t *mask, ptrdiff_t mask_stride,
+	               int width, int height,
+	               uint8_t r, uint8_t g, uint8_t b, uint8_t opacity);
+}
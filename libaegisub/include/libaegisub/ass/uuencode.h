@@ -21,6 +21,21 @@ namespace agi { namespace ass {
 /// Encode a blob of data, using ASS's nonstandard variant
 std::string UUEncode(const char *begin, const char *end, bool insert_linebreaks=true);
 
+/// Encode a blob of data, appending the result to out
+///
+/// Lines are wrapped as if out's last line had been encoded in the same call,
+/// so a blob can be encoded in pieces which are each a multiple of three
+/// bytes long (other than the last) with the same result as encoding it all
+/// at once.
+void UUEncode(const char *begin, const char *end, std::string &out, bool insert_linebreaks=true);
+
 /// Decode an ASS uuencoded string
 std::vector<char> UUDecode(const char *begin, const char *end);
+
+/// Decode an ASS uuencoded string, appending the result to out
+///
+/// A string can be decoded in pieces which each contain a multiple of four
+/// encoded characters (other than the last), such as one line at a time,
+/// with the same result as decoding it all at once.
+void UUDecode(const char *begin, const char *end, std::vector<char> &out);
 } }
@@ -0,0 +1,112 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/fs_fwd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace agi {
+/// Summary of the samples in a range of mono 16-bit audio
+struct AudioPeak {
+	/// Most negative sample in the range
+	int16_t min = 0;
+	/// Most positive sample in the range
+	int16_t max = 0;
+	/// Sum of the negative samples divided by the number of samples
+	int16_t avg_min = 0;
+	/// Sum of the positive samples divided by the number of samples
+	int16_t avg_max = 0;
+};
+
+/// @class AudioPeakIndex
+/// @brief Mipmapped min/max/average summary of mono 16-bit audio
+///
+/// Level zero summarizes blocks of 2^BucketBits samples, and each level above
+/// that summarizes 2^LevelBits buckets of the level below it, so a range of
+/// any length can be summarized by reading a small constant number of
+/// buckets.
+///
+/// The index is filled in order by a single writer (normally the decoder
+/// thread of one of the caching audio providers) and may be read from any
+/// number of threads at the same time; readers only see the buckets which
+/// have been completely written.
+class AudioPeakIndex {
+	std::vector<std::vector<AudioPeak>> levels;
+	int64_t num_samples;
+
+	/// Number of samples which have been fed to Add
+	std::atomic<int64_t> indexed_samples{0};
+
+	/// Partial summary of the level zero bucket currently being filled
+	int16_t cur_min = 0;
+	int16_t cur_max = 0;
+	int64_t cur_neg = 0;
+	int64_t cur_pos = 0;
+
+	static int Shift(size_t level) { return BucketBits + LevelBits * (int)level; }
+	int64_t BucketSamples(size_t level, size_t bucket) const;
+	void Combine(size_t level, size_t bucket);
+	void EmitBucket(size_t bucket, int64_t count);
+
+public:
+	/// log2 of the number of samples in a level zero bucket
+	static const int BucketBits = 8;
+	/// log2 of the number of buckets combined into each bucket of the next level
+	static const int LevelBits = 2;
+
+	/// @param num_samples Total number of samples which will be indexed
+	AudioPeakIndex(int64_t num_samples);
+
+	/// Append samples to the index
+	/// @param samples Mono 16-bit samples immediately following the last ones added
+	/// @param count Number of samples in the buffer
+	///
+	/// Samples past the end of the audio, including any added after the
+	/// index is complete, are ignored.
+	void Add(const int16_t *samples, int64_t count);
+
+	/// Get the number of samples which have been indexed so far
+	int64_t GetIndexedSamples() const { return indexed_samples; }
+
+	/// Is the entire audio stream indexed?
+	bool IsComplete() const { return indexed_samples == num_samples; }
+
+	/// Get a summary of a range of samples
+	/// @param start First sample of the range
+	/// @param count Number of samples in the range
+	/// @param[out] out Summary of the range
+	/// @return Was the index able to answer the query?
+	///
+	/// Ranges shorter than a level zero bucket or not yet indexed can't be
+	/// answered and need to be computed from the audio itself. Range
+	/// boundaries are rounded to the nearest bucket of the level used.
+	bool Get(int64_t start, int64_t count, AudioPeak &out) const;
+
+	/// Write a complete index to a file
+	void Save(fs::path const& filename) const;
+
+	/// Read an index written by Save
+	/// @param filename File to read from
+	/// @param num_samples Expected number of samples in the indexed audio
+	/// @return The index, or nullptr if the file is missing, corrupt or for a different length of audio
+	static std::unique_ptr<AudioPeakIndex> Load(fs::path const& filename, int64_t num_samples);
+};
+}
@@ -23,6 +23,8 @@
 #include <vector>
 
 namespace agi {
+class AudioPeakIndex;
+
 class AudioProvider {
 protected:
 	int channels = 0;
@@ -34,6 +36,9 @@ protected:
 	int sample_rate = 0;
 	int bytes_per_sample = 0;
 	bool float_samples = false;
+	/// Which of the source file's audio tracks this is, for providers which
+	/// can open files with more than one
+	int track = 0;
 
 	virtual void FillBuffer(void *buf, int64_t start, int64_t count) const = 0;
 
@@ -45,15 +50,30 @@ public:
 	void GetAudio(void *buf, int64_t start, int64_t count) const;
 	void GetAudioWithVolume(void *buf, int64_t start, int64_t count, double volume) const;
 
+	/// Get audio as mono 16-bit samples regardless of the native format
+	///
+	/// Converting and downmixing are done in a single pass, so this is
+	/// cheaper than using a converting provider for consumers which only need
+	/// mono audio. Only works on 16-bit, float or double audio.
+	void GetInt16MonoAudio(int16_t *buf, int64_t start, int64_t count) const;
+	void GetInt16MonoAudioWithVolume(int16_t *buf, int64_t start, int64_t count, double volume) const;
+
 	int64_t GetNumSamples()     const { return num_samples; }
 	int64_t GetDecodedSamples() const { return decoded_samples; }
 	int     GetSampleRate()     const { return sample_rate; }
 	int     GetBytesPerSample() const { return bytes_per_sample; }
 	int     GetChannels()       const { return channels; }
 	bool    AreSamplesFloat()   const { return float_samples; }
+	int     GetTrack()          const { return track; }
 
 	/// Does this provider benefit from external caching?
 	virtual bool NeedsCache() const { return false; }
+
+	/// Get the peak index for this provider's audio, if it maintains one
+	///
+	/// The index may still be in the process of being built, and is only
+	/// valid for as long as the provider is.
+	virtual AudioPeakIndex const* GetPeakIndex() const { return nullptr; }
 };
 
 /// Helper base class for an audio provider which wraps another provider
@@ -70,6 +90,7 @@ public:
 		sample_rate = source->GetSampleRate();
 		bytes_per_sample = source->GetBytesPerSample();
 		float_samples = source->AreSamplesFloat();
+		track = source->GetTrack();
 	}
 };
 
@@ -86,10 +107,26 @@ class BackgroundRunner;
 std::unique_ptr<AudioProvider> CreateDummyAudioProvider(fs::path const& filename, BackgroundRunner *);
 std::unique_ptr<AudioProvider> CreatePCMAudioProvider(fs::path const& filename, BackgroundRunner *);
 
+/// Wrap a provider with converters to give either 16-bit integer or float
+/// audio at 32 kHz or higher, with the original number of channels
 std::unique_ptr<AudioProvider> CreateConvertAudioProvider(std::unique_ptr<AudioProvider> source_provider);
 std::unique_ptr<AudioProvider> CreateLockAudioProvider(std::unique_ptr<AudioProvider> source_provider);
+
+/// The caching providers decode the source on a background thread, and can
+/// be read from any number of threads at once without locking. Audio which
+/// has not been decoded yet reads as silence.
 std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& dir);
 std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider);
+/// Like the RAM cache, but with each block losslessly compressed and only a
+/// few recently read blocks kept decompressed. Readers briefly lock the list
+/// of decompressed blocks, but do not wait for each other's decompression.
+std::unique_ptr<AudioProvider> CreateCompressedRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider);
+
+/// Create a caching provider whose peak index is loaded from peak_cache if it
+/// exists, and written there once it has been built otherwise
+std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& dir, fs::path const& peak_cache);
+std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& peak_cache);
+std::unique_ptr<AudioProvider> CreateCompressedRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& peak_cache);
 
 void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time);
 }
@@ -0,0 +1,46 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+/// @file cpu.h
+/// @brief Runtime detection of CPU features for picking SIMD code paths
+/// @ingroup libaegisub
+
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+/// Defined when building for a CPU which may have the x86 SIMD extensions
+#define AGI_CPU_X86 1
+#endif
+
+#ifdef AGI_CPU_X86
+#ifdef __GNUC__
+/// Allow a function to use instructions from the given extension, regardless
+/// of what the rest of the translation unit is compiled for. Functions with
+/// this must only be called after checking that the CPU supports it.
+#define AGI_TARGET(extension) __attribute__((target(extension)))
+#else
+// MSVC allows using any intrinsics anywhere
+#define AGI_TARGET(extension)
+#endif
+#endif
+
+namespace agi { namespace cpu {
+	/// Does the CPU support SSE2?
+	bool HasSSE2();
+
+	/// Do the CPU and OS both support AVX2?
+	bool HasAVX2();
+} }
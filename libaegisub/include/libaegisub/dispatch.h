@@ -14,6 +14,7 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 
@@ -46,5 +47,14 @@ namespace agi {
 
 		/// Create a new serial queue
 		std::unique_ptr<Queue> Create();
+
+		/// Call job once for each index in [0, count), spreading the calls
+		/// over the background queue and returning when they're all done
+		///
+		/// The calling thread runs jobs as well, so this makes progress even
+		/// when every background thread is busy (or is the caller). If any
+		/// job throws, the exception from the lowest index is rethrown here
+		/// after the remaining jobs have finished.
+		void ParallelFor(size_t count, std::function<void (size_t)> job);
 	}
 }
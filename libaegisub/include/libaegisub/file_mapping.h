@@ -14,10 +14,13 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#pragma once
+
 #include <libaegisub/fs_fwd.h>
 
 #include <boost/interprocess/detail/os_file_functions.hpp>
 #include <cstdint>
+#include <memory>
 
 namespace agi {
 	// boost::interprocess::file_mapping is awesome and uses CreateFileA on Windows
@@ -47,12 +50,19 @@ namespace agi {
 		const char *read(); // Map the entire file
 	};
 
+	/// A temporary file which is deleted when closed
+	///
+	/// When the address space is large enough the entire file is mapped up
+	/// front, and otherwise each read maps its own window. In either case
+	/// read() is thread-safe with respect to other calls to read() and to
+	/// writes to other parts of the file.
 	class temp_file_mapping {
 		file_mapping file;
 		uint64_t file_size = 0;
 
-		std::unique_ptr<boost::interprocess::mapped_region> read_region;
-		uint64_t read_mapping_start = 0;
+		/// Mapping of the entire file, if it fits in the address space
+		std::unique_ptr<boost::interprocess::mapped_region> full_region;
+
 		std::unique_ptr<boost::interprocess::mapped_region> write_region;
 		uint64_t write_mapping_start = 0;
 
@@ -60,7 +70,10 @@ namespace agi {
 		temp_file_mapping(fs::path const& filename, uint64_t size);
 		~temp_file_mapping();
 
-		const char *read(int64_t offset, uint64_t length);
+		/// Copy length bytes starting at offset to dst
+		void read(int64_t offset, uint64_t length, void *dst) const;
+
+		/// Get a pointer to write to. Not thread-safe with other writes.
 		char *write(int64_t offset, uint64_t length);
 	};
 }
@@ -0,0 +1,53 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+/// @file mapped_line_reader.h
+/// @brief Reading lines of a UTF-8 file without copying them
+/// @ingroup libaegisub
+
+#pragma once
+
+#include <libaegisub/file_mapping.h>
+
+#include <boost/utility/string_ref.hpp>
+
+namespace agi {
+	/// @class mapped_line_reader
+	/// @brief Reads the lines of a UTF-8 or ASCII file straight out of a
+	///        mapping of the file
+	///
+	/// Lines are split on LF and have leading and trailing whitespace and a
+	/// leading byte order mark removed, so the lines returned are the same as
+	/// a line_iterator over the file would give after trimming them. Unlike
+	/// line_iterator, no conversion is done and nothing is copied: the
+	/// returned lines point into the mapping and are valid for as long as the
+	/// reader is.
+	class mapped_line_reader {
+		read_file_mapping file;
+		const char *pos;
+		const char *end;
+		bool done;
+
+	public:
+		mapped_line_reader(fs::path const& filename);
+
+		bool HasMoreLines() const { return !done; }
+
+		/// Get the next line of the file
+		/// Only valid to call when HasMoreLines() is true
+		boost::string_ref ReadLine();
+	};
+}
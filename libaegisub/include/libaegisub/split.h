@@ -15,6 +15,7 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include <boost/range/iterator_range.hpp>
+#include <iterator>
 
 namespace agi {
 	typedef boost::iterator_range<std::string::const_iterator> StringRange;
@@ -25,7 +26,7 @@ namespace agi {
 		Iterator b;
 		Iterator cur;
 		Iterator e;
-		typename Iterator::value_type c;
+		typename std::iterator_traits<Iterator>::value_type c;
 
 	public:
 		using iterator_category = std::forward_iterator_tag;
@@ -34,7 +35,7 @@ namespace agi {
 		using reference = value_type&;
 		using difference_type = ptrdiff_t;
 
-		split_iterator(Iterator begin, Iterator end, typename Iterator::value_type c)
+		split_iterator(Iterator begin, Iterator end, typename std::iterator_traits<Iterator>::value_type c)
 		: b(begin), cur(begin), e(end), c(c)
 		{
 			if (b != e)
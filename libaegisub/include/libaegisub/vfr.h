@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -67,14 +68,43 @@ class Framerate {
 	/// rounding past the end of the final override range.
 	int64_t last = 0;
 
-	/// Start time in milliseconds of each frame
+	/// A run of frames with evenly spaced start times, which are
+	/// int(start + (frame - first_frame) * step + .5)
+	struct Segment {
+		int first_frame;
+		/// Start time of first_frame, for finding the segment for a time
+		int first_time;
+		double start;
+		double step;
+	};
+
+	/// Start time in milliseconds of each frame, if the times are too
+	/// irregular to be described by segments
 	std::vector<int> timecodes;
+	/// Runs of evenly spaced frames covering every frame with a timecode,
+	/// used instead of timecodes when there's few enough of them
+	std::vector<Segment> segments;
+	/// Number of frames with timecodes
+	int frame_count = 1;
+	/// Start time in milliseconds of the last frame with a timecode
+	int last_time = 0;
 
 	/// Does this frame rate need drop frames and have them enabled?
 	bool drop = false;
 
 	/// Set FPS properties from the timecodes vector
 	void SetFromTimecodes();
+	/// Set frame_count and last_time from the timecodes vector, and replace
+	/// it with segments if the times are regular enough
+	void BuildSegments();
+
+	/// FrameAtTime(ms, EXACT)
+	/// @param[in,out] hint Position in timecodes or segments of the last
+	///                     lookup, which is checked first
+	int ExactFrameAtTime(int ms, size_t &hint) const;
+	/// TimeAtFrame(frame, EXACT)
+	/// @param[in,out] hint Position in segments of the last lookup
+	int ExactTimeAtFrame(int frame, size_t &hint) const;
 public:
 	Framerate(Framerate const&) = default;
 	Framerate& operator=(Framerate const&) = default;
@@ -134,6 +164,26 @@ public:
 	/// results for all frame numbers
 	int TimeAtFrame(int frame, Time type = EXACT) const;
 
+	/// @brief Get the frames for several times
+	/// @param times Times in milliseconds
+	/// @param[out] frames Frame for each time
+	/// @param count Number of times
+	/// @param type Time mode
+	///
+	/// Gives the same results as calling FrameAtTime on each time, but is
+	/// faster when the times are mostly in ascending order.
+	void FramesAtTimes(const int *times, int *frames, size_t count, Time type = EXACT) const;
+
+	/// @brief Get the times for several frames
+	/// @param frames Frame numbers
+	/// @param[out] times Time for each frame
+	/// @param count Number of frames
+	/// @param type Time mode
+	///
+	/// Gives the same results as calling TimeAtFrame on each frame, but is
+	/// faster when the frames are mostly in ascending order.
+	void TimesAtFrames(const int *frames, int *times, size_t count, Time type = EXACT) const;
+
 	/// @brief Get the components of the SMPTE timecode for the given time
 	/// @param[out] h Hours component
 	/// @param[out] m Minutes component
@@ -193,7 +243,7 @@ public:
 	void Save(fs::path const& file, int length = -1) const;
 
 	/// Is this frame rate possibly variable?
-	bool IsVFR() const {return timecodes.size() > 1; }
+	bool IsVFR() const { return frame_count > 1; }
 
 	/// Does this represent a valid frame rate?
 	bool IsLoaded() const { return numerator > 0; }
@@ -15,6 +15,7 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 #include <libaegisub/color.h>
@@ -32,6 +33,24 @@ enum class ycbcr_range {
 	pc
 };
 
+/// A YCbCr image with each component in a separate plane
+struct ycbcr_planar_image {
+	/// Y, Cb and Cr planes. Samples are bytes for a bit depth of 8 and
+	/// little-endian 16-bit values for anything higher.
+	const uint8_t *planes[3];
+	/// Distance in bytes between rows of each plane. May be zero to use the
+	/// same row for every row of the image.
+	ptrdiff_t strides[3];
+	int width;
+	int height;
+	/// log2 of the horizontal and vertical chroma subsampling, e.g. 1 and 1
+	/// for 4:2:0, 1 and 0 for 4:2:2 and 0 and 0 for 4:4:4
+	int chroma_shift_x;
+	int chroma_shift_y;
+	/// Bits per sample, from 8 to 16
+	int bit_depth;
+};
+
 /// A converter between YCbCr colorspaces and RGB
 class ycbcr_converter {
 	std::array<double, 9> from_ycbcr;
@@ -91,6 +110,19 @@ public:
 		auto arr = rgb_to_rgb(std::array<uint8_t, 3>{{c.r, c.g, c.b}});
 		return Color{arr[0], arr[1], arr[2], c.a};
 	}
+
+	/// Convert a whole image from src_mat/src_range to BGRX, with the X byte
+	/// of each pixel set to zero
+	///
+	/// Chroma is upsampled by repeating each sample. This uses fixed-point
+	/// arithmetic, so each channel may be one off from what ycbcr_to_rgb
+	/// gives, but the results don't depend on which SIMD extensions the CPU
+	/// has. Large images are split between the background threads.
+	///
+	/// @param src Image to convert
+	/// @param dst First row of the destination image
+	/// @param dst_stride Distance in bytes between rows of dst
+	void planar_to_bgrx(ycbcr_planar_image const& src, uint8_t *dst, ptrdiff_t dst_stride) const;
 };
 }
 
@@ -21,19 +21,32 @@
 #include <libaegisub/io.h>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <mutex>
+
+struct AssAttachment::Contents {
+	std::string entry_data;
+
+	std::once_flag decode_once;
+	std::vector<char> decoded;
+
+	std::once_flag hash_once;
+	size_t hash = 0;
+};
 
 // Out-of-line to anchor vtable
 AssEntryGroup AssAttachment::Group() const { return group; }
 
 AssAttachment::AssAttachment(std::string const& header, AssEntryGroup group)
-: entry_data(header + "\r\n")
+: contents(std::make_shared<Contents>())
 , filename(header.substr(10))
 , group(group)
 {
+	contents->entry_data = header + "\r\n";
 }
 
 AssAttachment::AssAttachment(agi::fs::path const& name, AssEntryGroup group)
-: filename(name.filename().string())
+: contents(std::make_shared<Contents>())
+, filename(name.filename().string())
 , group(group)
 {
 	// SSA stuffs some information about the font in the embedded filename, but
@@ -43,19 +56,45 @@ AssAttachment::AssAttachment(agi::fs::path const& name, AssEntryGroup group)
 
 	agi::read_file_mapping file(name);
 	auto buff = file.read();
-	entry_data = (group == AssEntryGroup::FONT ? "fontname: " : "filename: ") + filename.get() + "\r\n";
-	entry_data = entry_data.get() + agi::ass::UUEncode(buff, buff + file.size());
+	contents->entry_data = (group == AssEntryGroup::FONT ? "fontname: " : "filename: ") + filename.get() + "\r\n";
+	agi::ass::UUEncode(buff, buff + file.size(), contents->entry_data);
+}
+
+void AssAttachment::AddData(boost::string_ref data) {
+	auto& entry_data = contents->entry_data;
+	entry_data.append(data.begin(), data.end());
+	entry_data += "\r\n";
+}
+
+std::string const& AssAttachment::GetEntryData() const {
+	return contents->entry_data;
 }
 
 size_t AssAttachment::GetSize() const {
-	auto header_end = entry_data.get().find('\n');
-	return entry_data.get().size() - header_end - 1;
+	auto header_end = contents->entry_data.find('\n');
+	return contents->entry_data.size() - header_end - 1;
+}
+
+std::vector<char> const& AssAttachment::GetData() const {
+	auto& c = *contents;
+	std::call_once(c.decode_once, [&] {
+		auto header_end = c.entry_data.find('\n');
+		agi::ass::UUDecode(c.entry_data.c_str() + header_end + 1, &c.entry_data.back() + 1, c.decoded);
+	});
+	return c.decoded;
+}
+
+size_t AssAttachment::GetHash() const {
+	auto& c = *contents;
+	std::call_once(c.hash_once, [&] {
+		c.hash = std::hash<std::string>()(c.entry_data);
+	});
+	return c.hash;
 }
 
 void AssAttachment::Extract(agi::fs::path const& filename) const {
-	auto header_end = entry_data.get().find('\n');
-	auto decoded = agi::ass::UUDecode(entry_data.get().c_str() + header_end + 1, &entry_data.get().back() + 1);
-	agi::io::Save(filename, true).Get().write(&decoded[0], decoded.size());
+	auto const& decoded = GetData();
+	agi::io::Save(filename, true).Get().write(decoded.data(), decoded.size());
 }
 
 std::string AssAttachment::GetFileName(bool raw) const {
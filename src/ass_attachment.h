@@ -19,11 +19,18 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <boost/flyweight.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <memory>
+#include <vector>
 
 /// @class AssAttachment
 class AssAttachment final : public AssEntry {
-	/// ASS uuencoded entry data, including header.
-	boost::flyweight<std::string> entry_data;
+	struct Contents;
+
+	/// ASS uuencoded entry data, including header, and the decoded file.
+	/// Shared by all copies of the attachment and not modified after the
+	/// attachment is read other than to decode it the first time it's needed.
+	std::shared_ptr<Contents> contents;
 
 	/// Name of the attached file, with SSA font mangling if it is a ttf
 	boost::flyweight<std::string> filename;
@@ -35,7 +42,16 @@ public:
 	size_t GetSize() const;
 
 	/// Add a line of data (without newline) read from a subtitle file
-	void AddData(std::string const& data) { entry_data = entry_data.get() + data + "\r\n"; }
+	///
+	/// Only valid while the attachment is being read, before it's copied.
+	void AddData(boost::string_ref data);
+
+	/// Get the decoded contents of the attached file
+	std::vector<char> const& GetData() const;
+
+	/// Get a hash of the contents of the attached file, which like the
+	/// decoded contents is calculated once and shared by all copies
+	size_t GetHash() const;
 
 	/// Extract the contents of this attachment to a file
 	/// @param filename Path to save the attachment to
@@ -45,7 +61,7 @@ public:
 	/// @param raw If false, remove the SSA filename mangling
 	std::string GetFileName(bool raw=false) const;
 
-	std::string const& GetEntryData() const { return entry_data; }
+	std::string const& GetEntryData() const;
 	AssEntryGroup Group() const override;
 
 	AssAttachment(AssAttachment const& rgt) = default;
@@ -46,6 +46,9 @@
 #include <boost/regex.hpp>
 #include <boost/spirit/include/karma_generate.hpp>
 #include <boost/spirit/include/karma_int.hpp>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 using namespace boost::adaptors;
 
@@ -64,42 +67,55 @@ AssDialogue::AssDialogue(AssDialogue const& that)
 
 AssDialogue::AssDialogue(AssDialogueBase const& that) : AssDialogueBase(that) { }
 
-AssDialogue::AssDialogue(std::string const& data) {
+AssDialogue::AssDialogue(boost::string_ref data) {
 	Id = ++next_id;
 	Parse(data);
 }
 
+AssDialogue::AssDialogue(boost::string_ref data, int id) {
+	Id = id;
+	Parse(data);
+}
+
+int AssDialogue::ReserveIds(int count) {
+	int first = next_id + 1;
+	next_id += count;
+	return first;
+}
+
 AssDialogue::~AssDialogue () { }
 
+typedef boost::iterator_range<const char *> LineRange;
+
 class tokenizer {
-	agi::StringRange str;
-	agi::split_iterator<agi::StringRange::const_iterator> pos;
+	LineRange str;
+	agi::split_iterator<const char *> pos;
 
 public:
-	tokenizer(agi::StringRange const& str) : str(str) , pos(agi::Split(str, ',')) { }
+	tokenizer(LineRange const& str) : str(str) , pos(str.begin(), str.end(), ',') { }
 
-	agi::StringRange next_tok() {
+	LineRange next_tok() {
 		if (pos.eof())
 			throw SubtitleFormatParseError("Failed parsing line: " + std::string(str.begin(), str.end()));
 		return *pos++;
 	}
 
-	std::string next_str() { return agi::str(next_tok()); }
-	std::string next_str_trim() { return agi::str(boost::trim_copy(next_tok())); }
+	std::string next_str() { return boost::copy_range<std::string>(next_tok()); }
+	std::string next_str_trim() { return boost::copy_range<std::string>(boost::trim_copy(next_tok())); }
 };
 
-void AssDialogue::Parse(std::string const& raw) {
-	agi::StringRange str;
-	if (boost::starts_with(raw, "Dialogue:")) {
+void AssDialogue::Parse(boost::string_ref raw) {
+	LineRange str;
+	if (raw.starts_with("Dialogue:")) {
 		Comment = false;
-		str = agi::StringRange(raw.begin() + 10, raw.end());
+		str = LineRange(raw.begin() + 10, raw.end());
 	}
-	else if (boost::starts_with(raw, "Comment:")) {
+	else if (raw.starts_with("Comment:")) {
 		Comment = true;
-		str = agi::StringRange(raw.begin() + 9, raw.end());
+		str = LineRange(raw.begin() + 9, raw.end());
 	}
 	else
-		throw SubtitleFormatParseError("Failed parsing line: " + raw);
+		throw SubtitleFormatParseError("Failed parsing line: " + raw.to_string());
 
 	tokenizer tkn(str);
 
@@ -266,6 +282,74 @@ plain:
 	return Blocks;
 }
 
+namespace {
+typedef std::vector<std::unique_ptr<AssDialogueBlock>> BlockList;
+
+struct ParsedText {
+	/// Held so that the text's address, which the cache is keyed on, can't be
+	/// reused for some other text while the entry is alive
+	boost::flyweight<std::string> text;
+	BlockList blocks;
+};
+
+/// Recently parsed texts, keyed on the address of the text's flyweight value
+/// so that lines with the same text share a parse
+class ParseCache {
+	/// Maximum number of parses to keep around. Callers can hold on to
+	/// parses which have been evicted for as long as they want.
+	static const size_t max_size = 4096;
+
+	std::mutex mutex;
+	/// Most recently used at the front
+	std::list<std::shared_ptr<const ParsedText>> parses;
+	std::unordered_map<const std::string *, decltype(parses)::iterator> index;
+
+public:
+	std::shared_ptr<const ParsedText> Get(AssDialogue const& line) {
+		const std::string *key = &line.Text.get();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = index.find(key);
+			if (it != end(index)) {
+				parses.splice(begin(parses), parses, it->second);
+				return parses.front();
+			}
+		}
+
+		// Parse without holding the lock, and accept that two threads may
+		// both parse the same text
+		auto parsed = std::make_shared<ParsedText>();
+		parsed->text = line.Text;
+		parsed->blocks = line.ParseTags();
+
+		// The blocks in \t tags are otherwise parsed the first time they're
+		// read, which would modify the shared blocks, so parse them up front
+		for (auto block : parsed->blocks | agi::of_type<AssDialogueBlockOverride>())
+			block->ProcessParameters([](std::string const&, AssOverrideParameter *, void *) { }, nullptr);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = index.find(key);
+		if (it != end(index))
+			return *it->second;
+
+		parses.push_front(parsed);
+		index[key] = begin(parses);
+		if (parses.size() > max_size) {
+			index.erase(&parses.back()->text.get());
+			parses.pop_back();
+		}
+		return parsed;
+	}
+};
+
+ParseCache parse_cache;
+}
+
+std::shared_ptr<const BlockList> AssDialogue::GetParsedTags() const {
+	auto parsed = parse_cache.Get(*this);
+	return std::shared_ptr<const BlockList>(parsed, &parsed->blocks);
+}
+
 void AssDialogue::StripTags() {
 	Text = GetStrippedText();
 }
@@ -281,8 +365,8 @@ bool AssDialogue::CollidesWith(const AssDialogue *target) const {
 	return ((Start < target->Start) ? (target->Start < End) : (Start < target->End));
 }
 
-static std::string get_text_p(AssDialogueBlock *d) { return d->GetText(); }
+static std::string get_text_p(AssDialogueBlock const* d) { return d->GetText(); }
 std::string AssDialogue::GetStrippedText() const {
-	auto blocks = ParseTags();
-	return join(blocks | agi::of_type<AssDialogueBlockPlain>() | transformed(get_text_p), "");
+	auto blocks = GetParsedTags();
+	return join(*blocks | agi::of_type<AssDialogueBlockPlain>() | transformed(get_text_p), "");
 }
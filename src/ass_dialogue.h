@@ -34,6 +34,7 @@
 
 #include <array>
 #include <boost/flyweight.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <vector>
 
 enum class AssBlockType {
@@ -60,8 +61,8 @@ enum class AssBlockType {
 /// Also note how {}s are discarded.
 /// Override blocks are further divided in AssOverrideTags.
 ///
-/// The GetText() method generates a new value for the "text" field from
-/// the other fields in the specific class, and returns the new value.
+/// The GetText() method generates the text of the block from the other
+/// fields in the specific class.
 /// @endverbatim
 class AssDialogueBlock {
 protected:
@@ -72,7 +73,7 @@ public:
 	virtual ~AssDialogueBlock() = default;
 
 	virtual AssBlockType GetType() const = 0;
-	virtual std::string GetText() { return text; }
+	virtual std::string GetText() const { return text; }
 };
 
 class AssDialogueBlockPlain final : public AssDialogueBlock {
@@ -104,7 +105,7 @@ public:
 	std::vector<AssOverrideTag> Tags;
 
 	AssBlockType GetType() const override { return AssBlockType::OVERRIDE; }
-	std::string GetText() override;
+	std::string GetText() const override;
 	void ParseTags();
 	void AddTag(std::string const& tag);
 
@@ -149,13 +150,23 @@ struct AssDialogueBase {
 class AssDialogue final : public AssEntry, public AssDialogueBase, public AssEntryListHook {
 	/// @brief Parse raw ASS data into everything else
 	/// @param data ASS line
-	void Parse(std::string const& data);
+	void Parse(boost::string_ref data);
 public:
 	AssEntryGroup Group() const override { return AssEntryGroup::DIALOGUE; }
 
 	/// Parse text as ASS and return block information
 	std::vector<std::unique_ptr<AssDialogueBlock>> ParseTags() const;
 
+	/// Get the parsed blocks of the text without parsing it again if it was
+	/// parsed recently
+	///
+	/// The blocks are shared with every other line with the same text, and
+	/// possibly with other threads, so they must not be modified. Nested
+	/// override blocks are parsed before the blocks are shared, so reading
+	/// them doesn't modify anything. Use ParseTags() for a copy which can be
+	/// modified and passed to UpdateText().
+	std::shared_ptr<const std::vector<std::unique_ptr<AssDialogueBlock>>> GetParsedTags() const;
+
 	/// Strip all ASS tags from the text
 	void StripTags();
 	/// Strip a specific ASS tag from the text
@@ -172,7 +183,14 @@ public:
 	AssDialogue();
 	AssDialogue(AssDialogue const&);
 	AssDialogue(AssDialogueBase const&);
-	AssDialogue(std::string const& data);
+	AssDialogue(boost::string_ref data);
+	/// Parse a line using an ID from ReserveIds(), which unlike the other
+	/// constructors is safe to do from threads other than the main one
+	AssDialogue(boost::string_ref data, int id);
 	~AssDialogue();
+
+	/// Reserve count consecutive unique IDs
+	/// @return The first of the reserved IDs
+	static int ReserveIds(int count);
 };
 
@@ -27,10 +27,28 @@
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem/path.hpp>
+#include <boost/functional/hash.hpp>
 #include <cassert>
 #include <unordered_map>
 #include <unordered_set>
 
+namespace {
+/// Number of lines in each of the blocks which snapshots share lines in
+const size_t snapshot_block_size = 256;
+}
+
+class AssFileSnapshot {
+	friend class AssFile;
+
+	std::vector<AssInfo> info;
+	std::shared_ptr<const std::vector<AssStyle>> styles;
+	/// The lines, in blocks of snapshot_block_size
+	std::vector<std::shared_ptr<const std::vector<AssDialogueBase>>> events;
+	std::shared_ptr<const std::vector<AssAttachment>> attachments;
+	std::shared_ptr<const std::vector<ExtradataEntry>> extradata;
+	ProjectProperties properties;
+};
+
 AssFile::AssFile() { }
 
 AssFile::~AssFile() {
@@ -51,6 +69,7 @@ void AssFile::LoadDefault(bool include_dialogue_line, std::string const& style_c
 
 	// Add default style
 	Styles.push_back(*new AssStyle);
+	StylesChanged();
 
 	// Add/replace any catalog styles requested
 	if (AssStyleStorage::CatalogExists(style_catalog)) {
@@ -64,10 +83,12 @@ void AssFile::LoadDefault(bool include_dialogue_line, std::string const& style_c
 }
 
 AssFile::AssFile(const AssFile &from)
-: Info(from.Info)
-, Attachments(from.Attachments)
-, Extradata(from.Extradata)
+: Extradata(from.Extradata)
+, extradata_by_id(from.extradata_by_id)
+, extradata_by_value(from.extradata_by_value)
 , next_extradata_id(from.next_extradata_id)
+, Info(from.Info)
+, Attachments(from.Attachments)
 {
 	Styles.clone_from(from.Styles,
 		[](AssStyle const& e) { return new AssStyle(e); },
@@ -77,14 +98,89 @@ AssFile::AssFile(const AssFile &from)
 		[](AssDialogue *e) { delete e; });
 }
 
+AssFile::AssFile(AssFileSnapshot const& snapshot)
+: Info(snapshot.info)
+, Attachments(*snapshot.attachments)
+, Properties(snapshot.properties)
+{
+	for (auto const& style : *snapshot.styles)
+		Styles.push_back(*new AssStyle(style));
+	for (auto const& block : snapshot.events) {
+		for (auto const& line : *block)
+			Events.push_back(*new AssDialogue(line));
+	}
+	SetAllExtradata(*snapshot.extradata);
+}
+
+std::shared_ptr<const AssFileSnapshot> AssFile::GetSnapshot() const {
+	auto next = snapshot ? std::make_shared<AssFileSnapshot>(*snapshot) : std::make_shared<AssFileSnapshot>();
+	int changes = snapshot ? snapshot_changes : ~0;
+
+	// Script info is small enough that it's not worth tracking changes to
+	next->info = Info;
+	next->properties = Properties;
+
+	// Styles are small too, and not everything which changes them commits
+	// with COMMIT_STYLES, so they're copied after every commit other than
+	// single-line edits
+	if (changes)
+		next->styles = std::make_shared<std::vector<AssStyle>>(Styles.begin(), Styles.end());
+	if (changes & COMMIT_ATTACHMENT)
+		next->attachments = std::make_shared<std::vector<AssAttachment>>(Attachments);
+	if (changes & (COMMIT_EXTRADATA | COMMIT_DIAG_ADDREM | COMMIT_DIAG_FULL) || !snapshot_changed_blocks.empty())
+		next->extradata = std::make_shared<std::vector<ExtradataEntry>>(Extradata);
+
+	if (changes & (COMMIT_ORDER | COMMIT_DIAG_ADDREM | COMMIT_DIAG_FULL)) {
+		next->events.clear();
+		std::shared_ptr<std::vector<AssDialogueBase>> block;
+		for (auto const& line : Events) {
+			if (!block || block->size() == snapshot_block_size) {
+				block = std::make_shared<std::vector<AssDialogueBase>>();
+				block->reserve(snapshot_block_size);
+				next->events.push_back(block);
+			}
+			block->push_back(line);
+		}
+	}
+	else {
+		// Copy just the blocks containing the lines changed since the last
+		// snapshot, starting from the first line of each block
+		for (auto const& changed : snapshot_changed_blocks) {
+			auto& block = next->events[changed.first];
+			auto it = Events.iterator_to(*changed.second);
+			std::advance(it, -static_cast<ptrdiff_t>(changed.second->Row % snapshot_block_size));
+
+			auto copy = std::make_shared<std::vector<AssDialogueBase>>();
+			copy->reserve(block->size());
+			for (size_t i = 0; i < block->size(); ++i, ++it)
+				copy->push_back(*it);
+			block = std::move(copy);
+		}
+	}
+
+	snapshot = next;
+	snapshot_changes = 0;
+	snapshot_changed_blocks.clear();
+	return snapshot;
+}
+
 void AssFile::swap(AssFile& from) throw() {
 	Info.swap(from.Info);
 	Styles.swap(from.Styles);
 	Events.swap(from.Events);
 	Attachments.swap(from.Attachments);
 	Extradata.swap(from.Extradata);
+	extradata_by_id.swap(from.extradata_by_id);
+	extradata_by_value.swap(from.extradata_by_value);
 	std::swap(Properties, from.Properties);
 	std::swap(next_extradata_id, from.next_extradata_id);
+	style_index.swap(from.style_index);
+	std::swap(style_index_valid, from.style_index_valid);
+	std::swap(time_index, from.time_index);
+	rows.swap(from.rows);
+	snapshot.swap(from.snapshot);
+	std::swap(snapshot_changes, from.snapshot_changes);
+	snapshot_changed_blocks.swap(from.snapshot_changed_blocks);
 }
 
 AssFile& AssFile::operator=(AssFile from) {
@@ -161,21 +257,79 @@ std::vector<std::string> AssFile::GetStyles() const {
 }
 
 AssStyle *AssFile::GetStyle(std::string const& name) {
-	for (auto& style : Styles) {
-		if (boost::iequals(style.name, name))
-			return &style;
+	auto key = boost::to_lower_copy(name);
+	if (style_index_valid) {
+		// Names which aren't styles are common (the fix styles filter looks
+		// up every line's style), so a miss is only worth a rebuild if the
+		// entry found shows that a style was renamed since the last one
+		auto it = style_index.find(key);
+		if (it == end(style_index))
+			return nullptr;
+		if (boost::iequals(it->second->name, name))
+			return it->second;
 	}
-	return nullptr;
+
+	style_index.clear();
+	for (auto& style : Styles)
+		style_index.emplace(boost::to_lower_copy(style.name), &style);
+	style_index_valid = true;
+
+	auto it = style_index.find(key);
+	return it == end(style_index) ? nullptr : it->second;
+}
+
+std::vector<AssDialogue *> AssFile::GetEventsAt(int time) {
+	if (!time_index.IsValid())
+		time_index.Build(Events);
+	return time_index.GetActive(time);
+}
+
+std::vector<AssDialogue *> AssFile::GetEventsOverlapping(int start, int end) {
+	if (!time_index.IsValid())
+		time_index.Build(Events);
+	return time_index.GetOverlapping(start, end);
 }
 
 int AssFile::Commit(wxString const& desc, int type, int amend_id, AssDialogue *single_line) {
+	if (type == COMMIT_NEW || (type & COMMIT_STYLES))
+		style_index_valid = false;
+
+	if (type == COMMIT_NEW) {
+		snapshot.reset();
+		snapshot_changed_blocks.clear();
+	}
+	else if (single_line && !(type & ~COMMIT_DIAG_FULL)) {
+		// Without a snapshot the next one copies every line anyway
+		if (snapshot)
+			snapshot_changed_blocks[single_line->Row / snapshot_block_size] = single_line;
+	}
+	else {
+		snapshot_changes |= type;
+		// The next snapshot copies every line after these, and the lines
+		// recorded may have been deleted
+		if (type & (COMMIT_ORDER | COMMIT_DIAG_ADDREM | COMMIT_DIAG_FULL))
+			snapshot_changed_blocks.clear();
+	}
+
+	if (type == COMMIT_NEW || (type & COMMIT_DIAG_ADDREM) || (type & COMMIT_ORDER))
+		time_index.Invalidate();
+	else if (type & COMMIT_DIAG_TIME) {
+		if (single_line)
+			time_index.Update(single_line);
+		else
+			time_index.Invalidate();
+	}
+
 	if (type == COMMIT_NEW || (type & COMMIT_DIAG_ADDREM) || (type & COMMIT_ORDER)) {
+		rows.clear();
 		int i = 0;
-		for (auto& event : Events)
+		for (auto& event : Events) {
 			event.Row = i++;
+			rows.push_back(&event);
+		}
 	}
 
-	PushState({desc, &amend_id, single_line});
+	PushState({desc, type, &amend_id, single_line});
 
 	AnnounceCommit(type, single_line);
 
@@ -227,48 +381,68 @@ void AssFile::Sort(EntryList<AssDialogue> &lst, CompFunc comp, std::set<AssDialo
 	}
 }
 
-uint32_t AssFile::AddExtradata(std::string const& key, std::string const& value) {
-	for (auto const& data : Extradata) {
-		// perform brute-force deduplication by simple key and value comparison
-		if (key == data.key && value == data.value) {
-			return data.id;
-		}
-	}
-	Extradata.push_back(ExtradataEntry{next_extradata_id, key, value});
-	return next_extradata_id++; // return old value, then post-increment
+namespace {
+size_t extradata_hash(std::string const& key, std::string const& value) {
+	size_t hash = 0;
+	boost::hash_combine(hash, key);
+	boost::hash_combine(hash, value);
+	return hash;
 }
 
-namespace {
-struct extradata_id_cmp {
-	bool operator()(ExtradataEntry const& e, uint32_t id) {
-		return e.id < id;
-	}
-	bool operator()(uint32_t id, ExtradataEntry const& e) {
-		return id < e.id;
+template<typename K, typename V>
+using reference_map = std::unordered_map<std::reference_wrapper<const K>, V, std::hash<K>, std::equal_to<K>>;
+}
+
+void AssFile::IndexExtradata() {
+	extradata_by_id.clear();
+	extradata_by_value.clear();
+	for (size_t i = 0; i < Extradata.size(); ++i) {
+		auto const& e = Extradata[i];
+		extradata_by_id.emplace(e.id, i);
+		extradata_by_value.emplace(extradata_hash(e.key, e.value), e.id);
+		next_extradata_id = std::max(e.id + 1, next_extradata_id);
 	}
-};
+}
 
-template<typename ExtradataType, typename Func>
-void enumerate_extradata(ExtradataType&& extradata, std::vector<uint32_t> const& id_list, Func&& f) {
-	auto begin = extradata.begin(), end = extradata.end();
-	for (auto id : id_list) {
-		auto it = lower_bound(begin, end, id, extradata_id_cmp{});
-		if (it != end) {
-			f(*it);
-			begin = it;
-		}
+uint32_t AssFile::AddExtradata(std::string const& key, std::string const& value) {
+	// If there are several identical entries, use the first one added
+	size_t found = Extradata.size();
+	auto range = extradata_by_value.equal_range(extradata_hash(key, value));
+	for (auto it = range.first; it != range.second; ++it) {
+		size_t index = extradata_by_id[it->second];
+		auto const& data = Extradata[index];
+		if (index < found && key == data.key && value == data.value)
+			found = index;
 	}
+	if (found != Extradata.size())
+		return Extradata[found].id;
+
+	uint32_t id = next_extradata_id;
+	InsertExtradata(ExtradataEntry{id, key, value});
+	return id;
 }
 
-template<typename K, typename V>
-using reference_map = std::unordered_map<std::reference_wrapper<const K>, V, std::hash<K>, std::equal_to<K>>;
+void AssFile::InsertExtradata(ExtradataEntry entry) {
+	// ensure next_extradata_id is always at least 1 more than the largest existing id
+	next_extradata_id = std::max(entry.id + 1, next_extradata_id);
+	extradata_by_id.emplace(entry.id, Extradata.size());
+	extradata_by_value.emplace(extradata_hash(entry.key, entry.value), entry.id);
+	Extradata.push_back(std::move(entry));
+}
+
+void AssFile::SetAllExtradata(std::vector<ExtradataEntry> entries) {
+	Extradata = std::move(entries);
+	IndexExtradata();
 }
 
 std::vector<ExtradataEntry> AssFile::GetExtradata(std::vector<uint32_t> const& id_list) const {
 	std::vector<ExtradataEntry> result;
-	enumerate_extradata(Extradata, id_list, [&](ExtradataEntry const& e) {
-		result.push_back(e);
-	});
+	result.reserve(id_list.size());
+	for (auto id : id_list) {
+		auto it = extradata_by_id.find(id);
+		if (it != end(extradata_by_id))
+			result.push_back(Extradata[it->second]);
+	}
 	return result;
 }
 
@@ -281,9 +455,13 @@ void AssFile::CleanExtradata() {
 
 		// Find the ID for each unique key in the line
 		reference_map<std::string, uint32_t> keys_used;
-		enumerate_extradata(Extradata, line.ExtradataIds.get(), [&](ExtradataEntry const& e) {
-			keys_used[e.key] = e.id;
-		});
+		for (auto id : line.ExtradataIds.get()) {
+			auto it = extradata_by_id.find(id);
+			if (it != end(extradata_by_id)) {
+				auto const& e = Extradata[it->second];
+				keys_used[e.key] = e.id;
+			}
+		}
 
 		for (auto const& used : keys_used)
 			ids_used.insert(used.second);
@@ -304,5 +482,6 @@ void AssFile::CleanExtradata() {
 		Extradata.erase(std::remove_if(begin(Extradata), end(Extradata), [&](ExtradataEntry const& e) {
 			return !ids_used.count(e.id);
 		}), end(Extradata));
+		IndexExtradata();
 	}
 }
@@ -28,17 +28,21 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include "ass_entry.h"
+#include "ass_time_index.h"
 
 #include <libaegisub/fs_fwd.h>
 #include <libaegisub/signal.h>
 
 #include <boost/intrusive/list.hpp>
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 class AssAttachment;
 class AssDialogue;
+class AssFileSnapshot;
 class AssInfo;
 class AssStyle;
 class wxString;
@@ -54,6 +58,7 @@ struct ExtradataEntry {
 
 struct AssFileCommit {
 	wxString const& message;
+	int type;
 	int *commit_id;
 	AssDialogue *single_line;
 };
@@ -82,19 +87,50 @@ class AssFile {
 	/// A set of changes has been committed to the file (AssFile::COMMITType)
 	agi::signal::Signal<int, const AssDialogue*> AnnounceCommit;
 	agi::signal::Signal<AssFileCommit> PushState;
+
+	/// Extradata entries, in the order they were added
+	std::vector<ExtradataEntry> Extradata;
+	/// Index in Extradata of the entry with each ID
+	std::unordered_map<uint32_t, size_t> extradata_by_id;
+	/// IDs of the entries with each hash of key and value
+	std::unordered_multimap<size_t, uint32_t> extradata_by_value;
+	uint32_t next_extradata_id = 0;
+
+	/// Rebuild the extradata indexes from scratch
+	void IndexExtradata();
+
+	/// Styles by lowercased name, built by GetStyle the first time it's
+	/// called after the styles change
+	std::unordered_map<std::string, AssStyle *> style_index;
+	bool style_index_valid = false;
+
+	/// Events by time, built the first time it's needed and then kept up to
+	/// date by commits which retime single lines
+	AssTimeIndex time_index;
+
+	/// The lines by row, as numbered by the last commit which added, removed
+	/// or reordered lines
+	std::vector<AssDialogue *> rows;
+
+	/// The last snapshot taken of the file
+	mutable std::shared_ptr<const AssFileSnapshot> snapshot;
+	/// Parts of the file changed since the last snapshot, as COMMIT_* flags
+	mutable int snapshot_changes = 0;
+	/// Blocks of the last snapshot which have lines changed by single-line
+	/// commits since it was taken, with the last line committed in each
+	mutable std::map<size_t, const AssDialogue *> snapshot_changed_blocks;
 public:
 	/// The lines in the file
 	std::vector<AssInfo> Info;
 	EntryList<AssStyle> Styles;
 	EntryList<AssDialogue> Events;
 	std::vector<AssAttachment> Attachments;
-	std::vector<ExtradataEntry> Extradata;
 	ProjectProperties Properties;
 
-	uint32_t next_extradata_id = 0;
-
 	AssFile();
 	AssFile(const AssFile &from);
+	/// Create a file from a snapshot of another file
+	explicit AssFile(AssFileSnapshot const& snapshot);
 	AssFile& operator=(AssFile from);
 	~AssFile();
 
@@ -109,9 +145,51 @@ public:
 	/// Get the names of all of the styles available
 	std::vector<std::string> GetStyles() const;
 	/// @brief Get a style by name
-	/// @param name Style name
+	/// @param name Style name, compared case-insensitively
 	/// @return Pointer to style or nullptr
+	///
+	/// Lookups go through a hash index which is rebuilt after each commit
+	/// that touches the styles, so the pointer returned for a line can be
+	/// cached until the next COMMIT_STYLES or COMMIT_NEW. Code which adds,
+	/// renames or deletes styles and then looks up styles before committing
+	/// must call StylesChanged() in between.
 	AssStyle *GetStyle(std::string const& name);
+	/// Discard the style index after modifying Styles without a commit
+	void StylesChanged() { style_index_valid = false; }
+
+	/// Get the lines which are visible at a time, including comments, in
+	/// file order
+	std::vector<AssDialogue *> GetEventsAt(int time);
+	/// Get the lines which start before end and end after start, including
+	/// comments, in file order
+	std::vector<AssDialogue *> GetEventsOverlapping(int start, int end);
+	/// Update the time index after changing a line's times without a commit
+	/// @param line Line with the new times
+	/// @param old Line which line replaced at the same position, if any
+	void EventTimesChanged(AssDialogue *line, AssDialogue const* old = nullptr) { time_index.Update(line, old); }
+	/// Discard the time index after adding, removing or reordering lines
+	/// without a commit
+	void EventsChanged() { time_index.Invalidate(); }
+	/// Get the line at a row, as numbered by the last commit which added,
+	/// removed or reordered lines
+	/// @return The line, or nullptr if there was no such row
+	///
+	/// The result is only meaningful until lines are next added, removed or
+	/// reordered, so callers which can't be sure they haven't been should
+	/// check that the line's ID is the one they expect.
+	AssDialogue *GetEventAtRow(int row) const {
+		return row >= 0 && static_cast<size_t>(row) < rows.size() ? rows[row] : nullptr;
+	}
+
+	/// @brief Get an immutable copy of the file as of the last commit
+	///
+	/// Snapshots share the parts of the file which haven't changed with the
+	/// previous snapshot, so taking one after a commit only copies what the
+	/// commit changed. They can be read from any thread, which makes them
+	/// the way to hand the file off to background work: take a snapshot on
+	/// the main thread, then construct an AssFile from it in the background.
+	/// May only be called from the main thread.
+	std::shared_ptr<const AssFileSnapshot> GetSnapshot() const;
 
 	void swap(AssFile &) throw();
 
@@ -131,8 +209,14 @@ public:
 	/// @param value Data for the extradata
 	/// @return ID of the created entry
 	uint32_t AddExtradata(std::string const& key, std::string const& value);
+	/// Add an extradata entry read from a file, keeping its ID
+	void InsertExtradata(ExtradataEntry entry);
 	/// Fetch all extradata entries from a list of IDs
 	std::vector<ExtradataEntry> GetExtradata(std::vector<uint32_t> const& id_list) const;
+	/// Get every extradata entry, in the order they were added
+	std::vector<ExtradataEntry> const& GetAllExtradata() const { return Extradata; }
+	/// Replace all of the extradata entries
+	void SetAllExtradata(std::vector<ExtradataEntry> entries);
 	/// Remove unreferenced extradata entries
 	void CleanExtradata();
 
@@ -39,7 +39,6 @@
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/trim.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/adaptor/transformed.hpp>
 #include <functional>
@@ -98,7 +97,7 @@ template<> AssDialogueBlockOverride *AssOverrideParameter::Get<AssDialogueBlockO
 
 template<> void AssOverrideParameter::Set<std::string>(std::string new_value) {
 	omitted = false;
-	value = new_value;
+	value = std::move(new_value);
 	block.reset();
 }
 
@@ -152,8 +151,6 @@ struct AssOverrideTagProto {
 	/// Parameters to this tag
 	std::vector<AssOverrideParamProto> params;
 
-	typedef std::vector<AssOverrideTagProto>::iterator iterator;
-
 	/// @brief Add a parameter to this tag prototype
 	/// @param type Data type of the parameter
 	/// @param classi Semantic type of the parameter
@@ -173,14 +170,28 @@ struct AssOverrideTagProto {
 	}
 };
 
+/// Index of each tag's prototype in proto
+enum TagId {
+	TAG_UNKNOWN = -1,
+	TAG_ALPHA, TAG_BORD, TAG_XBORD, TAG_YBORD, TAG_SHAD, TAG_XSHAD, TAG_YSHAD,
+	TAG_FADE, TAG_MOVE, TAG_CLIP, TAG_CLIP_VECTOR, TAG_ICLIP, TAG_ICLIP_VECTOR,
+	TAG_FSCX, TAG_FSCY, TAG_POS, TAG_ORG, TAG_PBO, TAG_FAD, TAG_FSP,
+	TAG_FRX, TAG_FRY, TAG_FRZ, TAG_FR, TAG_FAX, TAG_FAY,
+	TAG_1C, TAG_2C, TAG_3C, TAG_4C, TAG_1A, TAG_2A, TAG_3A, TAG_4A,
+	TAG_FE, TAG_KO, TAG_KF, TAG_BE, TAG_BLUR, TAG_FN, TAG_FS_PLUS, TAG_FS_MINUS, TAG_FS,
+	TAG_AN, TAG_C, TAG_B, TAG_I, TAG_U, TAG_S, TAG_A, TAG_K, TAG_K_UPPER,
+	TAG_Q, TAG_P, TAG_R, TAG_T,
+	TAG_COUNT
+};
+
 static std::vector<AssOverrideTagProto> proto;
 static void load_protos() {
 	if (!proto.empty()) return;
 
-	proto.resize(56);
+	proto.resize(TAG_COUNT);
 	int i = 0;
 
-	// Longer tag names must appear before shorter tag names
+	// Must be in the same order as TagId
 
 	proto[0].Set("\\alpha", VariableDataType::TEXT, AssParameterClass::ALPHA); // \alpha&H<aa>&
 	proto[++i].Set("\\bord", VariableDataType::FLOAT, AssParameterClass::ABSOLUTE_SIZE); // \bord<depth>
@@ -305,11 +316,118 @@ static void load_protos() {
 	proto[i].AddParam(VariableDataType::INT, AssParameterClass::RELATIVE_TIME_START,OPTIONAL_3 | OPTIONAL_4);
 	proto[i].AddParam(VariableDataType::FLOAT, AssParameterClass::NORMAL,OPTIONAL_2 | OPTIONAL_4);
 	proto[i].AddParam(VariableDataType::BLOCK);
+	assert(i + 1 == TAG_COUNT);
+}
+
+/// Find the tag with the longest name which text starts with
+///
+/// Tag names are mostly prefixes of each other (\fs, \fsp, \fscx), so this
+/// is a hand-built trie over the names rather than a search through the
+/// prototypes, and it only has to look at each character once or twice.
+TagId match_tag(boost::string_ref text) {
+	if (text.size() < 2 || text[0] != '\\') return TAG_UNKNOWN;
+	char first = text[1];
+	text.remove_prefix(2);
+	auto has = [&](const char *rest) { return text.starts_with(rest); };
+
+	switch (first) {
+	case '1': case '2': case '3': case '4':
+		if (has("c")) return TagId(TAG_1C + first - '1');
+		if (has("a")) return TagId(TAG_1A + first - '1');
+		return TAG_UNKNOWN;
+	case 'a':
+		if (has("lpha")) return TAG_ALPHA;
+		if (has("n")) return TAG_AN;
+		return TAG_A;
+	case 'b':
+		if (has("ord")) return TAG_BORD;
+		if (has("lur")) return TAG_BLUR;
+		if (has("e")) return TAG_BE;
+		return TAG_B;
+	case 'c': return has("lip") ? TAG_CLIP : TAG_C;
+	case 'f':
+		if (text.empty()) return TAG_UNKNOWN;
+		first = text[0];
+		text.remove_prefix(1);
+		switch (first) {
+		case 'a':
+			if (has("de")) return TAG_FADE;
+			if (has("d")) return TAG_FAD;
+			if (has("x")) return TAG_FAX;
+			if (has("y")) return TAG_FAY;
+			return TAG_UNKNOWN;
+		case 'e': return TAG_FE;
+		case 'n': return TAG_FN;
+		case 'r':
+			if (has("x")) return TAG_FRX;
+			if (has("y")) return TAG_FRY;
+			if (has("z")) return TAG_FRZ;
+			return TAG_FR;
+		case 's':
+			if (has("cx")) return TAG_FSCX;
+			if (has("cy")) return TAG_FSCY;
+			if (has("p")) return TAG_FSP;
+			if (has("+")) return TAG_FS_PLUS;
+			if (has("-")) return TAG_FS_MINUS;
+			return TAG_FS;
+		default: return TAG_UNKNOWN;
+		}
+	case 'i': return has("clip") ? TAG_ICLIP : TAG_I;
+	case 'k':
+		if (has("o")) return TAG_KO;
+		if (has("f")) return TAG_KF;
+		return TAG_K;
+	case 'K': return TAG_K_UPPER;
+	case 'm': return has("ove") ? TAG_MOVE : TAG_UNKNOWN;
+	case 'o': return has("rg") ? TAG_ORG : TAG_UNKNOWN;
+	case 'p':
+		if (has("os")) return TAG_POS;
+		if (has("bo")) return TAG_PBO;
+		return TAG_P;
+	case 'q': return TAG_Q;
+	case 'r': return TAG_R;
+	case 's': return has("had") ? TAG_SHAD : TAG_S;
+	case 't': return TAG_T;
+	case 'u': return TAG_U;
+	case 'x':
+		if (has("bord")) return TAG_XBORD;
+		if (has("shad")) return TAG_XSHAD;
+		return TAG_UNKNOWN;
+	case 'y':
+		if (has("bord")) return TAG_YBORD;
+		if (has("shad")) return TAG_YSHAD;
+		return TAG_UNKNOWN;
+	default: return TAG_UNKNOWN;
+	}
 }
 
-std::vector<std::string> tokenize(const std::string &text) {
-	std::vector<std::string> paramList;
-	paramList.reserve(6);
+boost::string_ref trim(boost::string_ref str) {
+	while (!str.empty() && isspace(static_cast<unsigned char>(str.front())))
+		str.remove_prefix(1);
+	while (!str.empty() && isspace(static_cast<unsigned char>(str.back())))
+		str.remove_suffix(1);
+	return str;
+}
+
+/// The parameters of a tag, pointing into the tag's text
+///
+/// No tag has more than seven parameters, so only the count of any past that
+/// is kept.
+struct ParamList {
+	boost::string_ref params[8];
+	size_t size = 0;
+
+	void push_back(boost::string_ref param) {
+		if (size < 8)
+			params[size] = param;
+		++size;
+	}
+
+	boost::string_ref operator[](size_t i) const { return params[i]; }
+};
+
+ParamList tokenize(boost::string_ref text) {
+	ParamList paramList;
 
 	if (text.empty())
 		return paramList;
@@ -317,7 +435,7 @@ std::vector<std::string> tokenize(const std::string &text) {
 	if (text[0] != '(') {
 		// There's just one parameter (because there's no parentheses)
 		// This means text is all our parameters
-		paramList.emplace_back(boost::trim_copy(text));
+		paramList.push_back(trim(text));
 		return paramList;
 	}
 
@@ -344,32 +462,31 @@ std::vector<std::string> tokenize(const std::string &text) {
 			i++;
 		}
 		// i now points to the first character not member of this parameter
-		paramList.emplace_back(boost::trim_copy(text.substr(start, i - start)));
+		paramList.push_back(trim(text.substr(start, i - start)));
 	}
 
 	if (i+1 < textlen) {
 		// There's some additional garbage after the parentheses
 		// Just add it in for completeness
-		paramList.emplace_back(text.begin() + i + 1, text.end());
+		paramList.push_back(text.substr(i + 1));
 	}
 	return paramList;
 }
 
-void parse_parameters(AssOverrideTag *tag, const std::string &text, AssOverrideTagProto::iterator proto_it) {
+void parse_parameters(AssOverrideTag *tag, boost::string_ref text, TagId id) {
 	tag->Clear();
 
 	// Tokenize text, attempting to find all parameters
-	std::vector<std::string> paramList = tokenize(text);
-	size_t totalPars = paramList.size();
+	ParamList paramList = tokenize(text);
+	size_t totalPars = paramList.size;
 
 	int parsFlag = 1 << (totalPars - 1); // Get optional parameters flag
-	// vector (i)clip is the second clip proto_ittype in the list
-	if ((tag->Name == "\\clip" || tag->Name == "\\iclip") && totalPars != 4) {
-		++proto_it;
-	}
+	// vector (i)clip is the prototype after the rect (i)clip
+	if ((id == TAG_CLIP || id == TAG_ICLIP) && totalPars != 4)
+		id = TagId(id + 1);
 
 	unsigned curPar = 0;
-	for (auto& curproto : proto_it->params) {
+	for (auto& curproto : proto[id].params) {
 		// Create parameter
 		tag->Params.emplace_back(curproto.type, curproto.classification);
 
@@ -377,7 +494,7 @@ void parse_parameters(AssOverrideTag *tag, const std::string &text, AssOverrideT
 		if (!(curproto.optional & parsFlag) || curPar >= totalPars)
 			continue;
 
-		tag->Params.back().Set(paramList[curPar++]);
+		tag->Params.back().Set(paramList[curPar++].to_string());
 	}
 }
 
@@ -395,7 +512,7 @@ void AssDialogueBlockOverride::ParseTags() {
 				--depth;
 		}
 		else if (text[i] == '\\') {
-			Tags.emplace_back(text.substr(start, i - start));
+			Tags.emplace_back(boost::string_ref(text).substr(start, i - start));
 			start = i;
 		}
 		else if (text[i] == '(')
@@ -403,7 +520,7 @@ void AssDialogueBlockOverride::ParseTags() {
 	}
 
 	if (!text.empty())
-		Tags.emplace_back(text.substr(start));
+		Tags.emplace_back(boost::string_ref(text).substr(start));
 }
 
 void AssDialogueBlockOverride::AddTag(std::string const& tag) {
@@ -411,9 +528,8 @@ void AssDialogueBlockOverride::AddTag(std::string const& tag) {
 }
 
 static std::string tag_str(AssOverrideTag const& t) { return t; }
-std::string AssDialogueBlockOverride::GetText() {
-	text = "{" + join(Tags | transformed(tag_str), std::string()) + "}";
-	return text;
+std::string AssDialogueBlockOverride::GetText() const {
+	return "{" + join(Tags | transformed(tag_str), std::string()) + "}";
 }
 
 void AssDialogueBlockOverride::ProcessParameters(ProcessParametersCallback callback, void *userData) {
@@ -430,7 +546,7 @@ void AssDialogueBlockOverride::ProcessParameters(ProcessParametersCallback callb
 	}
 }
 
-AssOverrideTag::AssOverrideTag(std::string const& text) {
+AssOverrideTag::AssOverrideTag(boost::string_ref text) {
 	SetText(text);
 }
 
@@ -440,19 +556,18 @@ void AssOverrideTag::Clear() {
 	valid = false;
 }
 
-void AssOverrideTag::SetText(const std::string &text) {
+void AssOverrideTag::SetText(boost::string_ref text) {
 	load_protos();
-	for (auto cur = proto.begin(); cur != proto.end(); ++cur) {
-		if (boost::starts_with(text, cur->name)) {
-			Name = cur->name;
-			parse_parameters(this, text.substr(Name.size()), cur);
-			valid = true;
-			return;
-		}
+	TagId id = match_tag(text);
+	if (id != TAG_UNKNOWN) {
+		Name = proto[id].name;
+		parse_parameters(this, text.substr(Name.size()), id);
+		valid = true;
+		return;
 	}
 
 	// Junk tag
-	Name = text;
+	Name = text.to_string();
 	valid = false;
 }
 
@@ -32,6 +32,7 @@
 /// @ingroup subs_storage
 ///
 
+#include <boost/utility/string_ref.hpp>
 #include <memory>
 #include <vector>
 
@@ -92,7 +93,7 @@ class AssOverrideTag {
 
 public:
 	AssOverrideTag() = default;
-	AssOverrideTag(std::string const& text);
+	AssOverrideTag(boost::string_ref text);
 	AssOverrideTag(AssOverrideTag&&) = default;
 	AssOverrideTag& operator=(AssOverrideTag&&) = default;
 
@@ -101,6 +102,6 @@ public:
 
 	bool IsValid() const { return valid; }
 	void Clear();
-	void SetText(const std::string &text);
+	void SetText(boost::string_ref text);
 	operator std::string() const;
 };
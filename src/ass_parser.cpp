@@ -23,6 +23,7 @@
 #include "subtitle_format.h"
 
 #include <libaegisub/ass/uuencode.h>
+#include <libaegisub/dispatch.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/util.h>
 
@@ -94,19 +95,25 @@ public:
 	}
 };
 
-AssParser::AssParser(AssFile *target, int version)
+namespace {
+/// Number of dialogue lines parsed by each background job
+const size_t event_chunk_size = 1024;
+}
+
+AssParser::AssParser(AssFile *target, int version, bool parallel_events)
 : property_handler(agi::make_unique<HeaderToProperty>())
 , target(target)
 , version(version)
 , state(&AssParser::ParseScriptInfoLine)
+, parallel_events(parallel_events)
 {
 }
 
 AssParser::~AssParser() {
 }
 
-void AssParser::ParseAttachmentLine(std::string const& data) {
-	bool is_filename = boost::starts_with(data, "fontname: ") || boost::starts_with(data, "filename: ");
+void AssParser::ParseAttachmentLine(boost::string_ref data) {
+	bool is_filename = data.starts_with("fontname: ") || data.starts_with("filename: ");
 
 	bool valid_data = data.size() > 0 && data.size() <= 80;
 	for (auto byte : data) {
@@ -118,28 +125,30 @@ void AssParser::ParseAttachmentLine(std::string const& data) {
 
 	// Data is over, add attachment to the file
 	if (!valid_data || is_filename) {
-		target->Attachments.push_back(*attach.release());
+		target->Attachments.push_back(std::move(*attach));
+		attach.reset();
 		AddLine(data);
 	}
 	else {
 		attach->AddData(data);
 
 		// Done building
-		if (data.size() < 80)
-			target->Attachments.push_back(*attach.release());
+		if (data.size() < 80) {
+			target->Attachments.push_back(std::move(*attach));
+			attach.reset();
+		}
 	}
 }
 
-void AssParser::ParseScriptInfoLine(std::string const& data) {
-	if (boost::starts_with(data, ";")) {
+void AssParser::ParseScriptInfoLine(boost::string_ref data) {
+	if (data.starts_with(';')) {
 		// Skip stupid comments added by other programs
 		// Of course, we'll add our own in place later... ;)
 		return;
 	}
 
-	if (boost::starts_with(data, "ScriptType:")) {
-		std::string version_str = data.substr(11);
-		boost::trim(version_str);
+	if (data.starts_with("ScriptType:")) {
+		auto version_str = boost::trim_copy(data.substr(11).to_string());
 		boost::to_lower(version_str);
 		if (version_str == "v4.00")
 			version = 0;
@@ -151,56 +160,63 @@ void AssParser::ParseScriptInfoLine(std::string const& data) {
 
 	// Nothing actually supports the Collisions property and malformed values
 	// crash VSFilter, so just remove it entirely
-	if (boost::starts_with(data, "Collisions:"))
+	if (data.starts_with("Collisions:"))
 		return;
 
 	size_t pos = data.find(':');
 	if (pos == data.npos) return;
 
-	auto key = data.substr(0, pos);
-	auto value = data.substr(pos + 1);
+	auto key = data.substr(0, pos).to_string();
+	auto value = data.substr(pos + 1).to_string();
 	boost::trim_left(value);
 
 	if (!property_handler->ProcessProperty(target, key, value))
 		target->Info.push_back(*new AssInfo(std::move(key), std::move(value)));
 }
 
-void AssParser::ParseMetadataLine(std::string const& data) {
+void AssParser::ParseMetadataLine(boost::string_ref data) {
 	size_t pos = data.find(':');
 	if (pos == data.npos) return;
 
-	auto key = data.substr(0, pos);
-	auto value = data.substr(pos + 1);
+	auto key = data.substr(0, pos).to_string();
+	auto value = data.substr(pos + 1).to_string();
 	boost::trim_left(value);
 
 	property_handler->ProcessProperty(target, key, value);
 }
 
-void AssParser::ParseEventLine(std::string const& data) {
-	if (boost::starts_with(data, "Dialogue:") || boost::starts_with(data, "Comment:"))
+void AssParser::ParseEventLine(boost::string_ref data) {
+	if (!data.starts_with("Dialogue:") && !data.starts_with("Comment:"))
+		return;
+
+	if (parallel_events) {
+		pending_events.append(data.begin(), data.end());
+		pending_event_ends.push_back(pending_events.size());
+	}
+	else
 		target->Events.push_back(*new AssDialogue(data));
 }
 
-void AssParser::ParseStyleLine(std::string const& data) {
-	if (boost::starts_with(data, "Style:"))
-		target->Styles.push_back(*new AssStyle(data, version));
+void AssParser::ParseStyleLine(boost::string_ref data) {
+	if (data.starts_with("Style:"))
+		target->Styles.push_back(*new AssStyle(data.to_string(), version));
 }
 
-void AssParser::ParseFontLine(std::string const& data) {
-	if (boost::starts_with(data, "fontname: "))
-		attach = agi::make_unique<AssAttachment>(data, AssEntryGroup::FONT);
+void AssParser::ParseFontLine(boost::string_ref data) {
+	if (data.starts_with("fontname: "))
+		attach = agi::make_unique<AssAttachment>(data.to_string(), AssEntryGroup::FONT);
 }
 
-void AssParser::ParseGraphicsLine(std::string const& data) {
-	if (boost::starts_with(data, "filename: "))
-		attach = agi::make_unique<AssAttachment>(data, AssEntryGroup::GRAPHIC);
+void AssParser::ParseGraphicsLine(boost::string_ref data) {
+	if (data.starts_with("filename: "))
+		attach = agi::make_unique<AssAttachment>(data.to_string(), AssEntryGroup::GRAPHIC);
 }
 
-void AssParser::ParseExtradataLine(std::string const &data) {
+void AssParser::ParseExtradataLine(boost::string_ref data) {
 	static const boost::regex matcher("Data:[[:space:]]*(\\d+),([^,]+),(.)(.*)");
-	boost::match_results<std::string::const_iterator> mr;
+	boost::cmatch mr;
 
-	if (boost::regex_match(data, mr, matcher)) {
+	if (boost::regex_match(data.begin(), data.end(), mr, matcher)) {
 		auto id = boost::lexical_cast<uint32_t>(mr.str(1));
 		auto key = inline_string_decode(mr.str(2));
 		auto valuetype = mr.str(3);
@@ -217,13 +233,11 @@ void AssParser::ParseExtradataLine(std::string const &data) {
 			value = "";
 		}
 
-		// ensure next_extradata_id is always at least 1 more than the largest existing id
-		target->next_extradata_id = std::max(id+1, target->next_extradata_id);
-		target->Extradata.push_back(ExtradataEntry{id, std::move(key), std::move(value)});
+		target->InsertExtradata(ExtradataEntry{id, std::move(key), std::move(value)});
 	}
 }
 
-void AssParser::AddLine(std::string const& data) {
+void AssParser::AddLine(boost::string_ref data) {
 	// Special-case for attachments since a line could theoretically be both a
 	// valid attachment data line and a valid section header, and if an
 	// attachment is in progress it needs to be treated as that
@@ -235,28 +249,27 @@ void AssParser::AddLine(std::string const& data) {
 	if (data.empty()) return;
 
 	// Section header
-	if (data[0] == '[' && data.back() == ']') {
+	if (data.front() == '[' && data.back() == ']') {
 		// Ugly hacks to allow intermixed v4 and v4+ style sections
-		const std::string low = boost::to_lower_copy(data);
-		if (low == "[v4 styles]") {
+		if (boost::iequals(data, "[v4 styles]")) {
 			version = 0;
 			state = &AssParser::ParseStyleLine;
 		}
-		else if (low == "[v4+ styles]") {
+		else if (boost::iequals(data, "[v4+ styles]")) {
 			version = 1;
 			state = &AssParser::ParseStyleLine;
 		}
-		else if (low == "[events]")
+		else if (boost::iequals(data, "[events]"))
 			state = &AssParser::ParseEventLine;
-		else if (low == "[script info]")
+		else if (boost::iequals(data, "[script info]"))
 			state = &AssParser::ParseScriptInfoLine;
-		else if (low == "[aegisub project garbage]")
+		else if (boost::iequals(data, "[aegisub project garbage]"))
 			state = &AssParser::ParseMetadataLine;
-		else if (low == "[aegisub extradata]")
+		else if (boost::iequals(data, "[aegisub extradata]"))
 			state = &AssParser::ParseExtradataLine;
-		else if (low == "[graphics]")
+		else if (boost::iequals(data, "[graphics]"))
 			state = &AssParser::ParseGraphicsLine;
-		else if (low == "[fonts]")
+		else if (boost::iequals(data, "[fonts]"))
 			state = &AssParser::ParseFontLine;
 		else
 			state = &AssParser::UnknownLine;
@@ -265,3 +278,30 @@ void AssParser::AddLine(std::string const& data) {
 
 	(this->*state)(data);
 }
+
+void AssParser::Finish() {
+	if (pending_event_ends.empty()) return;
+
+	std::string data = std::move(pending_events);
+	std::vector<size_t> ends = std::move(pending_event_ends);
+	pending_events.clear();
+	pending_event_ends.clear();
+	int first_id = AssDialogue::ReserveIds(static_cast<int>(ends.size()));
+
+	std::vector<std::vector<std::unique_ptr<AssDialogue>>> chunks((ends.size() + event_chunk_size - 1) / event_chunk_size);
+	agi::dispatch::ParallelFor(chunks.size(), [&](size_t i) {
+		size_t end = std::min(ends.size(), (i + 1) * event_chunk_size);
+		chunks[i].reserve(end - i * event_chunk_size);
+		for (size_t line = i * event_chunk_size; line < end; ++line) {
+			size_t start = line ? ends[line - 1] : 0;
+			chunks[i].emplace_back(agi::make_unique<AssDialogue>(
+				boost::string_ref(data.data() + start, ends[line] - start),
+				first_id + static_cast<int>(line)));
+		}
+	});
+
+	for (auto& chunk : chunks) {
+		for (auto& line : chunk)
+			target->Events.push_back(*line.release());
+	}
+}
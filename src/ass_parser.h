@@ -12,7 +12,10 @@
 // ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
 // OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
+#include <boost/utility/string_ref.hpp>
 #include <memory>
+#include <string>
+#include <vector>
 
 class AssAttachment;
 class AssFile;
@@ -24,20 +27,39 @@ class AssParser {
 	AssFile *target;
 	int version;
 	std::unique_ptr<AssAttachment> attach;
-	void (AssParser::*state)(std::string const&);
-
-	void ParseAttachmentLine(std::string const& data);
-	void ParseEventLine(std::string const& data);
-	void ParseStyleLine(std::string const& data);
-	void ParseScriptInfoLine(std::string const& data);
-	void ParseMetadataLine(std::string const& data);
-	void ParseFontLine(std::string const& data);
-	void ParseGraphicsLine(std::string const& data);
-	void ParseExtradataLine(std::string const &data);
-	void UnknownLine(std::string const&) { }
+	void (AssParser::*state)(boost::string_ref);
+
+	/// Parse dialogue lines in Finish() rather than as they're added
+	bool parallel_events;
+	/// Dialogue lines waiting to be parsed, stored end-to-end
+	std::string pending_events;
+	/// Offset of the end of each line in pending_events
+	std::vector<size_t> pending_event_ends;
+
+	void ParseAttachmentLine(boost::string_ref data);
+	void ParseEventLine(boost::string_ref data);
+	void ParseStyleLine(boost::string_ref data);
+	void ParseScriptInfoLine(boost::string_ref data);
+	void ParseMetadataLine(boost::string_ref data);
+	void ParseFontLine(boost::string_ref data);
+	void ParseGraphicsLine(boost::string_ref data);
+	void ParseExtradataLine(boost::string_ref data);
+	void UnknownLine(boost::string_ref) { }
 public:
-	AssParser(AssFile *target, int version);
+	/// @param target File to add the parsed entries to
+	/// @param version Initial SSA version; 0 for v4, 1 for v4+
+	/// @param parallel_events Parse the dialogue lines on the background
+	///                        thread pool once all of the lines have been
+	///                        added. Finish() must be called when this is set.
+	AssParser(AssFile *target, int version, bool parallel_events = false);
 	~AssParser();
 
-	void AddLine(std::string const& data);
+	void AddLine(boost::string_ref data);
+
+	/// Parse any dialogue lines which were deferred and add them to the file
+	///
+	/// The lines are added in file order and get the same IDs they would have
+	/// gotten if they were parsed one at a time. If any line fails to parse,
+	/// the error for the first such line is thrown and nothing is added.
+	void Finish();
 };
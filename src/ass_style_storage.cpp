@@ -122,6 +122,7 @@ void AssStyleStorage::ReplaceIntoFile(AssFile &file) {
 	for (auto const& s : style) {
 		delete file.GetStyle(s->name);
 		file.Styles.push_back(*new AssStyle(*s));
+		file.StylesChanged();
 	}
 }
 
@@ -0,0 +1,156 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "ass_time_index.h"
+
+#include "ass_dialogue.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+/// Value of the tree's empty leaves, which are never still going
+const int no_end = INT_MIN;
+
+template<class Entry>
+bool starts_before(Entry const& entry, int time) {
+	return entry.start < time;
+}
+
+template<class Entry>
+bool starts_after(int time, Entry const& entry) {
+	return time < entry.start;
+}
+}
+
+void AssTimeIndex::Invalidate() {
+	valid = false;
+	entries.clear();
+	max_end.clear();
+	position.clear();
+}
+
+void AssTimeIndex::Sort() {
+	for (auto& entry : entries) {
+		entry.start = entry.line->Start;
+		entry.end = entry.line->End;
+	}
+	std::stable_sort(begin(entries), end(entries), [](Entry const& a, Entry const& b) {
+		return a.start < b.start;
+	});
+
+	leaves = 1;
+	while (leaves < entries.size())
+		leaves *= 2;
+	max_end.assign(leaves * 2, no_end);
+	position.resize(entries.size());
+	if (!entries.empty())
+		UpdateTree(0, entries.size() - 1);
+	valid = true;
+}
+
+void AssTimeIndex::UpdateTree(size_t first, size_t last) {
+	for (size_t i = first; i <= last; ++i) {
+		max_end[leaves + i] = entries[i].end;
+		position[entries[i].row] = i;
+	}
+
+	for (first = (leaves + first) / 2, last = (leaves + last) / 2; first > 0; first /= 2, last /= 2) {
+		for (size_t i = first; i <= last; ++i)
+			max_end[i] = std::max(max_end[i * 2], max_end[i * 2 + 1]);
+	}
+}
+
+std::vector<AssTimeIndex::Entry>::iterator AssTimeIndex::Find(AssDialogue const* line) {
+	// The line's row is where it was when the index was built unless lines
+	// have been added or removed without the index being invalidated
+	if (line->Row >= 0 && static_cast<size_t>(line->Row) < position.size()) {
+		auto it = begin(entries) + position[line->Row];
+		if (it->line == line)
+			return it;
+	}
+	return std::find_if(begin(entries), end(entries), [=](Entry const& e) { return e.line == line; });
+}
+
+void AssTimeIndex::Update(AssDialogue *line, AssDialogue const* old) {
+	if (!valid) return;
+
+	auto it = Find(old ? old : line);
+	if (it == end(entries)) {
+		Invalidate();
+		return;
+	}
+
+	Entry entry = *it;
+	entry.start = line->Start;
+	entry.end = line->End;
+	entry.line = line;
+
+	// Shift the lines between the old and new positions over by one to
+	// make room, which for small changes to the times is only a few lines
+	size_t from = it - begin(entries);
+	size_t to;
+	if (entry.start < it->start) {
+		auto pos = std::upper_bound(begin(entries), it, entry.start, starts_after<Entry>);
+		std::move_backward(pos, it, it + 1);
+		to = pos - begin(entries);
+	}
+	else {
+		auto pos = std::lower_bound(it + 1, end(entries), entry.start, starts_before<Entry>);
+		std::move(it + 1, pos, it);
+		to = pos - begin(entries) - 1;
+	}
+	entries[to] = entry;
+	UpdateTree(std::min(from, to), std::max(from, to));
+}
+
+void AssTimeIndex::AddActive(size_t node, size_t first, size_t width, size_t end, int time, std::vector<Entry const*>& out) const {
+	if (first >= end || max_end[node] <= time) return;
+	if (width == 1) {
+		out.push_back(&entries[first]);
+		return;
+	}
+
+	width /= 2;
+	AddActive(node * 2, first, width, end, time, out);
+	AddActive(node * 2 + 1, first + width, width, end, time, out);
+}
+
+std::vector<AssDialogue *> AssTimeIndex::InFileOrder(std::vector<Entry const*>& matches) {
+	sort(begin(matches), end(matches), [](Entry const* a, Entry const* b) { return a->row < b->row; });
+
+	std::vector<AssDialogue *> lines;
+	lines.reserve(matches.size());
+	for (auto entry : matches)
+		lines.push_back(entry->line);
+	return lines;
+}
+
+std::vector<AssDialogue *> AssTimeIndex::GetActive(int time) const {
+	// Lines which start at or before time and end after it
+	auto last = std::upper_bound(begin(entries), end(entries), time, starts_after<Entry>);
+	std::vector<Entry const*> matches;
+	AddActive(1, 0, leaves, last - begin(entries), time, matches);
+	return InFileOrder(matches);
+}
+
+std::vector<AssDialogue *> AssTimeIndex::GetOverlapping(int start, int end) const {
+	// Lines which start before end and end after start
+	auto last = std::lower_bound(begin(entries), std::end(entries), end, starts_before<Entry>);
+	std::vector<Entry const*> matches;
+	AddActive(1, 0, leaves, last - begin(entries), start, matches);
+	return InFileOrder(matches);
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class AssDialogue;
+
+/// @class AssTimeIndex
+/// @brief Index of a file's dialogue lines by the time span they cover
+///
+/// The lines are kept sorted by start time, with a binary tree over them
+/// holding the latest end time of each subtree. Finding the lines which
+/// cover a time is a binary search for the lines which start before it and
+/// then a walk down the tree which skips every subtree that has ended
+/// already, so it only touches the parts of the tree which lead to matches.
+/// Spans of time work the same way, searching for the lines which start
+/// before the span ends and skipping those which end before it starts.
+///
+/// The index doesn't own the lines, and has to be told about any line which
+/// is added, removed, reordered or retimed.
+class AssTimeIndex {
+	struct Entry {
+		int start;
+		int end;
+		/// Position of the line in the file
+		size_t row;
+		AssDialogue *line;
+	};
+
+	/// All of the lines, sorted by start time
+	std::vector<Entry> entries;
+	/// Latest end time in each subtree, with node i's children at 2i and
+	/// 2i + 1 and the entries' own end times at leaves + i
+	std::vector<int> max_end;
+	/// Index in entries of the line at each row of the file
+	std::vector<size_t> position;
+	size_t leaves = 0;
+	bool valid = false;
+
+	/// Fill in the times of the entries, sort them and build the tree
+	void Sort();
+	/// Recalculate the tree and positions for the entries from first to
+	/// last, inclusive
+	void UpdateTree(size_t first, size_t last);
+	/// Find the entry for a line, or end(entries) if it isn't in the index
+	std::vector<Entry>::iterator Find(AssDialogue const* line);
+	/// Add the lines in the subtree at node which are before end and are
+	/// still going at time
+	/// @param first Index of the subtree's first entry
+	/// @param width Number of leaves in the subtree
+	void AddActive(size_t node, size_t first, size_t width, size_t end, int time, std::vector<Entry const*>& out) const;
+	/// Sort matches back into file order
+	static std::vector<AssDialogue *> InFileOrder(std::vector<Entry const*>& matches);
+
+public:
+	/// Has the index been built since the last time it was invalidated?
+	bool IsValid() const { return valid; }
+	/// Discard the index until the next time Build is called
+	void Invalidate();
+
+	/// Build the index from scratch
+	/// @param events Dialogue lines in file order
+	template<class Events>
+	void Build(Events& events) {
+		entries.clear();
+		size_t row = 0;
+		for (auto& line : events)
+			entries.push_back(Entry{0, 0, row++, &line});
+		Sort();
+	}
+
+	/// Update the index after a line's times change
+	/// @param line Line with the new times
+	/// @param old Line which line replaced at the same position in the file,
+	///            or nullptr if line was retimed in place
+	///
+	/// If the line isn't in the index, the index is invalidated.
+	void Update(AssDialogue *line, AssDialogue const* old = nullptr);
+
+	/// Get the lines which are visible at a time, in file order
+	///
+	/// Comments are included, so callers which want only the lines which
+	/// would be rendered have to skip them.
+	std::vector<AssDialogue *> GetActive(int time) const;
+
+	/// Get the lines which overlap the span [start, end), in file order
+	///
+	/// A line overlaps the span if it starts before end and ends after
+	/// start. As with GetActive, comments are included.
+	std::vector<AssDialogue *> GetOverlapping(int start, int end) const;
+};
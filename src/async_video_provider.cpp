@@ -16,21 +16,74 @@
 
 #include "async_video_provider.h"
 
+#include "ass_attachment.h"
 #include "ass_dialogue.h"
 #include "ass_file.h"
+#include "ass_info.h"
+#include "ass_style.h"
 #include "export_fixstyle.h"
 #include "include/aegisub/subtitles_provider.h"
+#include "options.h"
 #include "video_frame.h"
 #include "video_provider_manager.h"
 
 #include <libaegisub/dispatch.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
+
+#include <algorithm>
+#include <cmath>
 
 enum {
 	NEW_SUBS_FILE = -1,
 	SUBS_FILE_ALREADY_LOADED = -2
 };
 
-std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, double time, bool raw) {
+namespace {
+std::vector<AssDialogueBase const*> get_visible_lines(AssFile *subs, double time) {
+	std::vector<AssDialogueBase const*> visible_lines;
+	for (auto line : subs->GetEventsAt(static_cast<int>(std::floor(time)))) {
+		if (!line->Comment)
+			visible_lines.push_back(line);
+	}
+	return visible_lines;
+}
+
+/// Do two versions of a line look the same when drawn on the same frame?
+bool same_appearance(AssDialogueBase const& last, AssDialogueBase const& cur) {
+	if (last.Layer  != cur.Layer)  return false;
+	if (last.Margin != cur.Margin) return false;
+	if (last.Style  != cur.Style)  return false;
+	if (last.Effect != cur.Effect) return false;
+	if (last.Text   != cur.Text)   return false;
+
+	// Changing the start/end time effects the appearance only if the
+	// line is animated. This is obviously not a very accurate check for
+	// animated lines, but false positives aren't the end of the world
+	if ((last.Start != cur.Start || last.End != cur.End) &&
+		(!cur.Effect.get().empty() || cur.Text.get().find('\\') != std::string::npos))
+		return false;
+
+	return true;
+}
+
+/// Get everything outside of the lines which affects how they're drawn
+std::string get_render_header(AssFile const& subs) {
+	std::string header;
+	for (auto const& info : subs.Info)
+		header += info.GetEntryData() + "\n";
+	for (auto const& style : subs.Styles)
+		header += style.GetEntryData() + "\n";
+	// Attached fonts can change the rendering, so a different file with the
+	// same name has to be noticed. The hashes are shared by copies of the
+	// attachment, so each one is only hashed once.
+	for (auto const& attachment : subs.Attachments)
+		header += attachment.GetFileName(true) + ": " + std::to_string(attachment.GetSize()) + " " + std::to_string(attachment.GetHash()) + "\n";
+	return header;
+}
+}
+
+std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, double time, bool raw, std::vector<AssDialogueBase const*> const *lines) {
 	// Find an unused buffer to use or allocate a new one if needed
 	std::shared_ptr<VideoFrame> frame;
 	for (auto& buffer : buffers) {
@@ -45,12 +98,42 @@ std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, doub
 		buffers.push_back(frame);
 	}
 
+	// Cancel any queued prefetching so that this doesn't have to wait for it
+	if (!raw) ++prefetch_version;
+
+	bool draw_subs = !raw && subs_provider && subs;
+	std::vector<AssDialogueBase const*> visible_lines;
+	if (draw_subs) {
+		if (!lines) {
+			visible_lines = get_visible_lines(subs.get(), time);
+			lines = &visible_lines;
+		}
+
+		// Reuse the frame if it was rendered recently with the same lines
+		auto it = find_if(begin(rendered), end(rendered), [&](RenderedFrame const& r) {
+			return r.frame_number == frame_number && r.time == time
+				&& r.lines.size() == lines->size()
+				&& std::equal(begin(r.lines), end(r.lines), begin(*lines),
+					[](AssDialogueBase const& a, AssDialogueBase const* b) { return same_appearance(a, *b); });
+		});
+		if (it != end(rendered)) {
+			++render_cache_hits;
+			rendered.splice(begin(rendered), rendered, it);
+			*frame = *it->frame;
+			StartPrefetch(frame_number, frame->pitch * frame->height);
+			return frame;
+		}
+		++render_cache_misses;
+	}
+
 	try {
-		source_provider->GetFrame(frame_number, *frame);
+		decoder->Sync([&] { source_provider->GetFrame(frame_number, *frame); });
 	}
 	catch (VideoProviderError const& err) { throw VideoProviderErrorEvent(err); }
 
-	if (raw || !subs_provider || !subs) return frame;
+	if (!raw) StartPrefetch(frame_number, frame->pitch * frame->height);
+
+	if (!draw_subs) return frame;
 
 	try {
 		if (single_frame != frame_number && single_frame != SUBS_FILE_ALREADY_LOADED) {
@@ -75,12 +158,79 @@ std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, doub
 
 	try {
 		subs_provider->DrawSubtitles(*frame, time / 1000.);
+
+		// The copy shares the pixels with the frame until one of them is
+		// written to
+		RenderedFrame entry{frame_number, time, {}, std::make_shared<VideoFrame>(*frame)};
+		entry.lines.reserve(lines->size());
+		for (auto line : *lines)
+			entry.lines.push_back(*line);
+		rendered.push_front(std::move(entry));
+
+		// Bounded by size rather than count, as a 4K frame is 32 MB
+		const size_t max_size = std::max<int64_t>(0, OPT_GET("Provider/Video/Render Cache/Size")->GetInt()) << 20; // convert MB to bytes
+		size_t size = 0;
+		for (auto it = begin(rendered); it != end(rendered); ++it) {
+			size += it->frame->pitch * it->frame->height;
+			if (size > max_size) {
+				rendered.erase(it, end(rendered));
+				break;
+			}
+		}
 	}
 	catch (agi::UserCancelException const&) { }
 
 	return frame;
 }
 
+void AsyncVideoProvider::ClearRenderCache() {
+	if (render_cache_hits || render_cache_misses)
+		LOG_D("video/render_cache") << render_cache_hits << " hits, " << render_cache_misses << " misses";
+	render_cache_hits = render_cache_misses = 0;
+	rendered.clear();
+}
+
+void AsyncVideoProvider::StartPrefetch(int frame, size_t frame_size) {
+	int delta = frame - last_decoded;
+	last_decoded = frame;
+
+	int count = OPT_GET("Provider/Video/Prefetch Frames")->GetInt();
+
+	// Frames which don't fit in the decoded frame cache along with the
+	// current one would be evicted before they're asked for
+	if (frame_size > 0 && count > 0) {
+		const size_t max_cache_size = OPT_GET("Provider/Video/Cache/Size")->GetInt() << 20; // convert MB to bytes
+		const size_t cache_frames = std::max<size_t>(1, (max_cache_size + frame_size - 1) / frame_size);
+		count = static_cast<int>(std::min<size_t>(count, cache_frames - 1));
+	}
+
+	if (delta == 0 || count <= 0) return;
+
+	// Playing video or stepping through it moves a few frames at a time;
+	// anything further is a seek and there's nothing to predict
+	if (delta > count || delta < -count) return;
+
+	PrefetchNext(prefetch_version, frame + (delta > 0 ? 1 : -1), delta > 0 ? 1 : -1, count);
+}
+
+void AsyncVideoProvider::PrefetchNext(uint_fast32_t req_version, int frame, int direction, int count) {
+	decoder->Async([=] {
+		if (req_version != prefetch_version) return;
+		if (frame < 0 || frame >= source_provider->GetFrameCount()) return;
+
+		try {
+			source_provider->Prefetch(frame);
+		}
+		catch (VideoProviderError const&) {
+			// Errors will be reported if the frame is actually requested
+			return;
+		}
+
+		if (count > 1)
+			PrefetchNext(req_version, frame + direction, direction, count - 1);
+	});
+}
+
 static std::unique_ptr<SubtitlesProvider> get_subs_provider(wxEvtHandler *evt_handler, agi::BackgroundRunner *br) {
 	try {
 		return SubtitlesProviderFactory::GetProvider(br);
@@ -93,6 +243,7 @@ static std::unique_ptr<SubtitlesProvider> get_subs_provider(wxEvtHandler *evt_ha
 
 AsyncVideoProvider::AsyncVideoProvider(agi::fs::path const& video_filename, std::string const& colormatrix, wxEvtHandler *parent, agi::BackgroundRunner *br)
 : worker(agi::dispatch::Create())
+, decoder(agi::dispatch::Create())
 , subs_provider(get_subs_provider(parent, br))
 , source_provider(VideoProviderFactory::GetProvider(video_filename, colormatrix, br))
 , parent(parent)
@@ -100,16 +251,33 @@ AsyncVideoProvider::AsyncVideoProvider(agi::fs::path const& video_filename, std:
 }
 
 AsyncVideoProvider::~AsyncVideoProvider() {
+	++prefetch_version;
+	++playback_version;
+
 	// Block until all currently queued jobs are complete
 	worker->Sync([]{});
+	decoder->Sync([]{});
+
+	ClearRenderCache();
 }
 
 void AsyncVideoProvider::LoadSubtitles(const AssFile *new_subs) throw() {
 	uint_fast32_t req_version = ++version;
 
-	auto copy = new AssFile(*new_subs);
+	auto snapshot = new_subs->GetSnapshot();
 	worker->Async([=]{
-		subs.reset(copy);
+		subs = agi::make_unique<AssFile>(*snapshot);
+
+		// Frames drawn with different styles aren't any use
+		auto header = get_render_header(*subs);
+		if (header != rendered_header) {
+			ClearRenderCache();
+			rendered_header = std::move(header);
+		}
+
+		rows.clear();
+		for (auto& line : subs->Events)
+			rows.push_back(&line);
 		single_frame = NEW_SUBS_FILE;
 		ProcAsync(req_version, false);
 	});
@@ -122,14 +290,16 @@ void AsyncVideoProvider::UpdateSubtitles(const AssFile *new_subs, const AssDialo
 	// same index in the worker's copy of the file with the new entry
 	auto copy = new AssDialogue(*changed);
 	worker->Async([=]{
-		int i = 0;
-		auto it = subs->Events.begin();
-		std::advance(it, copy->Row - i);
-		i = copy->Row;
-		subs->Events.insert(it, *copy);
-		delete &*it--;
-
-		single_frame = NEW_SUBS_FILE;
+		auto old = rows[copy->Row];
+		subs->Events.insert(subs->Events.iterator_to(*old), *copy);
+		subs->EventTimesChanged(copy, old);
+		delete old;
+		rows[copy->Row] = copy;
+
+		// Update just the changed line in the subtitle provider if it
+		// supports that, or reload the file if not
+		if (single_frame == NEW_SUBS_FILE || !subs_provider || !subs_provider->UpdateLine(*copy))
+			single_frame = NEW_SUBS_FILE;
 		ProcAsync(req_version, true);
 	});
 }
@@ -146,7 +316,7 @@ void AsyncVideoProvider::RequestFrame(int new_frame, double new_time) throw() {
 
 bool AsyncVideoProvider::NeedUpdate(std::vector<AssDialogueBase const*> const& visible_lines) {
 	// Always need to render after a seek
-	if (single_frame != NEW_SUBS_FILE || frame_number != last_rendered)
+	if (frame_number != last_rendered)
 		return true;
 
 	// Obviously need to render if the number of visible lines has changed
@@ -154,19 +324,7 @@ bool AsyncVideoProvider::NeedUpdate(std::vector<AssDialogueBase const*> const& v
 		return true;
 
 	for (size_t i = 0; i < last_lines.size(); ++i) {
-		auto const& last = last_lines[i];
-		auto const& cur = *visible_lines[i];
-		if (last.Layer  != cur.Layer)  return true;
-		if (last.Margin != cur.Margin) return true;
-		if (last.Style  != cur.Style)  return true;
-		if (last.Effect != cur.Effect) return true;
-		if (last.Text   != cur.Text)   return true;
-
-		// Changing the start/end time effects the appearance only if the
-		// line is animated. This is obviously not a very accurate check for
-		// animated lines, but false positives aren't the end of the world
-		if ((last.Start != cur.Start || last.End != cur.End) &&
-			(!cur.Effect.get().empty() || cur.Text.get().find('\\') != std::string::npos))
+		if (!same_appearance(last_lines[i], *visible_lines[i]))
 			return true;
 	}
 
@@ -177,12 +335,20 @@ void AsyncVideoProvider::ProcAsync(uint_fast32_t req_version, bool check_updated
 	// Only actually produce the frame if there's no queued changes waiting
 	if (req_version < version || frame_number < 0) return;
 
-	std::vector<AssDialogueBase const*> visible_lines;
-	for (auto const& line : subs->Events) {
-		if (!line.Comment && !(line.Start > time || line.End <= time))
-			visible_lines.push_back(&line);
+	// The frames rendered ahead of playback have the old subtitles drawn on
+	// them, and those are what will be shown next rather than frame_number
+	if (playing) {
+		{
+			std::lock_guard<std::mutex> lock(playback_mutex);
+			playback_frames.clear();
+		}
+		playback_next = playback_wanted;
+		QueueRenderAhead();
+		return;
 	}
 
+	auto visible_lines = get_visible_lines(subs.get(), time);
+
 	if (check_updated && !NeedUpdate(visible_lines)) return;
 
 	last_lines.clear();
@@ -192,7 +358,7 @@ void AsyncVideoProvider::ProcAsync(uint_fast32_t req_version, bool check_updated
 	last_rendered = frame_number;
 
 	try {
-		FrameReadyEvent *evt = new FrameReadyEvent(ProcFrame(frame_number, time), time);
+		FrameReadyEvent *evt = new FrameReadyEvent(ProcFrame(frame_number, time, false, &visible_lines), time);
 		evt->SetEventType(EVT_FRAME_READY);
 		parent->QueueEvent(evt);
 	}
@@ -208,8 +374,127 @@ std::shared_ptr<VideoFrame> AsyncVideoProvider::GetFrame(int frame, double time,
 	return ret;
 }
 
+void AsyncVideoProvider::StartPlayback(int first, int end, agi::vfr::Framerate const& fps) {
+	uint_fast32_t req_version = ++playback_version;
+	playback_wanted = first;
+	playback_waiting = -1;
+	{
+		std::lock_guard<std::mutex> lock(playback_mutex);
+		playback_frames.clear();
+		playback_stats = PlaybackStats();
+	}
+
+	worker->Async([=] {
+		if (req_version != playback_version) return;
+		playing = true;
+		playback_next = first;
+		playback_end = end;
+		playback_fps = fps;
+		QueueRenderAhead();
+	});
+}
+
+void AsyncVideoProvider::QueueRenderAhead() {
+	{
+		std::lock_guard<std::mutex> lock(playback_mutex);
+		size_t max_frames = std::max<int64_t>(1, OPT_GET("Provider/Video/Playback Frames")->GetInt());
+		if (render_ahead_queued || playback_frames.size() >= max_frames) return;
+		render_ahead_queued = true;
+	}
+
+	uint_fast32_t req_version = playback_version;
+	worker->Async([=] { RenderAhead(req_version); });
+}
+
+void AsyncVideoProvider::RenderAhead(uint_fast32_t req_version) {
+	{
+		std::lock_guard<std::mutex> lock(playback_mutex);
+		render_ahead_queued = false;
+		if (req_version != playback_version) return;
+
+		// Frames which were due before the clock got to the one it's at now
+		// would only be thrown away, so skip straight to it
+		int wanted = playback_wanted;
+		if (playback_next < wanted) {
+			playback_stats.dropped += wanted - playback_next;
+			playback_next = wanted;
+		}
+
+		size_t max_frames = std::max<int64_t>(1, OPT_GET("Provider/Video/Playback Frames")->GetInt());
+		if (playback_next >= playback_end || playback_frames.size() >= max_frames) return;
+	}
+
+	int frame = playback_next++;
+	double frame_time = playback_fps.TimeAtFrame(frame);
+	try {
+		auto rendered_frame = ProcFrame(frame, frame_time);
+		std::lock_guard<std::mutex> lock(playback_mutex);
+		if (req_version != playback_version) return;
+		playback_frames.push_back(PlaybackFrame{frame, frame_time, std::move(rendered_frame)});
+	}
+	catch (wxEvent const& err) {
+		// Pass error back to parent thread, and give up on rendering ahead
+		// rather than failing on every frame
+		parent->QueueEvent(err.Clone());
+		return;
+	}
+
+	QueueRenderAhead();
+}
+
+int AsyncVideoProvider::ShowPlaybackFrame(int frame) {
+	FrameReadyEvent *evt = nullptr;
+	int shown = -1;
+	{
+		std::lock_guard<std::mutex> lock(playback_mutex);
+		// Show the latest frame which is due, as when rendering can't keep up
+		// a late frame is better than not changing the picture at all
+		auto due = find_if(begin(playback_frames), end(playback_frames),
+			[=](PlaybackFrame const& f) { return f.frame_number > frame; });
+		if (due != begin(playback_frames)) {
+			auto& ready = *std::prev(due);
+			shown = ready.frame_number;
+			evt = new FrameReadyEvent(std::move(ready.frame), ready.time);
+
+			++playback_stats.shown;
+			playback_stats.dropped += distance(begin(playback_frames), due) - 1;
+			if (shown < frame || shown == playback_waiting)
+				++playback_stats.late;
+			playback_frames.erase(begin(playback_frames), due);
+		}
+		else
+			playback_waiting = frame;
+	}
+	playback_wanted = evt ? frame + 1 : frame;
+
+	// Showing a frame makes room for another
+	QueueRenderAhead();
+
+	if (evt) {
+		evt->SetEventType(EVT_FRAME_READY);
+		parent->QueueEvent(evt);
+	}
+	return shown;
+}
+
+void AsyncVideoProvider::StopPlayback() {
+	++playback_version;
+
+	PlaybackStats stats;
+	{
+		std::lock_guard<std::mutex> lock(playback_mutex);
+		playback_frames.clear();
+		stats = playback_stats;
+	}
+	worker->Async([=] { playing = false; });
+
+	if (stats.shown || stats.dropped)
+		LOG_I("video/playback") << stats.shown << " frames shown, " << stats.late << " late, " << stats.dropped << " dropped";
+}
+
 void AsyncVideoProvider::SetColorSpace(std::string const& matrix) {
-	worker->Async([=] { source_provider->SetColorSpace(matrix); });
+	decoder->Async([=] { source_provider->SetColorSpace(matrix); });
+	worker->Async([=] { ClearRenderCache(); });
 }
 
 wxDEFINE_EVENT(EVT_FRAME_READY, FrameReadyEvent);
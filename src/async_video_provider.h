@@ -20,7 +20,10 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <atomic>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <wx/event.h>
 
@@ -37,9 +40,15 @@ namespace agi {
 }
 
 /// An asynchronous video decoding and subtitle rendering wrapper
+///
+/// Subtitles are rendered on one queue and frames are decoded on another, so
+/// that while one frame is having subtitles drawn on it the frames after it
+/// can be decoded ahead of time.
 class AsyncVideoProvider {
-	/// Asynchronous work queue
+	/// Asynchronous work queue for rendering subtitles
 	std::unique_ptr<agi::dispatch::Queue> worker;
+	/// Work queue for all use of source_provider
+	std::unique_ptr<agi::dispatch::Queue> decoder;
 
 	/// Subtitles provider
 	std::unique_ptr<SubtitlesProvider> subs_provider;
@@ -53,6 +62,9 @@ class AsyncVideoProvider {
 
 	/// Copy of the subtitles file to avoid having to touch the project context
 	std::unique_ptr<AssFile> subs;
+	/// The lines of subs by row, so that a changed line can be swapped in
+	/// without walking the list of events to find the one it replaces
+	std::vector<AssDialogue *> rows;
 
 	/// If >= 0, the subtitles provider current has just the lines visible on
 	/// that frame loaded. If -1, the entire file is loaded. If -2, the
@@ -67,7 +79,41 @@ class AsyncVideoProvider {
 	/// lines have actually changed
 	bool NeedUpdate(std::vector<AssDialogueBase const*> const& visible_lines);
 
-	std::shared_ptr<VideoFrame> ProcFrame(int frame, double time, bool raw = false);
+	/// @param lines The lines visible at time, if the caller already has them
+	std::shared_ptr<VideoFrame> ProcFrame(int frame, double time, bool raw = false, std::vector<AssDialogueBase const*> const *lines = nullptr);
+
+	/// A frame with subtitles drawn on it, kept so that going back to a frame
+	/// which was rendered recently doesn't have to render it again
+	struct RenderedFrame {
+		int frame_number;
+		double time;
+		/// The visible lines which were drawn on the frame
+		std::vector<AssDialogueBase> lines;
+		std::shared_ptr<VideoFrame> frame;
+	};
+	/// Recently rendered frames, most recently used first
+	std::list<RenderedFrame> rendered;
+	/// Script info, styles and attachments which the rendered frames were
+	/// drawn with, as none of them are part of the lines
+	std::string rendered_header;
+	size_t render_cache_hits = 0;
+	size_t render_cache_misses = 0;
+	/// Log the cache statistics and discard the rendered frames
+	void ClearRenderCache();
+
+	/// Last frame decoded for rendering, used to guess which frames will be
+	/// wanted next
+	int last_decoded = -1;
+	/// Incremented to cancel any prefetching in progress
+	std::atomic<uint_fast32_t> prefetch_version{ 0 };
+	/// Guess which frames will be needed after the given one and start
+	/// decoding as many of them as fit in the frame cache
+	/// @param frame Frame which was just decoded
+	/// @param frame_size Size in bytes of each decoded frame
+	void StartPrefetch(int frame, size_t frame_size);
+	/// Decode the next count frames in the given direction, one at a time so
+	/// that a newer request never waits on more than one speculative decode
+	void PrefetchNext(uint_fast32_t req_version, int frame, int direction, int count);
 
 	/// Produce a frame if req_version is still the current version
 	void ProcAsync(uint_fast32_t req_version, bool check_updated);
@@ -78,6 +124,57 @@ class AsyncVideoProvider {
 
 	std::vector<std::shared_ptr<VideoFrame>> buffers;
 
+	/// A frame rendered ahead of the playback clock
+	struct PlaybackFrame {
+		int frame_number;
+		double time;
+		std::shared_ptr<VideoFrame> frame;
+	};
+	/// What happened to the frames which came up during playback
+	struct PlaybackStats {
+		/// Frames which were shown
+		size_t shown = 0;
+		/// Frames which were shown, but only after they were due
+		size_t late = 0;
+		/// Frames which were never shown because a later frame was due
+		/// before they were ready
+		size_t dropped = 0;
+	};
+
+	/// Guards playback_frames, render_ahead_queued and playback_stats, which
+	/// are shared by the worker and the thread presenting the frames
+	std::mutex playback_mutex;
+	/// Frames rendered ahead of the clock, in order
+	std::deque<PlaybackFrame> playback_frames;
+	/// Is a RenderAhead job waiting on the worker queue?
+	bool render_ahead_queued = false;
+	PlaybackStats playback_stats;
+	/// Frame which ShowPlaybackFrame was last asked for and had nothing to
+	/// show for. Only used on the UI thread, by StartPlayback and
+	/// ShowPlaybackFrame.
+	int playback_waiting = -1;
+	/// Incremented when playback starts or stops, to cancel rendering for the
+	/// previous playback
+	std::atomic<uint_fast32_t> playback_version{ 0 };
+	/// First frame which the clock is at or will get to that hasn't been
+	/// shown yet
+	std::atomic<int> playback_wanted{ 0 };
+
+	/// Is the video playing? Only used on the worker thread, as are the rest
+	bool playing = false;
+	/// Next frame to render ahead
+	int playback_next = 0;
+	/// Frame after the last one to play
+	int playback_end = 0;
+	/// Timecodes to render the frames with
+	agi::vfr::Framerate playback_fps;
+
+	/// Queue RenderAhead if there's room for more frames and it isn't queued
+	void QueueRenderAhead();
+	/// Render the next frame to be played, then queue rendering the one
+	/// after it, so that other requests can be handled in between
+	void RenderAhead(uint_fast32_t req_version);
+
 public:
 	/// @brief Load the passed subtitle file
 	/// @param subs File to load
@@ -108,6 +205,29 @@ public:
 	/// @brief raw   Get raw frame without subtitles
 	std::shared_ptr<VideoFrame> GetFrame(int frame, double time, bool raw = false);
 
+	/// @brief Start rendering frames ahead of playback
+	/// @param first First frame to render
+	/// @param end Frame after the last one to play
+	/// @param fps Timecodes to get the times of the frames from
+	///
+	/// Frames are decoded and rendered on background threads, up to
+	/// Provider/Video/Playback Frames ahead of the last frame shown. While
+	/// playing, subtitle changes rerender the frames ahead rather than the
+	/// last requested frame.
+	void StartPlayback(int first, int end, agi::vfr::Framerate const& fps);
+
+	/// @brief Show the frame which is due at the current playback time
+	/// @param frame Frame which the playback clock is at
+	/// @return The frame shown, or -1 if no frame up to frame was ready
+	///
+	/// FrameReadyEvent is sent for the latest rendered frame up to frame,
+	/// and any rendered frames before it are dropped.
+	int ShowPlaybackFrame(int frame);
+
+	/// Stop rendering ahead, discard any frames which weren't shown, and
+	/// log the frame statistics for the playback
+	void StopPlayback();
+
 	/// Ask the video provider to change YCbCr matricies
 	void SetColorSpace(std::string const& matrix);
 
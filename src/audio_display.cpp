@@ -768,6 +768,12 @@ void AudioDisplay::ReloadRenderingSettings()
 		audio_renderer_provider = agi::make_unique<AudioWaveformRenderer>(colour_scheme_name);
 	}
 
+	// The display owns the renderer, so the connection can't outlive it
+	audio_renderer_provider->AddUpdateListener([=] {
+		audio_renderer->Invalidate();
+		Refresh();
+	});
+
 	audio_renderer->SetRenderer(audio_renderer_provider.get());
 	scrollbar->SetColourScheme(colour_scheme_name);
 	timeline->SetColourScheme(colour_scheme_name);
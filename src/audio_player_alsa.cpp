@@ -137,6 +137,11 @@ do_setup:
 		LOG_D("audio/player/alsa") << "format S16_LE";
 		pcm_format = SND_PCM_FORMAT_S16_LE;
 		break;
+	case 4:
+		if (!provider->AreSamplesFloat()) return;
+		LOG_D("audio/player/alsa") << "format FLOAT";
+		pcm_format = SND_PCM_FORMAT_FLOAT;
+		break;
 	default:
 		return;
 	}
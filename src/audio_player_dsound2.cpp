@@ -319,8 +319,9 @@ void DirectSoundPlayer2Thread::Run()
 	WAVEFORMATEX waveFormat;
 	waveFormat.wFormatTag = WAVE_FORMAT_PCM;
 	waveFormat.nSamplesPerSec = provider->GetSampleRate();
-	waveFormat.nChannels = provider->GetChannels();
-	waveFormat.wBitsPerSample = provider->GetBytesPerSample() * 8;
+	// Always play mono 16-bit audio, downmixing and converting if needed
+	waveFormat.nChannels = 1;
+	waveFormat.wBitsPerSample = 16;
 	waveFormat.nBlockAlign = waveFormat.nChannels * waveFormat.wBitsPerSample / 8;
 	waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
 	waveFormat.cbSize = sizeof(waveFormat);
@@ -351,7 +352,7 @@ void DirectSoundPlayer2Thread::Run()
 	bfr7->Release();
 	bfr7 = 0;
 
-	//wx Log Debug("DirectSoundPlayer2: Created buffer of %d bytes, supposed to be %d milliseconds or %d frames", bufSize, WANTED_LATENCY*BUFFER_LENGTH, bufSize/provider->GetBytesPerSample());
+	//wx Log Debug("DirectSoundPlayer2: Created buffer of %d bytes, supposed to be %d milliseconds or %d frames", bufSize, WANTED_LATENCY*BUFFER_LENGTH, bufSize/waveFormat.nBlockAlign);
 
 	// Now we're ready to roll!
 	SetEvent(thread_running);
@@ -369,7 +370,7 @@ void DirectSoundPlayer2Thread::Run()
 	DWORD buffer_offset = 0;
 	bool playback_should_be_running = false;
 	int current_latency = wanted_latency;
-	const DWORD wanted_latency_bytes = wanted_latency*waveFormat.nSamplesPerSec*provider->GetBytesPerSample()/1000;
+	const DWORD wanted_latency_bytes = wanted_latency*waveFormat.nAvgBytesPerSec/1000;
 
 	while (running)
 	{
@@ -422,7 +423,7 @@ void DirectSoundPlayer2Thread::Run()
 				if (bytes_filled < wanted_latency_bytes)
 				{
 					// Very short playback length, do without streaming playback
-					current_latency = (bytes_filled*1000) / (waveFormat.nSamplesPerSec*provider->GetBytesPerSample());
+					current_latency = (bytes_filled*1000) / waveFormat.nAvgBytesPerSec;
 					if (FAILED(bfr->Play(0, 0, 0)))
 						REPORT_ERROR("Could not start single-buffer playback.")
 				}
@@ -553,7 +554,7 @@ do_fill_buffer:
 				else if (bytes_filled < wanted_latency_bytes)
 				{
 					// Didn't fill as much as we wanted to, let's get back to filling sooner than normal
-					current_latency = (bytes_filled*1000) / (waveFormat.nSamplesPerSec*provider->GetBytesPerSample());
+					current_latency = (bytes_filled*1000) / waveFormat.nAvgBytesPerSec;
 				}
 				else
 				{
@@ -577,7 +578,7 @@ DWORD DirectSoundPlayer2Thread::FillAndUnlockBuffers(void *buf1, DWORD buf1sz, v
 {
 	// Assume buffers have been locked and are ready to be filled
 
-	DWORD bytes_per_frame = provider->GetChannels() * provider->GetBytesPerSample();
+	DWORD bytes_per_frame = sizeof(int16_t);
 	DWORD buf1szf = buf1sz / bytes_per_frame;
 	DWORD buf2szf = buf2sz / bytes_per_frame;
 
@@ -608,7 +609,7 @@ DWORD DirectSoundPlayer2Thread::FillAndUnlockBuffers(void *buf1, DWORD buf1sz, v
 			buf2sz = 0;
 		}
 
-		provider->GetAudioWithVolume(buf1, input_frame, buf1szf, volume);
+		provider->GetInt16MonoAudioWithVolume(static_cast<int16_t *>(buf1), input_frame, buf1szf, volume);
 
 		input_frame += buf1szf;
 	}
@@ -621,7 +622,7 @@ DWORD DirectSoundPlayer2Thread::FillAndUnlockBuffers(void *buf1, DWORD buf1sz, v
 			buf2sz = buf2szf * bytes_per_frame;
 		}
 
-		provider->GetAudioWithVolume(buf2, input_frame, buf2szf, volume);
+		provider->GetInt16MonoAudioWithVolume(static_cast<int16_t *>(buf2), input_frame, buf2szf, volume);
 
 		input_frame += buf2szf;
 	}
@@ -131,8 +131,8 @@ public:
 
         while (!TestDestroy() && parent->cur_frame < parent->end_frame) {
             int rsize = std::min(wsize, parent->end_frame - parent->cur_frame);
-            parent->provider->GetAudioWithVolume(buf, parent->cur_frame,
-                                                 rsize, parent->volume);
+            parent->provider->GetInt16MonoAudioWithVolume(static_cast<int16_t *>(buf),
+                                                          parent->cur_frame, rsize, parent->volume);
             int written = ::write(parent->dspdev, buf, rsize * parent->bpf);
             parent->cur_frame += written / parent->bpf;
         }
@@ -146,7 +146,9 @@ public:
 
 void OSSPlayer::OpenStream()
 {
-    bpf = provider->GetChannels() * provider->GetBytesPerSample();
+    // Not all OSS implementations support float or multichannel audio, so
+    // always play mono 16-bit
+    bpf = sizeof(int16_t);
 
     // Open device
     wxString device = to_wx(OPT_GET("Player/Audio/OSS/Device")->GetString());
@@ -162,24 +164,13 @@ void OSSPlayer::OpenStream()
 #endif
 
     // Set number of channels
-    int channels = provider->GetChannels();
+    int channels = 1;
     if (ioctl(dspdev, SNDCTL_DSP_CHANNELS, &channels) < 0) {
         throw AudioPlayerOpenError("OSS player: setting channels failed");
     }
 
     // Set sample format
-    int sample_format;
-    switch (provider->GetBytesPerSample()) {
-        case 1:
-            sample_format = AFMT_S8;
-            break;
-        case 2:
-            sample_format = AFMT_S16_LE;
-            break;
-        default:
-            throw AudioPlayerOpenError("OSS player: can only handle 8 and 16 bit sound");
-    }
-
+    int sample_format = AFMT_S16_NE;
     if (ioctl(dspdev, SNDCTL_DSP_SETFMT, &sample_format) < 0) {
         throw AudioPlayerOpenError("OSS player: setting sample format failed");
     }
@@ -140,8 +140,11 @@ void PortAudioPlayer::OpenStream() {
 		const PaDeviceInfo *device_info = Pa_GetDeviceInfo((*device_ids)[i]);
 		PaStreamParameters pa_output_p;
 		pa_output_p.device = (*device_ids)[i];
-		pa_output_p.channelCount = provider->GetChannels();
-		pa_output_p.sampleFormat = paInt16;
+		// Play the audio in its native format if the device can take that
+		// many channels, and downmix to mono otherwise
+		downmix = provider->GetChannels() > device_info->maxOutputChannels;
+		pa_output_p.channelCount = downmix ? 1 : provider->GetChannels();
+		pa_output_p.sampleFormat = !downmix && provider->AreSamplesFloat() ? paFloat32 : paInt16;
 		pa_output_p.suggestedLatency = device_info->defaultLowOutputLatency;
 		pa_output_p.hostApiSpecificStreamInfo = nullptr;
 
@@ -222,7 +225,10 @@ int PortAudioPlayer::paCallback(const void *inputBuffer, void *outputBuffer,
 
 	// Play something
 	if (lenAvailable > 0) {
-		player->provider->GetAudioWithVolume(outputBuffer, player->current, lenAvailable, player->GetVolume());
+		if (player->downmix)
+			player->provider->GetInt16MonoAudioWithVolume(static_cast<int16_t *>(outputBuffer), player->current, lenAvailable, player->GetVolume());
+		else
+			player->provider->GetAudioWithVolume(outputBuffer, player->current, lenAvailable, player->GetVolume());
 
 		// Set play position
 		player->current += lenAvailable;
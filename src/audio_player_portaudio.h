@@ -62,6 +62,7 @@ class PortAudioPlayer final : public AudioPlayer {
 	int64_t start = 0;   ///< Start position
 	int64_t end = 0;     ///< End position
 	PaTime pa_start;     ///< PortAudio internal start position
+	bool downmix = false; ///< Is the device being fed mono 16-bit audio rather than the native format?
 
 	PaStream *stream = nullptr; ///< PortAudio stream
 
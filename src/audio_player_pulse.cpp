@@ -135,7 +135,7 @@ PulseAudioPlayer::PulseAudioPlayer(agi::AudioProvider *provider) : AudioPlayer(p
 	// Set up stream
 	bpf = provider->GetChannels() * provider->GetBytesPerSample();
 	pa_sample_spec ss;
-	ss.format = PA_SAMPLE_S16LE; // FIXME
+	ss.format = provider->AreSamplesFloat() ? PA_SAMPLE_FLOAT32NE : PA_SAMPLE_S16NE;
 	ss.rate = provider->GetSampleRate();
 	ss.channels = provider->GetChannels();
 	pa_channel_map map;
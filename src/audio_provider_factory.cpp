@@ -25,6 +25,7 @@
 #include <libaegisub/log.h>
 #include <libaegisub/path.h>
 
+#include <boost/crc.hpp>
 #include <boost/range/iterator_range.hpp>
 
 using namespace agi;
@@ -49,6 +50,28 @@ const factory providers[] = {
 	{"Avisynth", CreateAvisynthAudioProvider, false},
 #endif
 };
+
+/// Get the name of the file to store the waveform peak index for the given
+/// track of an audio file in, using the same naming scheme as the ffms2 index
+/// cache
+fs::path PeakCacheFilename(fs::path const& filename, int track, Path const& path_helper) {
+	try {
+		boost::crc_32_type hash;
+		hash.process_bytes(filename.string().c_str(), filename.string().size());
+
+		auto dir = path_helper.Decode("?local/ffms2cache/");
+		fs::CreateDirectory(dir);
+		CleanCache(dir, "*.peaks",
+			OPT_GET("Provider/FFmpegSource/Cache/Size")->GetInt(),
+			OPT_GET("Provider/FFmpegSource/Cache/Files")->GetInt());
+
+		return dir / (std::to_string(hash.checksum()) + "_" + std::to_string(fs::Size(filename)) + "_" + std::to_string(fs::ModifiedTime(filename)) + "_" + std::to_string(track) + ".peaks");
+	}
+	catch (agi::Exception const& e) {
+		LOG_D("audio_provider") << "Not caching peak index: " << e.GetMessage();
+		return fs::path();
+	}
+}
 }
 
 std::vector<std::string> GetAudioProviderNames() {
@@ -104,16 +127,17 @@ std::unique_ptr<agi::AudioProvider> GetAudioProvider(fs::path const& filename,
 	bool needs_cache = provider->NeedsCache();
 
 	// Give it a converter if needed
-	if (provider->GetBytesPerSample() != 2 || provider->GetSampleRate() < 32000 || provider->GetChannels() != 1)
-		provider = CreateConvertAudioProvider(std::move(provider));
+	provider = CreateConvertAudioProvider(std::move(provider));
 
 	// Change provider to RAM/HD cache if needed
 	int cache = OPT_GET("Audio/Cache/Type")->GetInt();
 	if (!cache || !needs_cache)
 		return CreateLockAudioProvider(std::move(provider));
 
+	auto peak_cache = PeakCacheFilename(filename, provider->GetTrack(), path_helper);
+
 	// Convert to RAM
-	if (cache == 1) return CreateRAMAudioProvider(std::move(provider));
+	if (cache == 1) return CreateRAMAudioProvider(std::move(provider), peak_cache);
 
 	// Convert to HD
 	if (cache == 2) {
@@ -121,8 +145,11 @@ std::unique_ptr<agi::AudioProvider> GetAudioProvider(fs::path const& filename,
 		if (path == "default")
 			path = "?temp";
 		auto cache_dir = path_helper.MakeAbsolute(path_helper.Decode(path), "?temp");
-		return CreateHDAudioProvider(std::move(provider), cache_dir);
+		return CreateHDAudioProvider(std::move(provider), cache_dir, peak_cache);
 	}
 
+	// Convert to compressed RAM
+	if (cache == 3) return CreateCompressedRAMAudioProvider(std::move(provider), peak_cache);
+
 	throw InternalError("Invalid audio caching method");
 }
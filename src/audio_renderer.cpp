@@ -209,6 +209,9 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 	if (origin.x < lastx)
 		renderer->RenderBlank(dc, wxRect(origin.x-1, origin.y, lastx-origin.x+1, pixel_height), style);
 
+	// Get a head start on the next screenful of audio
+	renderer->Prefetch(end, length);
+
 	if (needs_age)
 	{
 		bitmaps[style].Age(cache_bitmap_maxsize);
@@ -37,6 +37,8 @@
 #include "audio_rendering_style.h"
 #include "block_cache.h"
 
+#include <libaegisub/signal.h>
+
 class AudioRenderer;
 class AudioRendererBitmapProvider;
 class wxDC;
@@ -244,6 +246,10 @@ protected:
 	/// Implementations can override this method to do something when the vertical zoom is changed
 	virtual void OnSetAmplitudeScale() { }
 
+	/// Fired when data which was not available for a previous render has become
+	/// available, so that anything rendered since then should be rendered again
+	agi::signal::Signal<> AnnounceUpdate;
+
 public:
 	/// @brief Constructor
 	AudioRendererBitmapProvider() : provider(nullptr), pixel_ms(0), amplitude_scale(0) { };
@@ -287,4 +293,14 @@ public:
 	/// Deriving classes should override this method if they implement any
 	/// kind of caching.
 	virtual void AgeCache(size_t max_size) { }
+
+	/// @brief Start preparing data for a range which will probably be rendered soon
+	/// @param start First pixel from beginning of the audio stream in the range
+	/// @param length Number of pixels in the range
+	///
+	/// Deriving classes which compute their data asynchronously should
+	/// override this method to start doing so.
+	virtual void Prefetch(int start, int length) { }
+
+	DEFINE_SIGNAL_ADDERS(AnnounceUpdate, AddUpdateListener)
 };
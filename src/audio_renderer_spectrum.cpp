@@ -40,32 +40,148 @@
 #endif
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/dispatch.h>
 #include <libaegisub/make_unique.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 #include <wx/image.h>
 #include <wx/dcmemory.h>
 
+namespace {
+/// Number of blocks computed by each background task
+const size_t blocks_per_task = 16;
+
+/// Derives frequency-power data for blocks of audio, with scratch buffers
+/// private to the one thread using it
+class SpectrumDeriver {
+	agi::AudioProvider *provider;
+	size_t derivation_size;
+	size_t derivation_dist;
+
+	/// Scratch area for storing raw audio data
+	std::vector<int16_t> audio_scratch;
+
+#ifdef WITH_FFTW3
+	/// Shared plan, executed with this deriver's arrays
+	fftw_plan dft_plan;
+	/// Input array for FFTW
+	double *dft_input;
+	/// Output array for FFTW
+	fftw_complex *dft_output;
+#else
+	/// Scratch area for doing FFT derivations
+	std::vector<float> fft_scratch;
+#endif
+
+	/// @brief Convert audio data to float range [-1;+1)
+	/// @param count Samples to convert
+	/// @param dest Buffer to fill
+	template<class T>
+	void ConvertToFloat(size_t count, T *dest) {
+		for (size_t si = 0; si < count; ++si)
+		{
+			dest[si] = (T)(audio_scratch[si]) / 32768.0;
+		}
+	}
+
+	SpectrumDeriver(SpectrumDeriver const&) = delete;
+	SpectrumDeriver& operator=(SpectrumDeriver const&) = delete;
+
+public:
+#ifdef WITH_FFTW3
+	SpectrumDeriver(agi::AudioProvider *provider, size_t derivation_size, size_t derivation_dist, fftw_plan dft_plan)
+	: provider(provider)
+	, derivation_size(derivation_size)
+	, derivation_dist(derivation_dist)
+	, audio_scratch(2 << derivation_size)
+	, dft_plan(dft_plan)
+	, dft_input(fftw_alloc_real(2<<derivation_size))
+	, dft_output(fftw_alloc_complex(2<<derivation_size))
+	{
+	}
+
+	~SpectrumDeriver()
+	{
+		fftw_free(dft_input);
+		fftw_free(dft_output);
+	}
+#else
+	SpectrumDeriver(agi::AudioProvider *provider, size_t derivation_size, size_t derivation_dist)
+	: provider(provider)
+	, derivation_size(derivation_size)
+	, derivation_dist(derivation_dist)
+	, audio_scratch(2 << derivation_size)
+	// Allocate scratch for 6x the derivation size:
+	// 2x for the input sample data
+	// 2x for the real part of the output
+	// 2x for the imaginary part of the output
+	, fft_scratch(6 << derivation_size)
+	{
+	}
+#endif
+
+	/// @brief Fill a block with frequency-power data for a time range
+	/// @param      block_index Index of the block to fill data for
+	/// @param[out] block       Address to write the data to
+	void FillBlock(size_t block_index, float *block)
+	{
+		assert(block);
+
+		int64_t first_sample = ((int64_t)block_index) << derivation_dist;
+		provider->GetInt16MonoAudio(&audio_scratch[0], first_sample, 2 << derivation_size);
+
+#ifdef WITH_FFTW3
+		ConvertToFloat(2 << derivation_size, dft_input);
+
+		fftw_execute_dft_r2c(dft_plan, dft_input, dft_output);
+
+		double scale_factor = 9 / sqrt(2 << (derivation_size + 1));
+
+		fftw_complex *o = dft_output;
+		for (size_t si = 1<<derivation_size; si > 0; --si)
+		{
+			*block++ = log10( sqrt(o[0][0] * o[0][0] + o[0][1] * o[0][1]) * scale_factor + 1 );
+			o++;
+		}
+#else
+		ConvertToFloat(2 << derivation_size, &fft_scratch[0]);
+
+		float *fft_input = &fft_scratch[0];
+		float *fft_real = &fft_scratch[0] + (2 << derivation_size);
+		float *fft_imag = &fft_scratch[0] + (4 << derivation_size);
+
+		FFT fft;
+		fft.Transform(2<<derivation_size, fft_input, fft_real, fft_imag);
+
+		float scale_factor = 9 / sqrt(2 * (float)(2<<derivation_size));
+
+		for (size_t si = 1<<derivation_size; si > 0; --si)
+		{
+			// With x in range [0;1], log10(x*9+1) will also be in range [0;1],
+			// although the FFT output can apparently get greater magnitudes than 1
+			// despite the input being limited to [-1;+1).
+			*block++ = log10( sqrt(*fft_real * *fft_real + *fft_imag * *fft_imag) * scale_factor + 1 );
+			fft_real++; fft_imag++;
+		}
+#endif
+	}
+};
+}
+
 /// Allocates blocks of derived data for the audio spectrum
+///
+/// Blocks are produced on the background thread pool and added with Set, so
+/// this only needs to describe them.
 struct AudioSpectrumCacheBlockFactory {
-	typedef std::unique_ptr<float, std::default_delete<float[]>> BlockType;
+	typedef std::unique_ptr<float[]> BlockType;
 
 	/// Pointer back to the owning spectrum renderer
 	AudioSpectrumRenderer *spectrum;
 
-	/// @brief Allocate and fill a data block
-	/// @param i Index of the block to produce data for
-	/// @return Newly allocated and filled block
-	///
-	/// The filling is delegated to the spectrum renderer
-	BlockType ProduceBlock(size_t i)
-	{
-		auto res = new float[((size_t)1)<<spectrum->derivation_size];
-		spectrum->FillBlock(i, res);
-		return BlockType(res);
-	}
-
 	/// @brief Calculate the in-memory size of a spec
 	/// @return The size in bytes of a spectrum cache block
 	size_t GetBlockSize() const
@@ -84,7 +200,22 @@ public:
 	}
 };
 
+/// Bookkeeping for the background tasks of one configuration of the renderer
+///
+/// Tasks hold a reference to this rather than to the renderer, so that they
+/// can tell when their results are no longer wanted.
+struct AudioSpectrumRenderer::WorkState {
+	std::mutex mutex;
+	/// Signalled whenever a task finishes
+	std::condition_variable finished;
+	/// Number of tasks currently computing blocks
+	size_t running = 0;
+	/// Set once the renderer no longer wants any results from this state
+	std::atomic<bool> cancelled{false};
+};
+
 AudioSpectrumRenderer::AudioSpectrumRenderer(std::string const& color_scheme_name)
+: work(std::make_shared<WorkState>())
 {
 	colors.reserve(AudioStyle_MAX);
 	for (int i = 0; i < AudioStyle_MAX; ++i)
@@ -98,41 +229,49 @@ AudioSpectrumRenderer::~AudioSpectrumRenderer()
 	RecreateCache();
 }
 
+void AudioSpectrumRenderer::CancelWork()
+{
+	{
+		std::unique_lock<std::mutex> lock(work->mutex);
+		work->cancelled = true;
+		work->finished.wait(lock, [&] { return work->running == 0; });
+	}
+
+	work = std::make_shared<WorkState>();
+	pending.clear();
+}
+
 void AudioSpectrumRenderer::RecreateCache()
 {
+	CancelWork();
+
 #ifdef WITH_FFTW3
 	if (dft_plan)
 	{
 		fftw_destroy_plan(dft_plan);
-		fftw_free(dft_input);
-		fftw_free(dft_output);
 		dft_plan = nullptr;
-		dft_input = nullptr;
-		dft_output = nullptr;
 	}
 #endif
 
+	cache.reset();
 	if (provider)
 	{
 		size_t block_count = (size_t)((provider->GetNumSamples() + (size_t)(1<<derivation_dist) - 1) >> derivation_dist);
 		cache = agi::make_unique<AudioSpectrumCache>(block_count, this);
 
 #ifdef WITH_FFTW3
-		dft_input = fftw_alloc_real(2<<derivation_size);
-		dft_output = fftw_alloc_complex(2<<derivation_size);
+		// Planning overwrites the arrays, so use temporary ones; the actual
+		// transforms are done on arrays owned by each task
+		double *dft_input = fftw_alloc_real(2<<derivation_size);
+		fftw_complex *dft_output = fftw_alloc_complex(2<<derivation_size);
 		dft_plan = fftw_plan_dft_r2c_1d(
 			2<<derivation_size,
 			dft_input,
 			dft_output,
 			FFTW_MEASURE);
-#else
-		// Allocate scratch for 6x the derivation size:
-		// 2x for the input sample data
-		// 2x for the real part of the output
-		// 2x for the imaginary part of the output
-		fft_scratch.resize(6 << derivation_size);
+		fftw_free(dft_input);
+		fftw_free(dft_output);
 #endif
-		audio_scratch.resize(2 << derivation_size);
 	}
 }
 
@@ -146,6 +285,7 @@ void AudioSpectrumRenderer::SetResolution(size_t _derivation_size, size_t _deriv
 	if (derivation_dist != _derivation_dist)
 	{
 		derivation_dist = _derivation_dist;
+		CancelWork();
 		if (cache)
 			cache->Age(0);
 	}
@@ -157,56 +297,89 @@ void AudioSpectrumRenderer::SetResolution(size_t _derivation_size, size_t _deriv
 	}
 }
 
-template<class T>
-void AudioSpectrumRenderer::ConvertToFloat(size_t count, T *dest) {
-	for (size_t si = 0; si < count; ++si)
-	{
-		dest[si] = (T)(audio_scratch[si]) / 32768.0;
-	}
+size_t AudioSpectrumRenderer::BlockForColumn(int ax) const
+{
+	return (size_t)(ax * pixel_ms * provider->GetSampleRate() / 1000) >> derivation_dist;
 }
 
-void AudioSpectrumRenderer::FillBlock(size_t block_index, float *block)
+void AudioSpectrumRenderer::QueueBlocks(std::vector<size_t> const& blocks)
 {
-	assert(cache);
-	assert(block);
+	if (!cache || !provider) return;
 
-	int64_t first_sample = ((int64_t)block_index) << derivation_dist;
-	provider->GetAudio(&audio_scratch[0], first_sample, 2 << derivation_size);
+	std::vector<size_t> batch;
+	auto submit = [&] {
+		if (batch.empty()) return;
 
+		auto state = work;
+		auto provider = this->provider;
+		auto derivation_size = this->derivation_size;
+		auto derivation_dist = this->derivation_dist;
 #ifdef WITH_FFTW3
-	ConvertToFloat(2 << derivation_size, dft_input);
-
-	fftw_execute(dft_plan);
+		auto dft_plan = this->dft_plan;
+#endif
 
-	double scale_factor = 9 / sqrt(2 << (derivation_size + 1));
+		agi::dispatch::Background().Async([=] {
+			{
+				std::unique_lock<std::mutex> lock(state->mutex);
+				if (state->cancelled) return;
+				++state->running;
+			}
 
-	fftw_complex *o = dft_output;
-	for (size_t si = 1<<derivation_size; si > 0; --si)
-	{
-		*block++ = log10( sqrt(o[0][0] * o[0][0] + o[0][1] * o[0][1]) * scale_factor + 1 );
-		o++;
-	}
+			auto results = std::make_shared<std::vector<std::unique_ptr<float[]>>>();
+			{
+#ifdef WITH_FFTW3
+				SpectrumDeriver deriver(provider, derivation_size, derivation_dist, dft_plan);
 #else
-	ConvertToFloat(2 << derivation_size, &fft_scratch[0]);
+				SpectrumDeriver deriver(provider, derivation_size, derivation_dist);
+#endif
+				for (auto i : batch)
+				{
+					if (state->cancelled) break;
+					results->emplace_back(new float[(size_t)1 << derivation_size]);
+					deriver.FillBlock(i, results->back().get());
+				}
+			}
+
+			if (!state->cancelled)
+			{
+				agi::dispatch::Main().Async([=] {
+					// The renderer cancels the state before it's destroyed,
+					// so it's still alive if the state wasn't cancelled
+					if (!state->cancelled)
+						AddBlocks(state, batch, std::move(*results));
+				});
+			}
 
-	float *fft_input = &fft_scratch[0];
-	float *fft_real = &fft_scratch[0] + (2 << derivation_size);
-	float *fft_imag = &fft_scratch[0] + (4 << derivation_size);
+			std::unique_lock<std::mutex> lock(state->mutex);
+			--state->running;
+			state->finished.notify_all();
+		});
 
-	FFT fft;
-	fft.Transform(2<<derivation_size, fft_input, fft_real, fft_imag);
+		batch.clear();
+	};
 
-	float scale_factor = 9 / sqrt(2 * (float)(2<<derivation_size));
+	for (auto i : blocks)
+	{
+		if (!pending.insert(i).second) continue;
+		batch.push_back(i);
+		if (batch.size() == blocks_per_task)
+			submit();
+	}
+	submit();
+}
 
-	for (size_t si = 1<<derivation_size; si > 0; --si)
+void AudioSpectrumRenderer::AddBlocks(std::shared_ptr<WorkState> const& state, std::vector<size_t> const& indices, std::vector<std::unique_ptr<float[]>> blocks)
+{
+	if (state != work || !cache) return;
+
+	for (size_t i = 0; i < indices.size(); ++i)
 	{
-		// With x in range [0;1], log10(x*9+1) will also be in range [0;1],
-		// although the FFT output can apparently get greater magnitudes than 1
-		// despite the input being limited to [-1;+1).
-		*block++ = log10( sqrt(*fft_real * *fft_real + *fft_imag * *fft_imag) * scale_factor + 1 );
-		fft_real++; fft_imag++;
+		pending.erase(indices[i]);
+		if (i < blocks.size())
+			cache->Set(indices[i], std::move(blocks[i]));
 	}
-#endif
+
+	AnnounceUpdate();
 }
 
 void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle style)
@@ -235,16 +408,32 @@ void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 	int minband = 0;
 	int maxband = 1 << derivation_size;
 
+	// Blocks which need to be computed before this bitmap can be complete
+	std::vector<size_t> missing;
+
 	// ax = absolute x, absolute to the virtual spectrum bitmap
 	for (int ax = start; ax < end; ++ax)
 	{
 		// Derived audio data
-		size_t block_index = (size_t)(ax * pixel_ms * provider->GetSampleRate() / 1000) >> derivation_dist;
-		float *power = &cache->Get(block_index);
+		size_t block_index = BlockForColumn(ax);
+		float *power = cache->TryGet(block_index);
 
 		// Prepare bitmap writing
 		unsigned char *px = imgdata + (imgheight-1) * stride + (ax - start) * 3;
 
+		// Draw silence as a placeholder until the data is ready
+		if (!power)
+		{
+			if (missing.empty() || missing.back() != block_index)
+				missing.push_back(block_index);
+			for (int y = 0; y < imgheight; ++y)
+			{
+				pal->map(0, px);
+				px -= stride;
+			}
+			continue;
+		}
+
 		// Scale up or down vertically?
 		if (imgheight > 1<<derivation_size)
 		{
@@ -278,6 +467,8 @@ void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 		}
 	}
 
+	QueueBlocks(missing);
+
 	wxBitmap tmpbmp(img);
 	wxMemoryDC targetdc(bmp);
 	targetdc.DrawBitmap(tmpbmp, 0, 0);
@@ -292,6 +483,31 @@ void AudioSpectrumRenderer::RenderBlank(wxDC &dc, const wxRect &rect, AudioRende
 	dc.DrawRectangle(rect);
 }
 
+void AudioSpectrumRenderer::Prefetch(int start, int length)
+{
+	if (!cache || length <= 0)
+		return;
+
+	// Only compute blocks whose audio has been decoded, as otherwise they'd
+	// be computed from silence
+	const int64_t decoded = provider->GetDecodedSamples();
+	const bool fully_decoded = decoded == provider->GetNumSamples();
+	const size_t block_count = (size_t)((provider->GetNumSamples() + (1<<derivation_dist) - 1) >> derivation_dist);
+
+	std::vector<size_t> blocks;
+	for (int ax = start; ax < start + length; ++ax)
+	{
+		size_t block_index = BlockForColumn(ax);
+		if (block_index >= block_count) break;
+		if (!fully_decoded && ((int64_t)block_index << derivation_dist) + (2 << derivation_size) > decoded) break;
+		if (!blocks.empty() && blocks.back() == block_index) continue;
+		if (!cache->TryGet(block_index))
+			blocks.push_back(block_index);
+	}
+
+	QueueBlocks(blocks);
+}
+
 void AudioSpectrumRenderer::AgeCache(size_t max_size)
 {
 	if (cache)
@@ -35,6 +35,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "audio_renderer.h"
@@ -52,6 +53,9 @@ struct AudioSpectrumCacheBlockFactory;
 ///
 /// Renders frequency-power spectrum graphs of PCM audio data using a derivation function
 /// such as the fast fourier transform.
+///
+/// The frequency-power data is computed on the background thread pool, and
+/// columns whose data isn't ready yet are drawn as silence until it is.
 class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	friend struct AudioSpectrumCacheBlockFactory;
 
@@ -67,6 +71,13 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// Binary logarithm of number of samples between the start of derivations
 	size_t derivation_dist = 0;
 
+	/// State shared with the background tasks computing blocks
+	struct WorkState;
+	std::shared_ptr<WorkState> work;
+
+	/// Blocks which have been queued for computation and not yet added to the cache
+	std::unordered_set<size_t> pending;
+
 	/// @brief Reset in response to changing audio provider
 	///
 	/// Overrides the OnSetProvider event handler in the base class, to reset things
@@ -79,32 +90,35 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// e.g. new audio provider or new resolution.
 	void RecreateCache();
 
-	/// @brief Fill a block with frequency-power data for a time range
-	/// @param      block_index Index of the block to fill data for
-	/// @param[out] block       Address to write the data to
-	void FillBlock(size_t block_index, float *block);
+	/// @brief Stop all in-progress background computation
+	///
+	/// Waits for any tasks which are currently running to finish, and
+	/// discards the results of all queued tasks.
+	void CancelWork();
+
+	/// @brief Queue blocks for computation on the background thread pool
+	/// @param blocks Indices of the blocks to compute
+	///
+	/// Blocks which are already queued are skipped.
+	void QueueBlocks(std::vector<size_t> const& blocks);
+
+	/// @brief Add blocks computed in the background to the cache
+	/// @param state   The work state the blocks were computed for
+	/// @param indices Indices of the computed blocks
+	/// @param blocks  Data for each of the blocks in indices
+	void AddBlocks(std::shared_ptr<WorkState> const& state, std::vector<size_t> const& indices, std::vector<std::unique_ptr<float[]>> blocks);
 
-	/// @brief Convert audio data to float range [-1;+1)
-	/// @param count Samples to convert
-	/// @param dest Buffer to fill
-	template<class T>
-	void ConvertToFloat(size_t count, T *dest);
+	/// Get the index of the block to use for the given absolute pixel column
+	size_t BlockForColumn(int ax) const;
 
 #ifdef WITH_FFTW3
 	/// FFTW plan data
+	///
+	/// Executed with per-task arrays via the new-array execute functions so
+	/// that it can be shared between threads
 	fftw_plan dft_plan = nullptr;
-	/// Pre-allocated input array for FFTW
-	double *dft_input = nullptr;
-	/// Pre-allocated output array for FFTW
-	fftw_complex *dft_output = nullptr;
-#else
-	/// Pre-allocated scratch area for doing FFT derivations
-	std::vector<float> fft_scratch;
 #endif
 
-	/// Pre-allocated scratch area for storing raw audio data
-	std::vector<int16_t> audio_scratch;
-
 public:
 	/// @brief Constructor
 	/// @param color_scheme_name Name of the color scheme to use
@@ -133,6 +147,9 @@ public:
 	/// is specified too large, it will be clamped to the size.
 	void SetResolution(size_t derivation_size, size_t derivation_dist);
 
+	/// @brief Start computing the data for columns which aren't visible yet
+	void Prefetch(int start, int length) override;
+
 	/// @brief Cleans up the cache
 	/// @param max_size Maximum size in bytes for the cache
 	void AgeCache(size_t max_size) override;
@@ -32,6 +32,7 @@
 #include "audio_colorscheme.h"
 #include "options.h"
 
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/audio/provider.h>
 
 #include <algorithm>
@@ -55,6 +56,44 @@ AudioWaveformRenderer::AudioWaveformRenderer(std::string const& color_scheme_nam
 
 AudioWaveformRenderer::~AudioWaveformRenderer() { }
 
+agi::AudioPeak AudioWaveformRenderer::ScanAudio(int64_t start, int64_t count)
+{
+	agi::AudioPeak peak;
+	if (count <= 0) return peak;
+
+	// Make sure we've got a buffer to fill with audio data
+	if (!audio_buffer)
+	{
+		// Buffer for one pixel strip of audio
+		audio_buffer.reset(new int16_t[count]);
+	}
+
+	provider->GetInt16MonoAudio(audio_buffer.get(), start, count);
+
+	int peak_min = 0, peak_max = 0;
+	int64_t avg_min_accum = 0, avg_max_accum = 0;
+	const int16_t *aud = audio_buffer.get();
+	for (int64_t si = count; si > 0; --si, ++aud)
+	{
+		if (*aud > 0)
+		{
+			peak_max = std::max(peak_max, (int)*aud);
+			avg_max_accum += *aud;
+		}
+		else
+		{
+			peak_min = std::min(peak_min, (int)*aud);
+			avg_min_accum += *aud;
+		}
+	}
+
+	peak.min = peak_min;
+	peak.max = peak_max;
+	peak.avg_min = avg_min_accum / count;
+	peak.avg_max = avg_max_accum / count;
+	return peak;
+}
+
 void AudioWaveformRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle style)
 {
 	wxMemoryDC dc(bmp);
@@ -70,49 +109,25 @@ void AudioWaveformRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 	dc.SetPen(*wxTRANSPARENT_PEN);
 	dc.DrawRectangle(rect);
 
-	// Make sure we've got a buffer to fill with audio data
-	if (!audio_buffer)
-	{
-		// Buffer for one pixel strip of audio
-		size_t buffer_needed = pixel_samples * provider->GetChannels() * provider->GetBytesPerSample();
-		audio_buffer.reset(new char[buffer_needed]);
-	}
-
 	double cur_sample = start * pixel_samples;
 
-	assert(provider->GetBytesPerSample() == 2);
-	assert(provider->GetChannels() == 1);
+	auto peaks = provider->GetPeakIndex();
 
 	wxPen pen_peaks(wxPen(pal->get(0.4f)));
 	wxPen pen_avgs(wxPen(pal->get(0.7f)));
 
 	for (int x = 0; x < rect.width; ++x)
 	{
-		provider->GetAudio(audio_buffer.get(), (int64_t)cur_sample, (int64_t)pixel_samples);
+		agi::AudioPeak peak;
+		if (!peaks || !peaks->Get((int64_t)cur_sample, (int64_t)pixel_samples, peak))
+			peak = ScanAudio((int64_t)cur_sample, (int64_t)pixel_samples);
 		cur_sample += pixel_samples;
 
-		int peak_min = 0, peak_max = 0;
-		int64_t avg_min_accum = 0, avg_max_accum = 0;
-		auto aud = reinterpret_cast<const int16_t *>(audio_buffer.get());
-		for (int si = pixel_samples; si > 0; --si, ++aud)
-		{
-			if (*aud > 0)
-			{
-				peak_max = std::max(peak_max, (int)*aud);
-				avg_max_accum += *aud;
-			}
-			else
-			{
-				peak_min = std::min(peak_min, (int)*aud);
-				avg_min_accum += *aud;
-			}
-		}
-
 		// midpoint is half height
-		peak_min = std::max((int)(peak_min * amplitude_scale * midpoint) / 0x8000, -midpoint);
-		peak_max = std::min((int)(peak_max * amplitude_scale * midpoint) / 0x8000, midpoint);
-		int avg_min = std::max((int)(avg_min_accum * amplitude_scale * midpoint / pixel_samples) / 0x8000, -midpoint);
-		int avg_max = std::min((int)(avg_max_accum * amplitude_scale * midpoint / pixel_samples) / 0x8000, midpoint);
+		int peak_min = std::max((int)(peak.min * amplitude_scale * midpoint) / 0x8000, -midpoint);
+		int peak_max = std::min((int)(peak.max * amplitude_scale * midpoint) / 0x8000, midpoint);
+		int avg_min = std::max((int)(peak.avg_min * amplitude_scale * midpoint) / 0x8000, -midpoint);
+		int avg_max = std::min((int)(peak.avg_max * amplitude_scale * midpoint) / 0x8000, midpoint);
 
 		dc.SetPen(pen_peaks);
 		dc.DrawLine(x, midpoint - peak_max, x, midpoint - peak_min);
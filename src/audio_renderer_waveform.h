@@ -29,6 +29,8 @@
 
 #include "audio_renderer.h"
 
+#include <libaegisub/audio/peak_index.h>
+
 #include <memory>
 #include <vector>
 
@@ -41,11 +43,15 @@ class AudioWaveformRenderer final : public AudioRendererBitmapProvider {
 	std::vector<AudioColorScheme> colors;
 
 	/// Pre-allocated buffer for audio fetched from provider
-	std::unique_ptr<char[]> audio_buffer;
+	std::unique_ptr<int16_t[]> audio_buffer;
 
 	/// Whether to render max+avg or just max
 	bool render_averages;
 
+	/// Compute the peaks of a range of audio directly from the samples, for
+	/// when the provider has no peak index or it can't answer the query
+	agi::AudioPeak ScanAudio(int64_t start, int64_t count);
+
 	void OnSetProvider() override { audio_buffer.reset(); }
 	void OnSetMillisecondsPerPixel() override { audio_buffer.reset(); }
 
@@ -700,6 +700,8 @@ namespace Automation4 {
 				ass->Info.clear();
 			ass->Styles.clear();
 			ass->Events.clear();
+			ass->StylesChanged();
+			ass->EventsChanged();
 
 			for (auto line : lines) {
 				if (!line) continue;
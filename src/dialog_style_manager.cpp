@@ -541,6 +541,7 @@ void DialogStyleManager::OnCopyToCurrent() {
 		}
 		else {
 			c->ass->Styles.push_back(*new AssStyle(*Store[selections[i]]));
+			c->ass->StylesChanged();
 			copied.push_back(styleName);
 		}
 	}
@@ -572,7 +573,7 @@ void DialogStyleManager::CopyToClipboard(wxListBox *list, T const& v) {
 void DialogStyleManager::PasteToCurrent() {
 	add_styles(
 		[=](std::string const& str) { return c->ass->GetStyle(str); },
-		[=](AssStyle *s) { c->ass->Styles.push_back(*s); });
+		[=](AssStyle *s) { c->ass->Styles.push_back(*s); c->ass->StylesChanged(); });
 
 	c->ass->Commit(_("style paste"), AssFile::COMMIT_STYLES);
 }
@@ -724,6 +725,7 @@ void DialogStyleManager::OnCurrentImport() {
 		// Copy
 		modified = true;
 		c->ass->Styles.push_back(*new AssStyle(*temp.GetStyle(styles[sel])));
+		c->ass->StylesChanged();
 	}
 
 	// Update
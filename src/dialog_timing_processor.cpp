@@ -47,7 +47,10 @@
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/algorithm.hpp>
 #include <boost/range/algorithm_ext/push_back.hpp>
+#include <climits>
 #include <functional>
+#include <set>
+#include <tuple>
 #include <vector>
 #include <wx/button.h>
 #include <wx/checkbox.h>
@@ -368,16 +371,51 @@ static int get_closest_kf(std::vector<int> const& kf, int frame) {
 	return (pos == begin(kf) || *pos - frame < frame - *(pos - 1)) ? *pos : *(pos - 1);
 }
 
-template<class Iter, class Field>
-static int safe_time(Iter begin, Iter end, AssDialogue *comp, int initial, Field field, int const& (*cmp)(int const&, int const&)) {
-	// Compare to every previous line (yay for O(n^2)!) to see if it's OK to add lead-in
-	for (; begin != end; ++begin) {
-		// If the line doesn't already collide with this line, extend it only
-		// to the edge of the line
-		if (!comp->CollidesWith(*begin))
-			initial = cmp(initial, (*begin)->*field);
+/// Add lead-in to each line, extending it back only as far as the end of the
+/// latest earlier line which doesn't already overlap it
+static void add_lead_in(std::vector<AssDialogue*> const& sorted, int lead_in) {
+	// Every earlier line starts at or before this one, so an earlier line
+	// doesn't collide with it exactly when it ends at or before its start
+	std::multiset<int> ends;
+	for (auto line : sorted) {
+		int start = line->Start;
+		int safe = start - lead_in;
+		auto it = ends.upper_bound(start);
+		if (it != ends.begin())
+			safe = std::max(safe, *--it);
+		ends.insert(line->End);
+		line->Start = safe;
+	}
+}
+
+/// Add lead-out to each line, extending it only as far as the start of the
+/// earliest later line which doesn't already overlap it
+static void add_lead_out(std::vector<AssDialogue*> const& sorted, int lead_out) {
+	// The later lines by start time, then end time
+	std::set<std::tuple<int, int, size_t>> later;
+	for (size_t i = 0; i < sorted.size(); ++i)
+		later.emplace(sorted[i]->Start, sorted[i]->End, i);
+
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		AssDialogue *line = sorted[i];
+		int start = line->Start, end = line->End;
+		later.erase(std::make_tuple(start, end, i));
+
+		// Every later line starts at or after this one. One which starts
+		// after it collides with it exactly when it starts before this one
+		// ends, so the first which doesn't is the first starting at or after
+		// the end. One which starts at the same time collides with it
+		// exactly when it ends after that time, which only a zero-length or
+		// negative-length line doesn't.
+		int safe = end + lead_out;
+		auto after = later.lower_bound(std::make_tuple(std::max(end, start + 1), INT_MIN, size_t(0)));
+		if (after != later.end())
+			safe = std::min(safe, std::get<0>(*after));
+		auto same = later.lower_bound(std::make_tuple(start, INT_MIN, size_t(0)));
+		if (same != later.end() && std::get<0>(*same) == start && std::get<1>(*same) <= start)
+			safe = std::min(safe, start);
+		line->End = safe;
 	}
-	return initial;
 }
 
 void DialogTimingProcessor::Process() {
@@ -385,19 +423,11 @@ void DialogTimingProcessor::Process() {
 	if (sorted.empty()) return;
 
 	// Add lead-in/out
-	if (hasLeadIn->IsChecked() && leadIn) {
-		for (size_t i = 0; i < sorted.size(); ++i)
-			sorted[i]->Start = safe_time(sorted.rend() - i, sorted.rend(),
-				sorted[i], sorted[i]->Start - leadIn,
-				&AssDialogue::End, &std::max<int>);
-	}
+	if (hasLeadIn->IsChecked() && leadIn)
+		add_lead_in(sorted, leadIn);
 
-	if (hasLeadOut->IsChecked() && leadOut) {
-		for (size_t i = 0; i < sorted.size(); ++i)
-			sorted[i]->End = safe_time(sorted.begin() + i + 1, sorted.end(),
-				sorted[i], sorted[i]->End + leadOut,
-				&AssDialogue::Start, &std::min<int>);
-	}
+	if (hasLeadOut->IsChecked() && leadOut)
+		add_lead_out(sorted, leadOut);
 
 	// Make adjacent
 	if (adjsEnable->IsChecked()) {
@@ -200,12 +200,14 @@ void AssTransformFramerateFilter::TransformFrameRate(AssFile *subs) {
 		newEnd = trunc_cs(ConvertTime(curDialogue.End) + 9);
 
 		// Process stuff
-		auto blocks = line->ParseTags();
-		for (auto block : blocks | agi::of_type<AssDialogueBlockOverride>())
-			block->ProcessParameters(TransformTimeTags, this);
+		if (curDialogue.Text.get().find('{') != std::string::npos) {
+			auto blocks = line->ParseTags();
+			for (auto block : blocks | agi::of_type<AssDialogueBlockOverride>())
+				block->ProcessParameters(TransformTimeTags, this);
+			curDialogue.UpdateText(blocks);
+		}
 		curDialogue.Start = newStart;
 		curDialogue.End = newEnd;
-		curDialogue.UpdateText(blocks);
 	}
 }
 
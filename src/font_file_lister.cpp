@@ -74,10 +74,11 @@ void FontCollector::ProcessDialogueLine(const AssDialogue *line, int index) {
 
 	bool overriden = false;
 
-	for (auto& block : line->ParseTags()) {
+	auto blocks = line->GetParsedTags();
+	for (auto& block : *blocks) {
 		switch (block->GetType()) {
 		case AssBlockType::OVERRIDE:
-			for (auto const& tag : static_cast<AssDialogueBlockOverride&>(*block).Tags) {
+			for (auto const& tag : static_cast<AssDialogueBlockOverride const&>(*block).Tags) {
 				if (tag.Name == "\\r") {
 					style = styles[tag.Params[0].Get(line->Style.get())];
 					overriden = false;
@@ -38,16 +38,47 @@
 #include <string>
 #include <vector>
 
+class AssAttachment;
+class AssDialogue;
 class AssFile;
 struct VideoFrame;
 
 class SubtitlesProvider {
 	std::vector<char> buffer;
+	/// Have any subtitles been loaded successfully?
+	bool loaded = false;
+	/// Time which the loaded lines were filtered to, or -1 for all of them
+	int loaded_time = -1;
+
 	virtual void LoadSubtitles(const char *data, size_t len)=0;
 
+	/// Load the fonts attached to the subtitles
+	///
+	/// Providers which can load fonts separately from the rest of the file
+	/// should override this and return true, in which case the data passed
+	/// to LoadSubtitles will not include them.
+	virtual bool LoadFonts(std::vector<const AssAttachment *> const&) { return false; }
+
+	/// Replace the event for a line in the loaded subtitles
+	/// @param row Row of the line in the file
+	/// @param line New version of the line, or nullptr to remove it
+	/// @return Was the event updated? If not, the subtitles must be reloaded.
+	virtual bool UpdateEvent(int, const AssDialogue *) { return false; }
+
+protected:
+	/// Rows of the lines which were loaded, in the order they were loaded.
+	/// Providers implementing UpdateEvent must keep this up to date.
+	std::vector<int> event_rows;
+
 public:
 	virtual ~SubtitlesProvider() = default;
 	void LoadSubtitles(AssFile *subs, int time = -1);
+
+	/// Update a single line of the most recently loaded subtitles without
+	/// reloading the whole file
+	/// @return false if the provider can't do this, in which case the file
+	///         must be reloaded with LoadSubtitles instead
+	bool UpdateLine(AssDialogue const& line);
 	virtual void DrawSubtitles(VideoFrame &dst, double time)=0;
 	virtual void Reinitialize() { }
 };
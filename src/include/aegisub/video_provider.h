@@ -48,6 +48,10 @@ public:
 	/// Override this method to actually get frames
 	virtual void GetFrame(int n, VideoFrame &frame)=0;
 
+	/// Decode a frame which is likely to be requested soon so that getting
+	/// it later is fast. Only providers which cache frames do anything here.
+	virtual void Prefetch(int) { }
+
 	/// Set the YCbCr matrix to the specified one
 	///
 	/// Providers are free to disregard this, and should if the requested
@@ -359,8 +359,8 @@ void Advanced_Audio(wxTreebook *book, Preferences *parent) {
 	p->OptionChoice(expert, _("Audio player"), apl_choice, "Audio/Player");
 
 	auto cache = p->PageSizer(_("Cache"));
-	const wxString ct_arr[3] = { _("None (NOT RECOMMENDED)"), _("RAM"), _("Hard Disk") };
-	wxArrayString ct_choice(3, ct_arr);
+	const wxString ct_arr[4] = { _("None (NOT RECOMMENDED)"), _("RAM"), _("Hard Disk"), _("RAM (compressed)") };
+	wxArrayString ct_choice(4, ct_arr);
 	p->OptionChoice(cache, _("Cache type"), ct_choice, "Audio/Cache/Type");
 	p->OptionBrowse(cache, _("Path"), "Audio/Cache/HD/Location");
 
@@ -423,6 +423,10 @@ void Advanced_Video(wxTreebook *book, Preferences *parent) {
 
 	p->CellSkip(expert);
 	p->OptionAdd(expert, _("Force BT.601"), "Video/Force BT.601");
+	p->OptionAdd(expert, _("Frames to decode ahead"), "Provider/Video/Prefetch Frames", 0, 64)
+		->SetToolTip(_("Limited to the number of frames which fit in the video frame cache along with the current frame"));
+	p->OptionAdd(expert, _("Rendered frame cache size (MB)"), "Provider/Video/Render Cache/Size", 0, 1024);
+	p->OptionAdd(expert, _("Frames to render ahead when playing"), "Provider/Video/Playback Frames", 1, 64);
 
 #ifdef WITH_AVISYNTH
 	auto avisynth = p->PageSizer("Avisynth");
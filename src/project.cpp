@@ -242,9 +242,15 @@ void Project::DoLoadAudio(agi::fs::path const& path, bool quiet) {
 	if (!progress)
 		progress = new DialogProgress(context->parent);
 
+	// Things may read from the old provider on other threads until they've
+	// been told about the new one, so it has to outlive the announcement
+	std::unique_ptr<agi::AudioProvider> old_provider;
+
 	try {
 		try {
-			audio_provider = GetAudioProvider(path, *context->path, progress);
+			auto provider = GetAudioProvider(path, *context->path, progress);
+			old_provider = std::move(audio_provider);
+			audio_provider = std::move(provider);
 		}
 		catch (agi::UserCancelException const&) { return; }
 		catch (...) {
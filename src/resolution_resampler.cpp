@@ -160,6 +160,15 @@ namespace {
 		if (diag.Comment && (boost::starts_with(diag.Effect.get(), "template") || boost::starts_with(diag.Effect.get(), "code")))
 			return;
 
+		for (size_t i = 0; i < 3; ++i) {
+			if (diag.Margin[i])
+				diag.Margin[i] = int((diag.Margin[i] + state->margin[i]) * (i < 2 ? state->rx : state->ry) + 0.5);
+		}
+
+		// Lines without override blocks have no tags or drawings to resample
+		if (diag.Text.get().find('{') == std::string::npos)
+			return;
+
 		auto blocks = diag.ParseTags();
 
 		for (auto block : blocks | agi::of_type<AssDialogueBlockOverride>())
@@ -168,11 +177,6 @@ namespace {
 		for (auto drawing : blocks | agi::of_type<AssDialogueBlockDrawing>())
 			drawing->text = transform_drawing(drawing->text, 0, 0, state->rx / state->ar, state->ry);
 
-		for (size_t i = 0; i < 3; ++i) {
-			if (diag.Margin[i])
-				diag.Margin[i] = int((diag.Margin[i] + state->margin[i]) * (i < 2 ? state->rx : state->ry) + 0.5);
-		}
-
 		diag.UpdateText(blocks);
 	}
 
@@ -286,5 +290,5 @@ void ResampleResolution(AssFile *ass, ResampleSettings settings) {
 	if (resample_colors)
 		ass->SetScriptInfo("YCbCr Matrix", MatrixToString(settings.dest_matrix));
 
-	ass->Commit(_("resolution resampling"), AssFile::COMMIT_SCRIPTINFO | AssFile::COMMIT_DIAG_FULL);
+	ass->Commit(_("resolution resampling"), AssFile::COMMIT_SCRIPTINFO | AssFile::COMMIT_STYLES | AssFile::COMMIT_DIAG_FULL);
 }
@@ -35,9 +35,11 @@
 #include <libaegisub/dispatch.h>
 #include <libaegisub/format_path.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
 #include <libaegisub/util.h>
 
+#include <boost/range/adaptor/reversed.hpp>
 #include <wx/msgdlg.h>
 
 namespace {
@@ -54,6 +56,14 @@ struct SubsController::UndoInfo {
 	wxString undo_description;
 	int commit_id;
 
+	/// Did this commit change only the contents of a single line? If so,
+	/// rather than a copy of the whole file just that line before and after
+	/// the commit is stored, and the fields for the rest of the file are
+	/// left empty.
+	bool line_edit = false;
+	AssDialogueBase old_line;
+	AssDialogueBase new_line;
+
 	std::vector<std::pair<std::string, std::string>> script_info;
 	std::vector<AssStyle> styles;
 	std::vector<AssDialogueBase> events;
@@ -61,14 +71,18 @@ struct SubsController::UndoInfo {
 	std::vector<ExtradataEntry> extradata;
 
 	mutable std::vector<int> selection;
+	/// Row and ID of each selected line, for restoring the selection after
+	/// a line edit without looking for the lines by ID
+	std::vector<std::pair<int, int>> selected_rows;
 	int active_line_id = 0;
+	int active_line_row = -1;
 	int pos = 0, sel_start = 0, sel_end = 0;
 
 	UndoInfo(const agi::Context *c, wxString const& d, int commit_id)
 	: undo_description(d)
 	, commit_id(commit_id)
 	, attachments(c->ass->Attachments)
-	, extradata(c->ass->Extradata)
+	, extradata(c->ass->GetAllExtradata())
 	{
 		script_info.reserve(c->ass->Info.size());
 		for (auto const& info : c->ass->Info)
@@ -85,7 +99,66 @@ struct SubsController::UndoInfo {
 		UpdateTextSelection(c);
 	}
 
-	void Apply(agi::Context *c) const {
+	UndoInfo(const agi::Context *c, wxString const& d, int commit_id, AssDialogueBase const& old_line, AssDialogueBase const& new_line)
+	: undo_description(d)
+	, commit_id(commit_id)
+	, line_edit(true)
+	, old_line(old_line)
+	, new_line(new_line)
+	{
+		UpdateActiveLine(c);
+		UpdateSelection(c);
+		UpdateTextSelection(c);
+	}
+
+	/// Turn a line edit into a full copy of the file, given the full copy
+	/// of the file from the commit before it, which is consumed
+	void MakeFull(UndoInfo&& prev) {
+		script_info = std::move(prev.script_info);
+		styles = std::move(prev.styles);
+		events = std::move(prev.events);
+		attachments = std::move(prev.attachments);
+		extradata = std::move(prev.extradata);
+		events[new_line.Row] = new_line;
+		line_edit = false;
+	}
+
+	/// Get the contents of the row given by line.Row as of the commit which
+	/// the reverse iterator it points to, looking further back if that
+	/// commit was a line edit
+	template<class Iterator>
+	static AssDialogueBase const& LineAt(Iterator it, AssDialogueBase const& line) {
+		for (; it->line_edit; ++it) {
+			if (it->new_line.Row == line.Row)
+				return it->new_line;
+		}
+		return it->events[line.Row];
+	}
+
+	/// Restore the whole file to the state of the commit which the reverse
+	/// iterator it points to, which may be a line edit on top of earlier
+	/// commits
+	template<class Iterator>
+	static void Apply(agi::Context *c, Iterator it) {
+		if (!it->line_edit) {
+			it->Apply(c, *it, it->events);
+			return;
+		}
+
+		// Find the last full copy of the file and then replay the line
+		// edits since then on top of it
+		auto const& state = *it;
+		std::vector<AssDialogueBase const*> edits;
+		for (; it->line_edit; ++it)
+			edits.push_back(&it->new_line);
+
+		auto events = it->events;
+		for (auto line : boost::adaptors::reverse(edits))
+			events[line->Row] = *line;
+		state.Apply(c, *it, events);
+	}
+
+	void Apply(agi::Context *c, UndoInfo const& file, std::vector<AssDialogueBase> const& events) const {
 		// Keep old dialogue lines alive until after the commit is complete
 		// since a bunch of stuff holds references to them
 		AssFile old;
@@ -93,18 +166,17 @@ struct SubsController::UndoInfo {
 		c->ass->Info.clear();
 		c->ass->Attachments.clear();
 		c->ass->Styles.clear();
-		c->ass->Extradata.clear();
 
 		sort(begin(selection), end(selection));
 
 		AssDialogue *active_line = nullptr;
 		Selection new_sel;
 
-		for (auto const& info : script_info)
+		for (auto const& info : file.script_info)
 			c->ass->Info.push_back(*new AssInfo(info.first, info.second));
-		for (auto const& style : styles)
+		for (auto const& style : file.styles)
 			c->ass->Styles.push_back(*new AssStyle(style));
-		c->ass->Attachments = attachments;
+		c->ass->Attachments = file.attachments;
 		for (auto const& event : events) {
 			auto copy = new AssDialogue(event);
 			c->ass->Events.push_back(*copy);
@@ -113,7 +185,7 @@ struct SubsController::UndoInfo {
 			if (binary_search(begin(selection), end(selection), copy->Id))
 				new_sel.insert(copy);
 		}
-		c->ass->Extradata = extradata;
+		c->ass->SetAllExtradata(file.extradata);
 
 		c->ass->Commit("", AssFile::COMMIT_NEW);
 		c->selectionController->SetSelectionAndActive(std::move(new_sel), active_line);
@@ -122,18 +194,61 @@ struct SubsController::UndoInfo {
 		c->textSelectionController->SetSelection(sel_start, sel_end);
 	}
 
+	/// Restore a single line to the given contents, and the selection to
+	/// what it was at this commit
+	void ApplyLine(agi::Context *c, AssDialogueBase const& line) const {
+		// Line edits never add, remove or reorder lines, so every line is
+		// still at the row it had when this commit was made
+		auto at_row = [&](int row, int id) -> AssDialogue * {
+			auto diag = c->ass->GetEventAtRow(row);
+			return diag && diag->Id == id ? diag : nullptr;
+		};
+
+		AssDialogue *changed = at_row(line.Row, line.Id);
+		if (!changed) {
+			for (auto& diag : c->ass->Events) {
+				if (diag.Id == line.Id) {
+					changed = &diag;
+					break;
+				}
+			}
+		}
+
+		AssDialogue *active_line = at_row(active_line_row, active_line_id);
+		Selection new_sel;
+		for (auto const& sel : selected_rows) {
+			if (auto diag = at_row(sel.first, sel.second))
+				new_sel.insert(diag);
+		}
+
+		if (changed) {
+			static_cast<AssDialogueBase&>(*changed) = line;
+			c->ass->Commit("", AssFile::COMMIT_DIAG_FULL, -1, changed);
+		}
+		c->selectionController->SetSelectionAndActive(std::move(new_sel), active_line);
+
+		c->textSelectionController->SetInsertionPoint(pos);
+		c->textSelectionController->SetSelection(sel_start, sel_end);
+	}
+
 	void UpdateActiveLine(const agi::Context *c) {
 		auto line = c->selectionController->GetActiveLine();
-		if (line)
+		if (line) {
 			active_line_id = line->Id;
+			active_line_row = line->Row;
+		}
 	}
 
 	void UpdateSelection(const agi::Context *c) {
 		auto const& sel = c->selectionController->GetSelectedSet();
 		selection.clear();
 		selection.reserve(sel.size());
-		for (const auto diag : sel)
+		selected_rows.clear();
+		selected_rows.reserve(sel.size());
+		for (const auto diag : sel) {
 			selection.push_back(diag->Id);
+			selected_rows.emplace_back(diag->Row, diag->Id);
+		}
 	}
 
 	void UpdateTextSelection(const agi::Context *c) {
@@ -266,10 +381,10 @@ void SubsController::AutoSave() {
 
 	autosaved_commit_id = commit_id;
 	auto frame = context->frame;
-	auto subs_copy = new AssFile(*context->ass);
-	autosave_queue->Async([subs_copy, name, directory, frame] {
+	auto snapshot = context->ass->GetSnapshot();
+	autosave_queue->Async([snapshot, name, directory, frame] {
 		wxString msg;
-		std::unique_ptr<AssFile> subs(subs_copy);
+		auto subs = agi::make_unique<AssFile>(*snapshot);
 
 		try {
 			agi::fs::CreateDirectory(directory);
@@ -310,28 +425,51 @@ void SubsController::SetFileName(agi::fs::path const& path) {
 void SubsController::OnCommit(AssFileCommit c) {
 	if (c.message.empty() && !undo_stack.empty()) return;
 
+	// Commits which change only the contents of one line store just that
+	// line rather than a copy of the file
+	bool line_edit = c.single_line && !undo_stack.empty()
+		&& c.type != AssFile::COMMIT_NEW && !(c.type & ~AssFile::COMMIT_DIAG_FULL);
+
 	commit_id = next_commit_id++;
 	// Allow coalescing only if it's the last change and the file has not been
 	// saved since the last change
 	if (commit_id == *c.commit_id+1 && redo_stack.empty() && saved_commit_id+1 != commit_id) {
 		// If only one line changed just modify it instead of copying the file
 		if (c.single_line && c.single_line->Group() == AssEntryGroup::DIALOGUE) {
-			for (auto& diag : undo_stack.back().events) {
-				if (diag.Id == c.single_line->Id) {
-					diag = *c.single_line;
-					break;
+			auto& last = undo_stack.back();
+			if (!last.line_edit) {
+				auto row = c.single_line->Row;
+				if (row >= 0 && row < (int)last.events.size() && last.events[row].Id == c.single_line->Id)
+					last.events[row] = *c.single_line;
+				else {
+					for (auto& diag : last.events) {
+						if (diag.Id == c.single_line->Id) {
+							diag = *c.single_line;
+							break;
+						}
+					}
 				}
+				*c.commit_id = commit_id;
+				return;
+			}
+			if (line_edit && last.new_line.Id == c.single_line->Id) {
+				last.new_line = *c.single_line;
+				*c.commit_id = commit_id;
+				return;
 			}
-			*c.commit_id = commit_id;
-			return;
 		}
 
+		// The commit being replaced may have been a line edit which the
+		// file's new state doesn't build on, so store the whole file
 		undo_stack.pop_back();
+		line_edit = false;
 	}
 
 	// Make sure the file has at least one style and one dialogue line
-	if (context->ass->Styles.empty())
+	if (context->ass->Styles.empty()) {
 		context->ass->Styles.push_back(*new AssStyle);
+		context->ass->StylesChanged();
+	}
 	if (context->ass->Events.empty()) {
 		context->ass->Events.push_back(*new AssDialogue);
 		context->ass->Events.back().Row = 0;
@@ -339,11 +477,21 @@ void SubsController::OnCommit(AssFileCommit c) {
 
 	redo_stack.clear();
 
-	undo_stack.emplace_back(context, c.message, commit_id);
+	if (line_edit && !undo_stack.empty())
+		undo_stack.emplace_back(context, c.message, commit_id,
+			UndoInfo::LineAt(undo_stack.rbegin(), *c.single_line), *c.single_line);
+	else
+		undo_stack.emplace_back(context, c.message, commit_id);
 
 	int depth = std::max<int>(OPT_GET("Limits/Undo Levels")->GetInt(), 2);
-	while ((int)undo_stack.size() > depth)
+	while ((int)undo_stack.size() > depth) {
+		// The oldest commit always has to be a full copy of the file for the
+		// line edits after it to apply to
+		UndoInfo first = std::move(undo_stack.front());
 		undo_stack.pop_front();
+		if (undo_stack.front().line_edit)
+			undo_stack.front().MakeFull(std::move(first));
+	}
 
 	if (undo_stack.size() > 1 && OPT_GET("App/Auto/Save on Every Change")->GetBool() && !filename.empty() && CanSave())
 		Save(filename);
@@ -373,7 +521,11 @@ void SubsController::Undo() {
 	commit_id = undo_stack.back().commit_id;
 
 	text_selection_connection.Block();
-	undo_stack.back().Apply(context);
+	auto const& undone = redo_stack.back();
+	if (undone.line_edit)
+		undo_stack.back().ApplyLine(context, undone.old_line);
+	else
+		UndoInfo::Apply(context, undo_stack.rbegin());
 	text_selection_connection.Unblock();
 }
 
@@ -384,7 +536,11 @@ void SubsController::Redo() {
 	commit_id = undo_stack.back().commit_id;
 
 	text_selection_connection.Block();
-	undo_stack.back().Apply(context);
+	auto const& redone = undo_stack.back();
+	if (redone.line_edit)
+		redone.ApplyLine(context, redone.new_line);
+	else
+		redone.Apply(context, redone, redone.events);
 	text_selection_connection.Unblock();
 }
 
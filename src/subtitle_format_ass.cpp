@@ -30,16 +30,31 @@
 
 #include <libaegisub/ass/uuencode.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/mapped_line_reader.h>
+
+#include <boost/algorithm/string/predicate.hpp>
 
 DEFINE_EXCEPTION(AssParseError, SubtitleFormatParseError);
 
 void AssSubtitleFormat::ReadFile(AssFile *target, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const {
 	int version = !agi::fs::HasExtension(filename, "ssa");
 
-	TextFileReader file(filename, encoding);
-	AssParser parser(target, version);
-	while (file.HasMoreLines())
-		parser.AddLine(file.ReadLineFromFile());
+	AssParser parser(target, version, true);
+
+	// UTF-8 needs no conversion, so the lines can be handed to the parser
+	// straight out of the file mapping
+	if (boost::iequals(encoding, "utf-8") || boost::iequals(encoding, "ascii")) {
+		agi::mapped_line_reader file(filename);
+		while (file.HasMoreLines())
+			parser.AddLine(file.ReadLine());
+	}
+	else {
+		TextFileReader file(filename, encoding);
+		while (file.HasMoreLines())
+			parser.AddLine(file.ReadLineFromFile());
+	}
+
+	parser.Finish();
 }
 
 #ifdef _WIN32
@@ -158,7 +173,7 @@ void AssSubtitleFormat::WriteFile(const AssFile *src, agi::fs::path const& filen
 	writer.Write(src->Styles);
 	writer.Write(src->Attachments);
 	writer.Write(src->Events);
-	writer.WriteExtradata(src->Extradata);
+	writer.WriteExtradata(src->GetAllExtradata());
 }
 
 void AssSubtitleFormat::ExportFile(const AssFile *src, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const {
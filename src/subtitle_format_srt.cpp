@@ -459,8 +459,8 @@ bool SRTSubtitleFormat::CanSave(const AssFile *file) const {
 		if (line.Style != def)
 			return false;
 
-		auto blocks = line.ParseTags();
-		for (auto ovr : blocks | agi::of_type<AssDialogueBlockOverride>()) {
+		auto blocks = line.GetParsedTags();
+		for (auto ovr : *blocks | agi::of_type<AssDialogueBlockOverride>()) {
 			// Verify that all overrides used are supported
 			for (auto const& tag : ovr->Tags) {
 				if (tag.Name.size() != 2)
@@ -484,10 +484,11 @@ std::string SRTSubtitleFormat::ConvertTags(const AssDialogue *diag) const {
 	};
 
 	std::string final;
-	for (auto& block : diag->ParseTags()) {
+	auto blocks = diag->GetParsedTags();
+	for (auto& block : *blocks) {
 		switch (block->GetType()) {
 		case AssBlockType::OVERRIDE:
-			for (auto const& tag : static_cast<AssDialogueBlockOverride&>(*block).Tags) {
+			for (auto const& tag : static_cast<AssDialogueBlockOverride const&>(*block).Tags) {
 				if (!tag.IsValid() || tag.Name.size() != 2)
 					continue;
 				for (auto& state : tag_states) {
@@ -70,6 +70,8 @@ std::unique_ptr<SubtitlesProvider> SubtitlesProviderFactory::GetProvider(agi::Ba
 
 void SubtitlesProvider::LoadSubtitles(AssFile *subs, int time) {
 	buffer.clear();
+	event_rows.clear();
+	loaded = false;
 
 	auto push_header = [&](const char *str) {
 		buffer.insert(buffer.end(), str, str + strlen(str));
@@ -87,22 +89,51 @@ void SubtitlesProvider::LoadSubtitles(AssFile *subs, int time) {
 	for (auto const& line : subs->Styles)
 		push_line(line.GetEntryData());
 
-	if (!subs->Attachments.empty()) {
+	std::vector<const AssAttachment *> fonts;
+	for (auto const& attachment : subs->Attachments) {
+		if (attachment.Group() == AssEntryGroup::FONT)
+			fonts.push_back(&attachment);
+	}
+
+	if (!LoadFonts(fonts) && !fonts.empty()) {
 		// TODO: some scripts may have a lot of attachments, 
 		// so ideally we'd want to write only those actually used on the requested video frame,
 		// but this would require some pre-parsing of the attached font files with FreeType,
 		// which isn't probably trivial.
 		push_header("[Fonts]\n");
-		for (auto const& attachment : subs->Attachments)
-			if (attachment.Group() == AssEntryGroup::FONT)
-				push_line(attachment.GetEntryData());
+		for (auto font : fonts)
+			push_line(font->GetEntryData());
 	}
 
 	push_header("[Events]\n");
-	for (auto const& line : subs->Events) {
-		if (!line.Comment && (time < 0 || !(line.Start > time || line.End <= time)))
-			push_line(line.GetEntryData());
+	auto push_event = [&](AssDialogue const& line) {
+		if (line.Comment) return;
+		push_line(line.GetEntryData());
+		event_rows.push_back(line.Row);
+	};
+	if (time < 0) {
+		for (auto const& line : subs->Events)
+			push_event(line);
+	}
+	else {
+		for (auto line : subs->GetEventsAt(time))
+			push_event(*line);
 	}
 
 	LoadSubtitles(&buffer[0], buffer.size());
+	loaded = true;
+	loaded_time = time;
+}
+
+bool SubtitlesProvider::UpdateLine(AssDialogue const& line) {
+	if (!loaded) return false;
+
+	bool visible = !line.Comment && (loaded_time < 0 || !(line.Start > loaded_time || line.End <= loaded_time));
+	if (UpdateEvent(line.Row, visible ? &line : nullptr))
+		return true;
+
+	// The loaded subtitles may now be partially updated, so they can't be
+	// updated further until they're reloaded
+	loaded = false;
+	return false;
 }
@@ -34,10 +34,12 @@
 
 #include "subtitles_provider_libass.h"
 
+#include "ass_dialogue.h"
 #include "compat.h"
 #include "include/aegisub/subtitles_provider.h"
 #include "video_frame.h"
 
+#include <libaegisub/alpha_blend.h>
 #include <libaegisub/background_runner.h>
 #include <libaegisub/dispatch.h>
 #include <libaegisub/exception.h>
@@ -45,8 +47,9 @@
 #include <libaegisub/make_unique.h>
 #include <libaegisub/util.h>
 
+#include <algorithm>
 #include <atomic>
-#include <boost/gil/gil_all.hpp>
+#include <cstring>
 #include <memory>
 #include <mutex>
 
@@ -123,8 +126,27 @@ public:
 		if (ass_track) ass_free_track(ass_track);
 		ass_track = ass_read_memory(library, const_cast<char *>(data), len, nullptr);
 		if (!ass_track) throw agi::InternalError("libass failed to load subtitles.");
+
+		// Order events by row rather than by position in the data loaded so
+		// that events added later can be ordered correctly relative to them
+		if (event_rows.size() == static_cast<size_t>(ass_track->n_events)) {
+			for (size_t i = 0; i < event_rows.size(); ++i)
+				ass_track->events[i].ReadOrder = event_rows[i];
+		}
+		else
+			event_rows.clear();
 	}
 
+	/// libass only uses a script's [Fonts] section when font extraction is
+	/// enabled on the library, which it isn't as the library is shared by
+	/// every script, so there's no point in sending the fonts only for them
+	/// to be parsed and thrown away
+	bool LoadFonts(std::vector<const AssAttachment *> const&) override {
+		return true;
+	}
+
+	bool UpdateEvent(int row, const AssDialogue *line) override;
+
 	void DrawSubtitles(VideoFrame &dst, double time) override;
 
 	void Reinitialize() override {
@@ -159,6 +181,39 @@ LibassSubtitlesProvider::~LibassSubtitlesProvider() {
 	if (ass_track) ass_free_track(ass_track);
 }
 
+bool LibassSubtitlesProvider::UpdateEvent(int row, const AssDialogue *line) {
+	if (!ass_track || event_rows.size() != static_cast<size_t>(ass_track->n_events))
+		return false;
+
+	auto it = lower_bound(begin(event_rows), end(event_rows), row);
+	size_t pos = it - begin(event_rows);
+
+	// Remove the old version of the line if it was loaded
+	if (it != end(event_rows) && *it == row) {
+		ass_free_event(ass_track, static_cast<int>(pos));
+		memmove(&ass_track->events[pos], &ass_track->events[pos + 1],
+			(ass_track->n_events - pos - 1) * sizeof(ASS_Event));
+		--ass_track->n_events;
+		event_rows.erase(it);
+	}
+
+	if (!line) return true;
+
+	auto data = line->GetEntryData();
+	int count = ass_track->n_events;
+	ass_process_data(ass_track, &data[0], static_cast<int>(data.size()));
+	if (ass_track->n_events != count + 1)
+		return false;
+
+	// New events are added to the end, so move it to where it belongs
+	ASS_Event event = ass_track->events[count];
+	event.ReadOrder = row;
+	memmove(&ass_track->events[pos + 1], &ass_track->events[pos], (count - pos) * sizeof(ASS_Event));
+	ass_track->events[pos] = event;
+	event_rows.insert(begin(event_rows) + pos, row);
+	return true;
+}
+
 #define _r(c) ((c)>>24)
 #define _g(c) (((c)>>16)&0xFF)
 #define _b(c) (((c)>>8)&0xFF)
@@ -173,31 +228,17 @@ void LibassSubtitlesProvider::DrawSubtitles(VideoFrame &frame,double time) {
 	// Here, we loop through their linked list, get the colour of the current, and blend into the frame.
 	// This is repeated for all of them.
 
-	using namespace boost::gil;
-	auto dst = interleaved_view(frame.width, frame.height, (bgra8_pixel_t*)frame.data.data(), frame.width * 4);
-	if (frame.flipped)
-		dst = flipped_up_down_view(dst);
+	auto base = frame.data.data();
+	ptrdiff_t stride = frame.width * 4;
+	if (frame.flipped) {
+		base += (frame.height - 1) * stride;
+		stride = -stride;
+	}
 
 	for (; img; img = img->next) {
-		unsigned int opacity = 255 - ((unsigned int)_a(img->color));
-		unsigned int r = (unsigned int)_r(img->color);
-		unsigned int g = (unsigned int)_g(img->color);
-		unsigned int b = (unsigned int)_b(img->color);
-
-		auto srcview = interleaved_view(img->w, img->h, (gray8_pixel_t*)img->bitmap, img->stride);
-		auto dstview = subimage_view(dst, img->dst_x, img->dst_y, img->w, img->h);
-
-		transform_pixels(dstview, srcview, dstview, [=](const bgra8_pixel_t frame, const gray8_pixel_t src) -> bgra8_pixel_t {
-			unsigned int k = ((unsigned)src) * opacity / 255;
-			unsigned int ck = 255 - k;
-
-			bgra8_pixel_t ret;
-			ret[0] = (k * b + ck * frame[0]) / 255;
-			ret[1] = (k * g + ck * frame[1]) / 255;
-			ret[2] = (k * r + ck * frame[2]) / 255;
-			ret[3] = 0;
-			return ret;
-		});
+		agi::BlendMask(base + img->dst_y * stride + img->dst_x * 4, stride,
+		               img->bitmap, img->stride, img->w, img->h,
+		               _r(img->color), _g(img->color), _b(img->color), 255 - _a(img->color));
 	}
 }
 }
@@ -60,6 +60,8 @@ VideoController::VideoController(agi::Context *c)
 }
 
 void VideoController::OnNewVideoProvider(AsyncVideoProvider *new_provider) {
+	// The old provider may already have been destroyed
+	provider = nullptr;
 	Stop();
 	provider = new_provider;
 	color_matrix = provider ? provider->GetColorSpace() : "";
@@ -143,9 +145,7 @@ void VideoController::Play() {
 	end_frame = provider->GetFrameCount() - 1;
 
 	context->audioController->PlayToEnd(start_ms);
-
-	playback_start_time = std::chrono::steady_clock::now();
-	playback.Start(10);
+	StartPlayback();
 }
 
 void VideoController::PlayLine() {
@@ -162,28 +162,63 @@ void VideoController::PlayLine() {
 	end_frame = FrameAtTime(context->selectionController->GetActiveLine()->End, agi::vfr::END) + 1;
 
 	JumpToFrame(startFrame);
+	StartPlayback();
+}
 
-	playback_start_time = std::chrono::steady_clock::now();
-	playback.Start(10);
+void VideoController::StartPlayback() {
+	// The current frame is already on screen, so start rendering from the
+	// one after it
+	provider->StartPlayback(frame_n + 1, end_frame, context->project->Timecodes());
+
+	clock_ms = start_ms;
+	clock_time = std::chrono::steady_clock::now();
+	// Frames are shown as soon as the clock reaches them, so check more often
+	// than the frame rate of anything which is likely to be played
+	playback.Start(4);
 }
 
 void VideoController::Stop() {
 	if (IsPlaying()) {
 		playback.Stop();
 		context->audioController->Stop();
+		if (provider) {
+			provider->StopPlayback();
+			// Subtitle changes redraw the last requested frame, which should
+			// be the one that playback stopped on
+			RequestFrame();
+		}
 	}
 }
 
-void VideoController::OnPlayTimer(wxTimerEvent &) {
+int VideoController::GetPlaybackTime() {
 	using namespace std::chrono;
-	int next_frame = FrameAtTime(start_ms + duration_cast<milliseconds>(steady_clock::now() - playback_start_time).count());
-	if (next_frame == frame_n) return;
+	auto now = steady_clock::now();
+
+	// Audio can't skip ahead or wait for video, so follow it when it's
+	// playing, which also keeps the two in sync if the clocks drift. Audio
+	// can stop before the video does, so remember where it got to.
+	if (context->audioController->IsPlaying()) {
+		clock_ms = context->audioController->GetPlaybackPosition();
+		clock_time = now;
+		return clock_ms;
+	}
 
-	if (next_frame >= end_frame)
+	return clock_ms + duration_cast<milliseconds>(now - clock_time).count();
+}
+
+void VideoController::OnPlayTimer(wxTimerEvent &) {
+	int next_frame = FrameAtTime(GetPlaybackTime());
+	if (next_frame <= frame_n) return;
+
+	if (next_frame >= end_frame) {
 		Stop();
-	else {
-		frame_n = next_frame;
-		RequestFrame();
+		return;
+	}
+
+	int shown = provider->ShowPlaybackFrame(next_frame);
+	if (shown >= 0) {
+		frame_n = shown;
+		context->ass->Properties.video_position = frame_n;
 		Seek(frame_n);
 	}
 }
@@ -69,12 +69,16 @@ class VideoController final : public wxEvtHandler {
 	/// Last seen script color matrix
 	std::string color_matrix;
 
-	/// Playback timer used to periodically check if we should go to the next
+	/// Playback timer used to periodically check if we should show the next
 	/// frame while playing video
 	wxTimer playback;
 
-	/// Time when playback was last started
-	std::chrono::steady_clock::time_point playback_start_time;
+	/// Playback position the last time it was known exactly, either from
+	/// starting playback or from reading the audio position
+	int clock_ms = 0;
+	/// When clock_ms was set; the clock runs on from there while audio isn't
+	/// playing
+	std::chrono::steady_clock::time_point clock_time;
 
 	/// The start time of the first frame of the current playback; undefined if
 	/// video is not currently playing
@@ -110,6 +114,11 @@ class VideoController final : public wxEvtHandler {
 
 	void RequestFrame();
 
+	/// Start rendering frames ahead and the timer which shows them
+	void StartPlayback();
+	/// Get the time in milliseconds which playback is at
+	int GetPlaybackTime();
+
 public:
 	VideoController(agi::Context *context);
 
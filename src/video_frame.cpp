@@ -33,6 +33,21 @@ namespace {
 	};
 }
 
+std::vector<unsigned char>& SharedFrameData::Unique() {
+	if (!buffer)
+		buffer = std::make_shared<std::vector<unsigned char>>();
+	else if (buffer.use_count() > 1)
+		buffer = std::make_shared<std::vector<unsigned char>>(*buffer);
+	return *buffer;
+}
+
+void SharedFrameData::reset(size_t size) {
+	if (buffer && buffer.use_count() == 1)
+		buffer->resize(size);
+	else
+		buffer = std::make_shared<std::vector<unsigned char>>(size);
+}
+
 wxImage GetImage(VideoFrame const& frame) {
 	using namespace boost::gil;
 
@@ -14,12 +14,48 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <memory>
 #include <vector>
 
 class wxImage;
 
+/// Pixel data which can be shared between several frames, so that copying a
+/// frame doesn't copy the pixels. The pixels are copied the first time a
+/// frame which shares them is written to, so all writes must go through the
+/// non-const members, and a frame must not be written to on one thread while
+/// another thread is copying it.
+class SharedFrameData {
+	std::shared_ptr<std::vector<unsigned char>> buffer;
+
+	/// Get a buffer which is not shared with any other frame
+	std::vector<unsigned char>& Unique();
+
+public:
+	size_t size() const { return buffer ? buffer->size() : 0; }
+	bool empty() const { return size() == 0; }
+
+	const unsigned char *data() const { return buffer ? buffer->data() : nullptr; }
+	unsigned char *data() { return Unique().data(); }
+
+	const unsigned char& operator[](size_t i) const { return (*buffer)[i]; }
+	unsigned char& operator[](size_t i) { return Unique()[i]; }
+
+	/// Resize to the given number of bytes with unspecified contents, which
+	/// avoids copying the old contents if they're shared
+	void reset(size_t size);
+
+	template<typename Iterator>
+	void assign(Iterator first, Iterator last) {
+		// No need to copy the old contents if they're about to be replaced
+		if (buffer && buffer.use_count() == 1)
+			buffer->assign(first, last);
+		else
+			buffer = std::make_shared<std::vector<unsigned char>>(first, last);
+	}
+};
+
 struct VideoFrame {
-	std::vector<unsigned char> data;
+	SharedFrameData data;
 	size_t width;
 	size_t height;
 	size_t pitch;
@@ -22,6 +22,7 @@
 #include <libaegisub/make_unique.h>
 
 #include <list>
+#include <unordered_map>
 
 namespace {
 /// A video frame and its frame number
@@ -37,26 +38,47 @@ struct CachedFrame {
 
 /// @class VideoProviderCache
 /// @brief A wrapper around a video provider which provides LRU caching
+///
+/// Cached frames share their pixels with the frames handed out, so neither
+/// adding a frame to the cache nor returning one from it copies the pixels.
 class VideoProviderCache final : public VideoProvider {
 	/// The source provider to get frames from
 	std::unique_ptr<VideoProvider> master;
 
 	/// @brief Maximum size of the cache in bytes
 	///
-	/// Note that this is a soft limit. The cache stops allocating new frames
-	/// once it has exceeded the limit, but it never tries to shrink
+	/// Note that this is a soft limit. Frames are only evicted once the cache
+	/// has exceeded the limit, so it can go over by one frame.
 	const size_t max_cache_size = OPT_GET("Provider/Video/Cache/Size")->GetInt() << 20; // convert MB to bytes
 
 	/// Cache of video frames with the most recently used ones at the front
 	std::list<CachedFrame> cache;
 
+	/// Frame number -> position in cache
+	std::unordered_map<int, std::list<CachedFrame>::iterator> index;
+
+	/// Total size in bytes of the frames in the cache
+	size_t total_size = 0;
+
+	void Clear() {
+		cache.clear();
+		index.clear();
+		total_size = 0;
+	}
+
 public:
 	VideoProviderCache(std::unique_ptr<VideoProvider> master) : master(std::move(master)) { }
 
 	void GetFrame(int n, VideoFrame &frame) override;
 
+	void Prefetch(int n) override {
+		if (n < 0 || n >= master->GetFrameCount() || index.count(n)) return;
+		VideoFrame frame;
+		GetFrame(n, frame);
+	}
+
 	void SetColorSpace(std::string const& m) override {
-		cache.clear();
+		Clear();
 		return master->SetColorSpace(m);
 	}
 
@@ -75,27 +97,24 @@ public:
 };
 
 void VideoProviderCache::GetFrame(int n, VideoFrame &out) {
-	size_t total_size = 0;
-
-	for (auto cur = cache.begin(); cur != cache.end(); ++cur) {
-		if (cur->frame_number == n) {
-			cache.splice(cache.begin(), cache, cur); // Move to front
-			out = cache.front().frame;
-			return;
-		}
-
-		total_size += cur->frame.data.size();
+	auto it = index.find(n);
+	if (it != index.end()) {
+		cache.splice(cache.begin(), cache, it->second); // Move to front
+		out = cache.front().frame;
+		return;
 	}
 
 	master->GetFrame(n, out);
 
-	if (total_size >= max_cache_size) {
-		cache.splice(cache.begin(), cache, --cache.end()); // Move last to front
-		cache.front().frame_number = n;
-		cache.front().frame = out;
+	while (!cache.empty() && total_size >= max_cache_size) {
+		total_size -= cache.back().frame.data.size();
+		index.erase(cache.back().frame_number);
+		cache.pop_back();
 	}
-	else
-		cache.emplace_front(out, n);
+
+	cache.emplace_front(out, n);
+	index[n] = cache.begin();
+	total_size += out.data.size();
 }
 }
 
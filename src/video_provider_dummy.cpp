@@ -53,7 +53,7 @@ DummyVideoProvider::DummyVideoProvider(double fps, int frames, int width, int he
 , width(width)
 , height(height)
 {
-	data.resize(width * height * 4);
+	data.reset(width * height * 4);
 
 	auto red = colour.r;
 	auto green = colour.g;
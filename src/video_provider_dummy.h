@@ -33,6 +33,7 @@
 ///
 
 #include "include/aegisub/video_provider.h"
+#include "video_frame.h"
 
 namespace agi { struct Color; }
 
@@ -47,8 +48,8 @@ class DummyVideoProvider final : public VideoProvider {
 	int width;               ///< Width in pixels
 	int height;              ///< Height in pixels
 
-	/// The data for the image returned for all frames
-	std::vector<unsigned char> data;
+	/// The data for the image returned for all frames, shared by all of them
+	SharedFrameData data;
 
 public:
 	/// Create a dummy video from separate parameters
@@ -44,6 +44,7 @@
 #include <libaegisub/ycbcr_conv.h>
 
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <memory>
 #include <vector>
 
@@ -118,6 +119,12 @@ class YUV4MPEGVideoProvider final : public VideoProvider {
 	int frame_sz;	/// size of each frame in bytes
 	int luma_sz;	/// size of the luma plane of each frame, in bytes
 	int chroma_sz;	/// size of one of the two chroma planes of each frame, in bytes
+	int chroma_w = 0;	/// width of the chroma planes, in samples
+	int chroma_shift_x = 0, chroma_shift_y = 0; /// log2 of the chroma subsampling
+	int bit_depth = 8;	/// bits per sample; anything over 8 is stored in two bytes
+
+	/// a row of neutral chroma to use for every row of mono video
+	std::vector<uint8_t> neutral_chroma;
 
 	Y4M_PixelFormat pixfmt = Y4M_PIXFMT_NONE;		/// colorspace/pixel format
 	Y4M_InterlacingMode imode = Y4M_ILACE_NOTSET;	/// interlacing mode (for the entire stream)
@@ -181,17 +188,35 @@ YUV4MPEGVideoProvider::YUV4MPEGVideoProvider(agi::fs::path const& filename)
 	if (imode == Y4M_ILACE_NOTSET)
 		imode = Y4M_ILACE_UNKNOWN;
 
-	luma_sz = w * h;
 	switch (pixfmt) {
 	case Y4M_PIXFMT_420JPEG:
 	case Y4M_PIXFMT_420MPEG2:
 	case Y4M_PIXFMT_420PALDV:
-		chroma_sz	= (w * h) >> 2; break;
+		chroma_shift_x = 1; chroma_shift_y = 1; break;
+	case Y4M_PIXFMT_411:
+		chroma_shift_x = 2; break;
+	case Y4M_PIXFMT_422:
+		chroma_shift_x = 1; break;
 	default:
-		/// @todo add support for more pixel formats
-		throw VideoOpenError("Unsupported pixel format");
+		break;
+	}
+
+	int sample_sz = bit_depth > 8 ? 2 : 1;
+	luma_sz = w * h * sample_sz;
+	chroma_w = (w + (1 << chroma_shift_x) - 1) >> chroma_shift_x;
+	int chroma_h = (h + (1 << chroma_shift_y) - 1) >> chroma_shift_y;
+	chroma_sz = pixfmt == Y4M_PIXFMT_MONO ? 0 : chroma_w * chroma_h * sample_sz;
+	// the alpha plane is skipped over, as there's nothing to draw it over
+	frame_sz = luma_sz + chroma_sz * 2 + (pixfmt == Y4M_PIXFMT_444ALPHA ? luma_sz : 0);
+
+	if (pixfmt == Y4M_PIXFMT_MONO) {
+		int neutral = 1 << (bit_depth - 1);
+		for (int i = 0; i < w; ++i) {
+			neutral_chroma.push_back(static_cast<uint8_t>(neutral));
+			if (sample_sz == 2)
+				neutral_chroma.push_back(static_cast<uint8_t>(neutral >> 8));
+		}
 	}
-	frame_sz	= luma_sz + chroma_sz*2;
 
 	num_frames = IndexFile(pos);
 	if (num_frames <= 0 || seek_table.empty())
@@ -251,6 +276,7 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 	int t_fps_den	= -1;
 	Y4M_InterlacingMode t_imode	= Y4M_ILACE_NOTSET;
 	Y4M_PixelFormat t_pixfmt	= Y4M_PIXFMT_NONE;
+	int t_bit_depth = -1;
 
 	for (unsigned i = 1; i < tags.size(); i++) {
 		char type = tags[i][0];
@@ -278,6 +304,15 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 			// technically this should probably be case sensitive,
 			// but being liberal in what you accept doesn't hurt
 			boost::to_lower(tag);
+
+			// high bit depth formats have the depth on the end, e.g. 420p10 or mono16
+			t_bit_depth = 8;
+			if (tag.find_first_of("0123456789", 3) == 4 && (tag[3] == 'p' || boost::starts_with(tag, "mono"))) {
+				if (!agi::util::try_parse(tag.substr(4), &t_bit_depth) || t_bit_depth < 8 || t_bit_depth > 16)
+					err = "invalid or unknown colorspace";
+				tag.erase(tag[3] == 'p' ? 3 : 4);
+			}
+
 			if (tag == "420")			t_pixfmt = Y4M_PIXFMT_420JPEG; // is this really correct?
 			else if (tag == "420jpeg")	t_pixfmt = Y4M_PIXFMT_420JPEG;
 			else if (tag == "420mpeg2")	t_pixfmt = Y4M_PIXFMT_420MPEG2;
@@ -319,7 +354,7 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 			err = "illegal height change";
 		if ((t_fps_num > 0 && t_fps_den > 0) && (t_fps_num != fps_rat.num || t_fps_den != fps_rat.den))
 			err = "illegal framerate change";
-		if (t_pixfmt != Y4M_PIXFMT_NONE && t_pixfmt != pixfmt)
+		if ((t_pixfmt != Y4M_PIXFMT_NONE && t_pixfmt != pixfmt) || (t_bit_depth > 0 && t_bit_depth != bit_depth))
 			err = "illegal colorspace change";
 		if (t_imode != Y4M_ILACE_NOTSET && t_imode != imode)
 			err = "illegal interlacing mode change";
@@ -333,6 +368,7 @@ void YUV4MPEGVideoProvider::ParseFileHeader(const std::vector<std::string>& tags
 		fps_rat.den = t_fps_den;
 		pixfmt		= t_pixfmt	!= Y4M_PIXFMT_NONE	? t_pixfmt	: Y4M_PIXFMT_420JPEG;
 		imode		= t_imode	!= Y4M_ILACE_NOTSET	? t_imode	: Y4M_ILACE_UNKNOWN;
+		bit_depth	= t_bit_depth > 0 ? t_bit_depth : 8;
 		fps = double(fps_rat.num) / fps_rat.den;
 		inited = true;
 	}
@@ -390,34 +426,29 @@ int YUV4MPEGVideoProvider::IndexFile(uint64_t pos) {
 void YUV4MPEGVideoProvider::GetFrame(int n, VideoFrame &frame) {
 	n = mid(0, n, num_frames - 1);
 
-	int uv_width = w / 2;
-
-	auto src_y = reinterpret_cast<const unsigned char *>(file.read(seek_table[n], luma_sz + chroma_sz * 2));
-	auto src_u = src_y + luma_sz;
-	auto src_v = src_u + chroma_sz;
-	frame.data.resize(w * h * 4);
-	unsigned char *dst = &frame.data[0];
-
-	for (int py = 0; py < h; ++py) {
-		for (int px = 0; px < w / 2; ++px) {
-			const uint8_t u = *src_u++;
-			const uint8_t v = *src_v++;
-			for (unsigned int i = 0; i < 2; ++i) {
-				const uint8_t y = *src_y++;
-				auto rgb = conv.ycbcr_to_rgb({{y, u, v}});
-				*dst++ = rgb[2];
-				*dst++ = rgb[1];
-				*dst++ = rgb[0];
-				*dst++ = 0;
-			}
-		}
+	int sample_sz = bit_depth > 8 ? 2 : 1;
+	auto src = reinterpret_cast<const uint8_t *>(file.read(seek_table[n], luma_sz + chroma_sz * 2));
 
-		// Roll back u/v on even lines
-		if (!(py & 1)) {
-			src_u -= uv_width;
-			src_v -= uv_width;
-		}
+	agi::ycbcr_planar_image img;
+	img.planes[0] = src;
+	img.strides[0] = w * sample_sz;
+	if (pixfmt == Y4M_PIXFMT_MONO) {
+		img.planes[1] = img.planes[2] = neutral_chroma.data();
+		img.strides[1] = img.strides[2] = 0;
+	}
+	else {
+		img.planes[1] = src + luma_sz;
+		img.planes[2] = src + luma_sz + chroma_sz;
+		img.strides[1] = img.strides[2] = chroma_w * sample_sz;
 	}
+	img.width = w;
+	img.height = h;
+	img.chroma_shift_x = chroma_shift_x;
+	img.chroma_shift_y = chroma_shift_y;
+	img.bit_depth = bit_depth;
+
+	frame.data.reset(w * h * 4);
+	conv.planar_to_bgrx(img, frame.data.data(), w * 4);
 
 	frame.flipped = false;
 	frame.width = w;
@@ -16,6 +16,8 @@
 
 #include "util.h"
 
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <sstream>
@@ -43,4 +45,23 @@ int read_written_rand(const char *path) {
 	return value;
 }
 
+double benchmark(const char *name, size_t items, std::function<void()> const& fn) {
+	using clock = std::chrono::steady_clock;
+
+	fn(); // warm up caches and any lazy initialization
+
+	size_t calls = 0;
+	auto start = clock::now();
+	std::chrono::duration<double> elapsed;
+	do {
+		fn();
+		++calls;
+		elapsed = clock::now() - start;
+	} while (elapsed.count() < 1.0);
+
+	double rate = calls * items / elapsed.count();
+	printf("%-40s %12.0f items/s\n", name, rate);
+	return rate;
+}
+
 }
@@ -14,6 +14,8 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 namespace util {
@@ -21,4 +23,10 @@ bool compare(std::string const& file1, std::string const& file2);
 
 int write_rand(const char *path);
 int read_written_rand(const char *path);
+
+/// Call fn repeatedly for at least a second, print how many items per second
+/// were processed, and return that rate
+/// @param name Label for the printed result
+/// @param items Number of items processed by each call to fn
+double benchmark(const char *name, size_t items, std::function<void()> const& fn);
 }
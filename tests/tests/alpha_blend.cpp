@@ -0,0 +1,158 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <libaegisub/alpha_blend.h>
+
+#include <main.h>
+#include <util.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+/// The blend as it was written before it was vectorized
+void reference_blend(uint8_t *dst, const uint8_t *mask, int width, uint8_t r, uint8_t g, uint8_t b, uint8_t opacity) {
+	for (int x = 0; x < width; ++x, dst += 4) {
+		unsigned k = mask[x] * opacity / 255;
+		unsigned ck = 255 - k;
+		dst[0] = (k * b + ck * dst[0]) / 255;
+		dst[1] = (k * g + ck * dst[1]) / 255;
+		dst[2] = (k * r + ck * dst[2]) / 255;
+		dst[3] = 0;
+	}
+}
+}
+
+TEST(lagi_alpha_blend, every_mask_opacity_and_pixel_value) {
+	// One row per pixel value, with every mask value along each row
+	std::vector<uint8_t> mask(256 * 256);
+	for (size_t i = 0; i < mask.size(); ++i)
+		mask[i] = (uint8_t)i;
+
+	std::vector<uint8_t> image(256 * 256 * 4), expected(256 * 256 * 4);
+	for (int opacity = 0; opacity < 256; opacity += 5) {
+		for (size_t i = 0; i < image.size(); ++i)
+			image[i] = expected[i] = (uint8_t)(i / 1024 + i % 4);
+
+		agi::BlendMask(image.data(), 1024, mask.data(), 256, 256, 256, 255, 0, 128, opacity);
+		for (int y = 0; y < 256; ++y)
+			reference_blend(&expected[y * 1024], &mask[y * 256], 256, 255, 0, 128, opacity);
+		ASSERT_TRUE(image == expected) << "opacity " << opacity;
+	}
+}
+
+TEST(lagi_alpha_blend, odd_sizes) {
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	// Widths which leave a remainder for each vector size
+	for (int width = 1; width < 40; ++width) {
+		const int height = 3;
+		const int stride = width * 4 + 8;
+		std::vector<uint8_t> mask(width * height), image(stride * height);
+		for (auto& m : mask) m = byte(rng);
+		for (auto& p : image) p = byte(rng);
+		auto expected = image;
+
+		uint8_t r = byte(rng), g = byte(rng), b = byte(rng), opacity = byte(rng);
+		agi::BlendMask(image.data(), stride, mask.data(), width, width, height, r, g, b, opacity);
+		for (int y = 0; y < height; ++y)
+			reference_blend(&expected[y * stride], &mask[y * width], width, r, g, b, opacity);
+		ASSERT_TRUE(image == expected) << "width " << width;
+	}
+}
+
+TEST(lagi_alpha_blend, negative_stride) {
+	std::vector<uint8_t> mask = {255, 255, 0, 0};
+	std::vector<uint8_t> image(2 * 2 * 4, 100);
+
+	// Blend from the bottom row up, so the first mask row lands on the
+	// second image row
+	agi::BlendMask(&image[8], -8, mask.data(), 2, 2, 2, 10, 20, 30, 255);
+
+	std::vector<uint8_t> expected = {
+		100, 100, 100, 0, 100, 100, 100, 0,
+		30, 20, 10, 0, 30, 20, 10, 0
+	};
+	EXPECT_TRUE(image == expected);
+}
+
+TEST(DISABLED_lagi_alpha_blend_bench, glyphs) {
+	// libass can't be run from here, so rather than image lists recorded
+	// from it these are synthetic ones shaped like what it produces for a
+	// heavily typeset 4K frame: forty lines of text, each drawn as a shadow,
+	// a border and a fill image covering the whole line, in that order. The
+	// glyphs are antialiased only at their edges and most of each image is
+	// empty, as with real text, but the absolute numbers are still only a
+	// rough guide to the speed of real rendering.
+	const int width = 3840, height = 2160;
+	std::vector<uint8_t> frame(width * height * 4);
+
+	struct Image {
+		int w, h, x, y;
+		std::vector<uint8_t> const* mask;
+		uint8_t r, g, b, opacity;
+	};
+	std::vector<std::vector<uint8_t>> masks;
+	std::vector<Image> images;
+	std::mt19937 rng(0);
+	size_t pixels = 0;
+
+	// Coverage of a row of ring-shaped glyphs, with the rings grown by
+	// `grow` pixels on each side for the border
+	auto draw_line = [](int w, int h, int glyphs, double grow) {
+		std::vector<uint8_t> mask(w * h);
+		const double advance = (double)w / glyphs;
+		const double rx = advance * .4, ry = h * .35, thickness = 7;
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				double cx = (std::floor(x / advance) + .5) * advance, cy = h / 2.;
+				double dx = (x - cx) / rx, dy = (y - cy) / ry;
+				// Approximate distance in pixels from the middle of the stroke
+				double dist = std::abs(std::sqrt(dx * dx + dy * dy) - 1) * std::min(rx, ry);
+				double cover = thickness / 2 + grow - dist + .5;
+				mask[y * w + x] = (uint8_t)(cover <= 0 ? 0 : cover >= 1 ? 255 : cover * 255);
+			}
+		}
+		return mask;
+	};
+
+	masks.reserve(80);
+	for (int i = 0; i < 40; ++i) {
+		int glyphs = std::uniform_int_distribution<int>(10, 50)(rng);
+		int w = glyphs * 60, h = 110;
+		int x = std::uniform_int_distribution<int>(0, width - w - 6)(rng);
+		int y = std::uniform_int_distribution<int>(0, height - h - 6)(rng);
+		masks.push_back(draw_line(w, h, glyphs, 0));
+		auto const& fill = masks.back();
+		masks.push_back(draw_line(w, h, glyphs, 3));
+		auto const& border = masks.back();
+
+		uint8_t opacity = i % 4 ? 255 : 160;
+		images.push_back({w, h, x + 6, y + 6, &border, 0, 0, 0, (uint8_t)(opacity / 2)});
+		images.push_back({w, h, x, y, &border, 0, 0, 0, opacity});
+		images.push_back({w, h, x, y, &fill, (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), opacity});
+		pixels += w * h * 3;
+	}
+
+	util::benchmark("blend line images (pixels)", pixels, [&] {
+		for (auto const& img : images)
+			agi::BlendMask(&frame[(img.y * width + img.x) * 4], width * 4, img.mask->data(), img.w,
+			               img.w, img.h, img.r, img.g, img.b, img.opacity);
+	});
+}
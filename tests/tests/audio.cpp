@@ -15,7 +15,9 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include <main.h>
+#include <util.h>
 
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/audio/provider.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/make_unique.h>
@@ -23,6 +25,8 @@
 #include <libaegisub/util.h>
 
 #include <boost/filesystem/fstream.hpp>
+#include <cstring>
+#include <thread>
 
 namespace bfs = boost::filesystem;
 
@@ -228,6 +232,320 @@ TEST(lagi_audio, hd_cache) {
 		ASSERT_EQ(static_cast<uint16_t>((1 << 22) - 256 + i), buff[i]);
 }
 
+template<typename Create>
+void TestConcurrentReads(Create create) {
+	auto provider = create(agi::make_unique<TestAudioProvider<>>());
+
+	// Read from several threads while the cache is still being filled, and
+	// check that everything which claims to be decoded is correct
+	std::atomic<bool> failed{false};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&, t] {
+			std::vector<uint16_t> buff(1000);
+			for (int64_t start = t * 7919; start < provider->GetNumSamples() - 1000; start += 100003) {
+				auto decoded = provider->GetDecodedSamples();
+				provider->GetAudio(buff.data(), start, 1000);
+				for (int64_t i = 0; i < 1000 && start + i < decoded; ++i) {
+					if (buff[i] != static_cast<uint16_t>(start + i))
+						failed = true;
+				}
+			}
+		});
+	}
+	for (auto& thread : readers)
+		thread.join();
+	EXPECT_FALSE(failed);
+}
+
+TEST(lagi_audio, ram_cache_concurrent_reads) {
+	TestConcurrentReads([](std::unique_ptr<agi::AudioProvider> src) {
+		return agi::CreateRAMAudioProvider(std::move(src));
+	});
+}
+
+TEST(lagi_audio, hd_cache_concurrent_reads) {
+	TestConcurrentReads([](std::unique_ptr<agi::AudioProvider> src) {
+		return agi::CreateHDAudioProvider(std::move(src), agi::Path().Decode("?temp"));
+	});
+}
+
+TEST(lagi_audio, compressed_ram_cache) {
+	auto provider = agi::CreateCompressedRAMAudioProvider(agi::make_unique<TestAudioProvider<>>());
+	EXPECT_EQ(1, provider->GetChannels());
+	EXPECT_EQ(90 * 48000, provider->GetNumSamples());
+	EXPECT_EQ(2, provider->GetBytesPerSample());
+	EXPECT_EQ(false, provider->AreSamplesFloat());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	uint16_t buff[512];
+	provider->GetAudio(buff, (1 << 15) - 256, 512); // Stride two compressed blocks
+	for (size_t i = 0; i < 512; ++i)
+		ASSERT_EQ(static_cast<uint16_t>((1 << 15) - 256 + i), buff[i]);
+
+	// Read the whole thing to cycle blocks through the decompressed cache
+	std::vector<uint16_t> all(provider->GetNumSamples());
+	provider->GetAudio(all.data(), 0, all.size());
+	for (size_t i = 0; i < all.size(); ++i)
+		ASSERT_EQ(static_cast<uint16_t>(i), all[i]);
+
+	auto peaks = provider->GetPeakIndex();
+	ASSERT_NE(nullptr, peaks);
+	EXPECT_TRUE(peaks->IsComplete());
+}
+
+TEST(lagi_audio, compressed_ram_cache_concurrent_reads) {
+	TestConcurrentReads([](std::unique_ptr<agi::AudioProvider> src) {
+		return agi::CreateCompressedRAMAudioProvider(std::move(src));
+	});
+}
+
+/// Stereo float audio with a ramp on the left channel and its negation on
+/// the right
+struct StereoFloatAudioProvider : agi::AudioProvider {
+	StereoFloatAudioProvider(int rate = 48000) {
+		channels = 2;
+		num_samples = 20 * rate;
+		decoded_samples = num_samples;
+		sample_rate = rate;
+		bytes_per_sample = sizeof(float);
+		float_samples = true;
+	}
+
+	static float Sample(int64_t i) { return (i % 1000) / 1000.f; }
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto out = static_cast<float *>(buf);
+		for (int64_t end = start + count; start < end; ++start) {
+			*out++ = Sample(start);
+			*out++ = -Sample(start) / 2;
+		}
+	}
+};
+
+TEST(lagi_audio, ram_cache_multichannel_float) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<StereoFloatAudioProvider>());
+	EXPECT_EQ(2, provider->GetChannels());
+	EXPECT_TRUE(provider->AreSamplesFloat());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	// Blocks hold 2^19 stereo float frames, so this crosses a block boundary
+	const int64_t start = (1 << 19) - 100;
+	std::vector<float> buff(400);
+	provider->GetAudio(buff.data(), start, 200);
+	for (int64_t i = 0; i < 200; ++i) {
+		ASSERT_EQ(StereoFloatAudioProvider::Sample(start + i), buff[i * 2]);
+		ASSERT_EQ(-StereoFloatAudioProvider::Sample(start + i) / 2, buff[i * 2 + 1]);
+	}
+
+	auto peaks = provider->GetPeakIndex();
+	ASSERT_NE(nullptr, peaks);
+	EXPECT_TRUE(peaks->IsComplete());
+}
+
+TEST(lagi_audio, hd_cache_multichannel_float) {
+	auto provider = agi::CreateHDAudioProvider(agi::make_unique<StereoFloatAudioProvider>(), agi::Path().Decode("?temp"));
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	std::vector<float> buff(400);
+	provider->GetAudio(buff.data(), 12345, 200);
+	for (int64_t i = 0; i < 200; ++i) {
+		ASSERT_EQ(StereoFloatAudioProvider::Sample(12345 + i), buff[i * 2]);
+		ASSERT_EQ(-StereoFloatAudioProvider::Sample(12345 + i) / 2, buff[i * 2 + 1]);
+	}
+}
+
+TEST(lagi_audio, compressed_ram_cache_multichannel_float) {
+	auto provider = agi::CreateCompressedRAMAudioProvider(agi::make_unique<StereoFloatAudioProvider>());
+	EXPECT_EQ(2, provider->GetChannels());
+	EXPECT_TRUE(provider->AreSamplesFloat());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	std::vector<float> buff(provider->GetNumSamples() * 2);
+	provider->GetAudio(buff.data(), 0, provider->GetNumSamples());
+	for (int64_t i = 0; i < provider->GetNumSamples(); ++i) {
+		ASSERT_EQ(StereoFloatAudioProvider::Sample(i), buff[i * 2]);
+		ASSERT_EQ(-StereoFloatAudioProvider::Sample(i) / 2, buff[i * 2 + 1]);
+	}
+}
+
+TEST(lagi_audio, float_volume) {
+	StereoFloatAudioProvider provider;
+	float buff[8];
+	provider.GetAudioWithVolume(buff, 100, 4, 0.5);
+	for (int i = 0; i < 4; ++i) {
+		EXPECT_EQ(StereoFloatAudioProvider::Sample(100 + i) / 2, buff[i * 2]);
+		EXPECT_EQ(-StereoFloatAudioProvider::Sample(100 + i) / 4, buff[i * 2 + 1]);
+	}
+}
+
+TEST(lagi_audio, sample_doubling_multichannel_float) {
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<StereoFloatAudioProvider>(22050));
+	EXPECT_EQ(44100, provider->GetSampleRate());
+	EXPECT_EQ(2, provider->GetChannels());
+
+	float buff[10];
+	provider->GetAudio(buff, 201, 5);
+	for (int i = 0; i < 5; ++i) {
+		int64_t pos = 201 + i;
+		float expected = pos % 2
+			? (StereoFloatAudioProvider::Sample(pos / 2) + StereoFloatAudioProvider::Sample(pos / 2 + 1)) / 2
+			: StereoFloatAudioProvider::Sample(pos / 2);
+		EXPECT_EQ(expected, buff[i * 2]);
+	}
+}
+
+TEST(lagi_audio, save_float_audio_clip) {
+	auto path = agi::Path().Decode("?temp/save_float_clip");
+	agi::SaveAudioClip(StereoFloatAudioProvider(), path, 0, 1000);
+
+	// Non-PCM formats have a cbSize in the format chunk and a fact chunk
+	{
+		char header[58];
+		bfs::ifstream s(path, std::ios::binary);
+		s.read(header, sizeof header);
+		ASSERT_EQ((std::streamsize)sizeof header, s.gcount());
+
+		auto read32 = [&](size_t pos) { int32_t v; memcpy(&v, header + pos, 4); return v; };
+		auto read16 = [&](size_t pos) { int16_t v; memcpy(&v, header + pos, 2); return v; };
+		const int32_t samples = StereoFloatAudioProvider().GetSampleRate();
+		EXPECT_EQ(50 + samples * 8, read32(4));
+		EXPECT_EQ(0, memcmp(header + 12, "fmt ", 4));
+		EXPECT_EQ(18, read32(16));
+		EXPECT_EQ(3, read16(20));
+		EXPECT_EQ(0, read16(36));
+		EXPECT_EQ(0, memcmp(header + 38, "fact", 4));
+		EXPECT_EQ(4, read32(42));
+		EXPECT_EQ(samples, read32(46));
+		EXPECT_EQ(0, memcmp(header + 50, "data", 4));
+		EXPECT_EQ(samples * 8, read32(54));
+	}
+
+	auto provider = agi::CreatePCMAudioProvider(path, nullptr);
+	EXPECT_EQ(2, provider->GetChannels());
+	EXPECT_TRUE(provider->AreSamplesFloat());
+	EXPECT_EQ(4, provider->GetBytesPerSample());
+
+	float buff[20];
+	provider->GetAudio(buff, 1500, 10);
+	for (int i = 0; i < 10; ++i)
+		ASSERT_EQ(StereoFloatAudioProvider::Sample(1500 + i), buff[i * 2]);
+
+	agi::fs::Remove(path);
+}
+
+TEST(lagi_audio, ram_cache_peak_index) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	auto peaks = provider->GetPeakIndex();
+	ASSERT_NE(nullptr, peaks);
+	EXPECT_TRUE(peaks->IsComplete());
+
+	agi::AudioPeak peak;
+	ASSERT_TRUE(peaks->Get(0, 65536, peak));
+	EXPECT_EQ(SHRT_MIN, peak.min);
+	EXPECT_EQ(SHRT_MAX, peak.max);
+}
+
+TEST(lagi_audio, peak_index_matches_samples) {
+	std::vector<int16_t> samples(100000);
+	for (size_t i = 0; i < samples.size(); ++i)
+		samples[i] = (int16_t)((i * 7919) % 20000 - 10000);
+
+	agi::AudioPeakIndex index(samples.size());
+	agi::AudioPeak peak;
+	EXPECT_FALSE(index.Get(0, 1024, peak));
+
+	// Add in chunks which don't line up with the buckets
+	for (size_t i = 0; i < samples.size(); i += 1000)
+		index.Add(&samples[i], std::min<int64_t>(1000, samples.size() - i));
+	ASSERT_TRUE(index.IsComplete());
+
+	// Too small to answer from the index
+	EXPECT_FALSE(index.Get(0, 100, peak));
+
+	for (int64_t count : {256, 1000, 4096, 30000, 100000}) {
+		SCOPED_TRACE(count);
+		for (int64_t start = 0; start < (int64_t)samples.size(); start += count) {
+			ASSERT_TRUE(index.Get(start, count, peak));
+			EXPECT_GE(0, peak.min);
+			EXPECT_LE(0, peak.max);
+			EXPECT_GE(peak.max, peak.avg_max);
+			EXPECT_LE(peak.min, peak.avg_min);
+		}
+	}
+
+	ASSERT_TRUE(index.Get(0, samples.size(), peak));
+	EXPECT_EQ(*std::min_element(samples.begin(), samples.end()), peak.min);
+	EXPECT_EQ(*std::max_element(samples.begin(), samples.end()), peak.max);
+
+	// Ranges past the end are silent
+	ASSERT_TRUE(index.Get(samples.size() + 10, 1024, peak));
+	EXPECT_EQ(0, peak.min);
+	EXPECT_EQ(0, peak.max);
+}
+
+TEST(lagi_audio, peak_index_partial) {
+	std::vector<int16_t> samples(10000, 100);
+	agi::AudioPeakIndex index(samples.size());
+	index.Add(&samples[0], 5000);
+	EXPECT_EQ(5000, index.GetIndexedSamples());
+	EXPECT_FALSE(index.IsComplete());
+
+	agi::AudioPeak peak;
+	ASSERT_TRUE(index.Get(0, 4096, peak));
+	EXPECT_EQ(100, peak.max);
+	EXPECT_EQ(100, peak.avg_max);
+	EXPECT_FALSE(index.Get(4096, 4096, peak));
+}
+
+TEST(lagi_audio, peak_index_add_after_complete) {
+	// The loudest sample is in the final, partial bucket
+	std::vector<int16_t> samples(1000, 10);
+	samples[900] = 5000;
+	agi::AudioPeakIndex index(samples.size());
+	index.Add(&samples[0], samples.size());
+	ASSERT_TRUE(index.IsComplete());
+
+	std::vector<int16_t> more(100, 20000);
+	index.Add(&more[0], 0);
+	index.Add(&more[0], more.size());
+	EXPECT_EQ(1000, index.GetIndexedSamples());
+
+	agi::AudioPeak peak;
+	ASSERT_TRUE(index.Get(0, samples.size(), peak));
+	EXPECT_EQ(5000, peak.max);
+}
+
+TEST(lagi_audio, peak_index_save_load) {
+	std::vector<int16_t> samples(12345);
+	for (size_t i = 0; i < samples.size(); ++i)
+		samples[i] = (int16_t)(i * 3);
+
+	agi::AudioPeakIndex index(samples.size());
+	index.Add(&samples[0], samples.size());
+	ASSERT_NO_THROW(index.Save("data/peaks"));
+
+	EXPECT_EQ(nullptr, agi::AudioPeakIndex::Load("data/peaks", samples.size() + 1));
+	EXPECT_EQ(nullptr, agi::AudioPeakIndex::Load("data/nonexistent_peaks", samples.size()));
+	EXPECT_EQ(nullptr, agi::AudioPeakIndex::Load("data/ten_bytes", samples.size()));
+
+	auto loaded = agi::AudioPeakIndex::Load("data/peaks", samples.size());
+	ASSERT_NE(nullptr, loaded);
+	EXPECT_TRUE(loaded->IsComplete());
+
+	agi::AudioPeak expected, actual;
+	for (int64_t start = 0; start < (int64_t)samples.size(); start += 777) {
+		ASSERT_TRUE(index.Get(start, 777, expected));
+		ASSERT_TRUE(loaded->Get(start, 777, actual));
+		EXPECT_EQ(expected.min, actual.min);
+		EXPECT_EQ(expected.max, actual.max);
+		EXPECT_EQ(expected.avg_min, actual.avg_min);
+		EXPECT_EQ(expected.avg_max, actual.avg_max);
+	}
+}
+
 TEST(lagi_audio, convert_8bit) {
 	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<TestAudioProvider<uint8_t>>());
 
@@ -242,15 +560,25 @@ TEST(lagi_audio, convert_32bit) {
 	src->bias = INT_MIN;
 	auto provider = agi::CreateConvertAudioProvider(std::move(src));
 
-	int16_t sample;
+	EXPECT_TRUE(provider->AreSamplesFloat());
+	EXPECT_EQ(4, provider->GetBytesPerSample());
+
+	float sample;
 	provider->GetAudio(&sample, 0, 1);
-	EXPECT_EQ(SHRT_MIN, sample);
+	EXPECT_EQ(-1.f, sample);
 
 	provider->GetAudio(&sample, 1LL << 31, 1);
-	EXPECT_EQ(0, sample);
+	EXPECT_EQ(0.f, sample);
 
-	provider->GetAudio(&sample, (1LL << 32) - 1, 1);
-	EXPECT_EQ(SHRT_MAX, sample);
+	int16_t sample16;
+	provider->GetInt16MonoAudio(&sample16, 0, 1);
+	EXPECT_EQ(SHRT_MIN, sample16);
+
+	provider->GetInt16MonoAudio(&sample16, 1LL << 31, 1);
+	EXPECT_EQ(0, sample16);
+
+	provider->GetInt16MonoAudio(&sample16, (1LL << 32) - 1, 1);
+	EXPECT_EQ(SHRT_MAX, sample16);
 }
 
 TEST(lagi_audio, sample_doubling) {
@@ -310,10 +638,10 @@ TEST(lagi_audio, stereo_downmix) {
 	};
 
 	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<AudioProvider>());
-	EXPECT_EQ(1, provider->GetChannels());
+	EXPECT_EQ(2, provider->GetChannels());
 
 	int16_t samples[100];
-	provider->GetAudio(samples, 0, 100);
+	provider->GetInt16MonoAudio(samples, 0, 100);
 	for (int i = 0; i < 100; ++i)
 		EXPECT_EQ(i, samples[i]);
 }
@@ -340,22 +668,244 @@ struct FloatAudioProvider : agi::AudioProvider {
 
 TEST(lagi_audio, float_conversion) {
 	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<FloatAudioProvider<float>>());
-	EXPECT_FALSE(provider->AreSamplesFloat());
+	EXPECT_TRUE(provider->AreSamplesFloat());
 
 	int16_t samples[1 << 16];
-	provider->GetAudio(samples, 0, 1 << 16);
+	provider->GetInt16MonoAudio(samples, 0, 1 << 16);
 	for (int i = 0; i < (1 << 16); ++i)
 		ASSERT_EQ(i + SHRT_MIN, samples[i]);
 }
 
 TEST(lagi_audio, double_conversion) {
+	FloatAudioProvider<double> raw;
 	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<FloatAudioProvider<double>>());
-	EXPECT_FALSE(provider->AreSamplesFloat());
+	EXPECT_TRUE(provider->AreSamplesFloat());
+	EXPECT_EQ(4, provider->GetBytesPerSample());
 
-	int16_t samples[1 << 16];
-	provider->GetAudio(samples, 0, 1 << 16);
+	std::vector<double> expected(1 << 16);
+	raw.GetAudio(expected.data(), 0, 1 << 16);
+	std::vector<float> samples(1 << 16);
+	provider->GetAudio(samples.data(), 0, 1 << 16);
 	for (int i = 0; i < (1 << 16); ++i)
-		ASSERT_EQ(i + SHRT_MIN, samples[i]);
+		ASSERT_EQ((float)expected[i], samples[i]);
+
+	// Going through float can lose the last bit
+	std::vector<int16_t> samples16(1 << 16);
+	provider->GetInt16MonoAudio(samples16.data(), 0, 1 << 16);
+	for (int i = 0; i < (1 << 16); ++i)
+		ASSERT_NEAR(i + SHRT_MIN, samples16[i], 1);
+
+	// But not when reading directly from the double source
+	raw.GetInt16MonoAudio(samples16.data(), 0, 1 << 16);
+	for (int i = 0; i < (1 << 16); ++i)
+		ASSERT_EQ(i + SHRT_MIN, samples16[i]);
+}
+
+TEST(lagi_audio, convert_24bit) {
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider() {
+			channels = 1;
+			num_samples = 1 << 16;
+			decoded_samples = num_samples;
+			sample_rate = 48000;
+			bytes_per_sample = 3;
+			float_samples = false;
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			auto out = static_cast<uint8_t *>(buf);
+			for (int64_t end = start + count; start < end; ++start) {
+				*out++ = 0xAB;
+				*out++ = (uint8_t)start;
+				*out++ = (uint8_t)(start >> 8);
+			}
+		}
+	};
+
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<AudioProvider>());
+	EXPECT_TRUE(provider->AreSamplesFloat());
+	EXPECT_EQ(4, provider->GetBytesPerSample());
+
+	// Odd start and count to cover the unaligned head and the scalar tail
+	std::vector<float> samples(1001);
+	provider->GetAudio(samples.data(), 32001, samples.size());
+	for (int i = 0; i < 1001; ++i) {
+		auto sample = (int32_t)((uint32_t)(32001 + i) << 16 | 0xAB00);
+		ASSERT_EQ(sample / 2147483648.f, samples[i]);
+	}
+}
+
+TEST(lagi_audio, float_conversion_clamps) {
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider() {
+			channels = 1;
+			num_samples = 1000;
+			decoded_samples = num_samples;
+			sample_rate = 48000;
+			bytes_per_sample = sizeof(float);
+			float_samples = true;
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			auto out = static_cast<float *>(buf);
+			for (int64_t end = start + count; start < end; ++start)
+				*out++ = start % 2 ? 1.5f + start : -1.5f - start;
+		}
+	};
+
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<AudioProvider>());
+	int16_t samples[37];
+	provider->GetInt16MonoAudio(samples, 0, 37);
+	for (int i = 0; i < 37; ++i)
+		ASSERT_EQ(i % 2 ? SHRT_MAX : SHRT_MIN, samples[i]);
+}
+
+TEST(lagi_audio, multichannel_downmix) {
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider(int channels) {
+			this->channels = channels;
+			num_samples = 90 * 48000;
+			decoded_samples = num_samples;
+			sample_rate = 48000;
+			bytes_per_sample = 2;
+			float_samples = false;
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			auto out = static_cast<int16_t *>(buf);
+			for (int64_t end = start + count; start < end; ++start) {
+				for (int c = 0; c < channels; ++c)
+					*out++ = (int16_t)(-start * (c + 1) + c);
+			}
+		}
+	};
+
+	for (int channels = 2; channels <= 6; ++channels) {
+		SCOPED_TRACE(channels);
+		auto provider = agi::CreateConvertAudioProvider(agi::make_unique<AudioProvider>(channels));
+		EXPECT_EQ(channels, provider->GetChannels());
+
+		std::vector<int16_t> samples(99);
+		provider->GetInt16MonoAudio(samples.data(), 10, samples.size());
+		for (int i = 0; i < 99; ++i) {
+			int sum = 0;
+			for (int c = 0; c < channels; ++c)
+				sum += (int16_t)(-(i + 10) * (c + 1) + c);
+			ASSERT_EQ(sum / channels, samples[i]);
+		}
+	}
+}
+
+TEST(lagi_audio, sample_doubling_long) {
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider() {
+			channels = 1;
+			num_samples = 90 * 8000;
+			decoded_samples = num_samples;
+			sample_rate = 8000;
+			bytes_per_sample = 2;
+			float_samples = false;
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			auto out = static_cast<int16_t *>(buf);
+			for (int64_t end = start + count; start < end; ++start)
+				*out++ = (int16_t)(start % 2 ? -start * 3 : start * 5);
+		}
+	};
+
+	auto src = agi::make_unique<AudioProvider>();
+	auto const& raw = *src;
+	auto provider = agi::CreateConvertAudioProvider(std::move(src));
+	EXPECT_EQ(32000, provider->GetSampleRate());
+
+	// Undo one level of doubling at a time by checking against the source
+	// at a quarter of the rate
+	for (int64_t start : {0, 1, 2, 3, 1001}) {
+		SCOPED_TRACE(start);
+		std::vector<int16_t> samples(517);
+		provider->GetAudio(samples.data(), start, samples.size());
+
+		auto interp = [&](int64_t pos) -> int {
+			// Position in the 16 kHz stream
+			auto sample = [&](int64_t p) {
+				int16_t a, b;
+				raw.GetAudio(&a, p / 2, 1);
+				raw.GetAudio(&b, p / 2 + 1, 1);
+				return p % 2 ? (int16_t)(((int32_t)a + b) / 2) : a;
+			};
+			return pos % 2 ? (int16_t)(((int32_t)sample(pos / 2) + sample(pos / 2 + 1)) / 2) : sample(pos / 2);
+		};
+
+		for (int i = 0; i < 517; ++i)
+			ASSERT_EQ(interp(start + i), samples[i]);
+	}
+}
+
+/// Provider which just copies out a fixed block of raw audio so that the
+/// benchmarks measure the conversion rather than the source
+struct RawAudioProvider : agi::AudioProvider {
+	std::vector<char> data;
+
+	RawAudioProvider(int channels, int bytes_per_sample, bool is_float, int rate = 48000) {
+		this->channels = channels;
+		this->bytes_per_sample = bytes_per_sample;
+		float_samples = is_float;
+		sample_rate = rate;
+		num_samples = 1 << 20;
+		decoded_samples = num_samples;
+
+		data.resize(num_samples * channels * bytes_per_sample);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = (char)(i * 7919);
+		// Keep float samples finite and in range
+		if (is_float && bytes_per_sample == 4) {
+			auto f = reinterpret_cast<float *>(data.data());
+			for (int64_t i = 0; i < num_samples * channels; ++i)
+				f[i] = (float)((i % 2001) - 1000) / 1000.f;
+		}
+		else if (is_float) {
+			auto f = reinterpret_cast<double *>(data.data());
+			for (int64_t i = 0; i < num_samples * channels; ++i)
+				f[i] = ((i % 2001) - 1000) / 1000.;
+		}
+	}
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto frame = channels * bytes_per_sample;
+		memcpy(buf, &data[start * frame], count * frame);
+	}
+};
+
+TEST(lagi_audio, compressed_ram_cache_is_lossless) {
+	auto check = [](std::unique_ptr<RawAudioProvider> src) {
+		auto raw = src->data;
+		auto provider = agi::CreateCompressedRAMAudioProvider(std::move(src));
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+		std::vector<char> buff(raw.size());
+		provider->GetAudio(buff.data(), 0, provider->GetNumSamples());
+		EXPECT_TRUE(raw == buff);
+	};
+
+	// Noise, which compresses poorly and needs the escape codes
+	check(agi::make_unique<RawAudioProvider>(1, 2, false));
+	check(agi::make_unique<RawAudioProvider>(3, 4, false));
+	check(agi::make_unique<RawAudioProvider>(2, 4, true));
+
+	// Arbitrary bit patterns as float, including negative zero and NaNs
+	auto floats = agi::make_unique<RawAudioProvider>(2, 4, true);
+	for (size_t i = 0; i < floats->data.size(); ++i)
+		floats->data[i] = (char)(i * i * 7919 >> 3);
+	check(std::move(floats));
+
+	// Float audio which was converted from integers, plus negative zero
+	auto scaled = agi::make_unique<RawAudioProvider>(2, 4, true);
+	auto f = reinterpret_cast<float *>(scaled->data.data());
+	for (size_t i = 0; i < scaled->data.size() / 4; ++i)
+		f[i] = (int16_t)(i * 7919) / 32768.f;
+	f[1000] = -0.f;
+	check(std::move(scaled));
 }
 
 TEST(lagi_audio, pcm_simple) {
@@ -540,3 +1090,43 @@ TEST(lagi_audio, wave64_truncated) {
 
 	agi::fs::Remove(path);
 }
+
+TEST(DISABLED_lagi_audio_bench, convert) {
+	const int64_t count = 1 << 16;
+	std::vector<int16_t> buf(count);
+
+	auto run = [&](const char *name, int channels, int bytes_per_sample, bool is_float, int rate) {
+		auto provider = agi::CreateConvertAudioProvider(agi::make_unique<RawAudioProvider>(channels, bytes_per_sample, is_float, rate));
+		util::benchmark(name, count, [&] { provider->GetInt16MonoAudio(buf.data(), 0, count); });
+	};
+
+	run("u8 -> s16", 1, 1, false, 48000);
+	run("s24 -> s16", 1, 3, false, 48000);
+	run("s32 -> s16", 1, 4, false, 48000);
+	run("float -> s16", 1, 4, true, 48000);
+	run("double -> s16", 1, 8, true, 48000);
+	run("stereo s16 -> mono s16", 2, 2, false, 48000);
+	run("5.1 s16 -> mono s16", 6, 2, false, 48000);
+	run("16 kHz -> 32 kHz", 1, 2, false, 16000);
+	run("stereo float 44.1 kHz -> mono s16", 2, 4, true, 44100);
+}
+
+TEST(DISABLED_lagi_audio_bench, cache_read) {
+	const int64_t count = 1 << 12;
+	std::vector<int16_t> buf(count * 2);
+
+	auto run = [&](const char *name, std::unique_ptr<agi::AudioProvider> provider, int64_t stride) {
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+		int64_t start = 0;
+		util::benchmark(name, count, [&] {
+			provider->GetAudio(buf.data(), start, count);
+			start = (start + stride) % (provider->GetNumSamples() - count);
+		});
+	};
+
+	auto raw = [] { return agi::make_unique<RawAudioProvider>(2, 2, false); };
+	run("RAM cache sequential reads", agi::CreateRAMAudioProvider(raw()), count);
+	run("compressed RAM cache sequential reads", agi::CreateCompressedRAMAudioProvider(raw()), count);
+	run("RAM cache random reads", agi::CreateRAMAudioProvider(raw()), 1000003);
+	run("compressed RAM cache random reads", agi::CreateCompressedRAMAudioProvider(raw()), 1000003);
+}
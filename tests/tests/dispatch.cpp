@@ -0,0 +1,51 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+
+#include <libaegisub/dispatch.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(lagi_dispatch, parallel_for_runs_each_index_once) {
+	std::vector<std::atomic<int>> calls(1000);
+	agi::dispatch::ParallelFor(calls.size(), [&](size_t i) { ++calls[i]; });
+	for (auto const& count : calls)
+		EXPECT_EQ(1, count);
+}
+
+TEST(lagi_dispatch, parallel_for_no_jobs) {
+	bool called = false;
+	agi::dispatch::ParallelFor(0, [&](size_t) { called = true; });
+	EXPECT_FALSE(called);
+}
+
+TEST(lagi_dispatch, parallel_for_rethrows_lowest_index) {
+	std::atomic<int> calls{0};
+	try {
+		agi::dispatch::ParallelFor(100, [&](size_t i) {
+			++calls;
+			if (i % 10 == 3) throw std::runtime_error(std::to_string(i));
+		});
+		FAIL() << "ParallelFor should have thrown";
+	}
+	catch (std::runtime_error const& e) {
+		EXPECT_STREQ("3", e.what());
+	}
+	EXPECT_EQ(100, calls);
+}
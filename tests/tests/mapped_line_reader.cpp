@@ -0,0 +1,130 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/line_iterator.h>
+#include <libaegisub/mapped_line_reader.h>
+#include <libaegisub/path.h>
+
+#include <main.h>
+#include <util.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/format.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+agi::fs::path write_file(std::string const& contents) {
+	auto path = agi::Path().Decode("?temp/mapped_line_reader");
+	boost::filesystem::ofstream s(path, std::ios::binary);
+	s.write(contents.data(), contents.size());
+	return path;
+}
+
+std::vector<std::string> read_mapped(agi::fs::path const& path) {
+	std::vector<std::string> lines;
+	agi::mapped_line_reader reader(path);
+	while (reader.HasMoreLines())
+		lines.push_back(reader.ReadLine().to_string());
+	return lines;
+}
+
+/// Read lines the way TextFileReader does
+std::vector<std::string> read_stream(agi::fs::path const& path) {
+	std::vector<std::string> lines;
+	agi::read_file_mapping file(path);
+	boost::interprocess::ibufferstream stream(file.read(), file.size());
+	for (auto line : agi::line_iterator<std::string>(stream)) {
+		boost::trim(line);
+		if (boost::starts_with(line, "\xEF\xBB\xBF"))
+			line.erase(0, 3);
+		lines.push_back(std::move(line));
+	}
+	return lines;
+}
+
+void expect_lines(std::string const& contents, std::vector<std::string> const& expected) {
+	auto path = write_file(contents);
+	EXPECT_EQ(expected, read_mapped(path));
+	EXPECT_EQ(expected, read_stream(path));
+}
+}
+
+TEST(lagi_mapped_line_reader, line_endings) {
+	expect_lines("a\nb\nc", {"a", "b", "c"});
+	expect_lines("a\nb\nc\n", {"a", "b", "c", ""});
+	expect_lines("a\r\nb\r\nc\r\n", {"a", "b", "c", ""});
+	expect_lines("a\n\n\nb", {"a", "", "", "b"});
+	expect_lines("a\rb", {"a\rb"});
+	expect_lines("\n", {"", ""});
+}
+
+TEST(lagi_mapped_line_reader, trims_whitespace) {
+	expect_lines("  a b  \n\t c\t\r\n \f\v", {"a b", "c", ""});
+}
+
+TEST(lagi_mapped_line_reader, strips_bom) {
+	expect_lines("\xEF\xBB\xBF[Script Info]\r\nTitle: \xEF\xBB\xBF", {"[Script Info]", "Title: \xEF\xBB\xBF"});
+	expect_lines("\xEF\xBB\xBF", {""});
+	expect_lines("\xEF\xBB", {"\xEF\xBB"});
+}
+
+TEST(lagi_mapped_line_reader, lines_outlive_reads) {
+	agi::mapped_line_reader reader(write_file("one\ntwo\nthree"));
+	auto one = reader.ReadLine();
+	auto two = reader.ReadLine();
+	auto three = reader.ReadLine();
+	EXPECT_FALSE(reader.HasMoreLines());
+	EXPECT_EQ("one", one);
+	EXPECT_EQ("two", two);
+	EXPECT_EQ("three", three);
+}
+
+TEST(DISABLED_lagi_mapped_line_reader_bench, subtitle_file) {
+	// A large typeset script: a few styles, then lots of dialogue lines
+	// with override tags
+	std::string contents = "\xEF\xBB\xBF[Script Info]\r\nScriptType: v4.00+\r\nPlayResX: 1920\r\nPlayResY: 1080\r\n\r\n[V4+ Styles]\r\n";
+	for (int i = 0; i < 20; ++i)
+		contents += str(boost::format("Style: Style%d,Arial,60,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0,0,1,2,2,2,10,10,10,1\r\n") % i);
+	contents += "\r\n[Events]\r\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\r\n";
+	const size_t lines = 200000;
+	for (size_t i = 0; i < lines; ++i)
+		contents += str(boost::format("Dialogue: 0,0:%02d:%02d.%02d,0:%02d:%02d.%02d,Style%d,,0,0,0,,{\\pos(%d,%d)\\blur2}Some dialogue text for line %d\r\n")
+			% (i / 6000 % 60) % (i / 100 % 60) % (i % 100) % (i / 6000 % 60) % (i / 100 % 60) % (i % 100)
+			% (i % 20) % (i % 1920) % (i % 1080) % i);
+
+	auto path = write_file(contents);
+	size_t total = 0;
+	util::benchmark("line_iterator (lines)", lines, [&] {
+		agi::read_file_mapping file(path);
+		boost::interprocess::ibufferstream stream(file.read(), file.size());
+		for (auto line : agi::line_iterator<std::string>(stream)) {
+			boost::trim(line);
+			if (boost::starts_with(line, "\xEF\xBB\xBF"))
+				line.erase(0, 3);
+			total += line.size();
+		}
+	});
+	util::benchmark("mapped_line_reader (lines)", lines, [&] {
+		agi::mapped_line_reader reader(path);
+		while (reader.HasMoreLines())
+			total += reader.ReadLine().size();
+	});
+	EXPECT_NE(0u, total);
+}
@@ -17,8 +17,10 @@
 #include <libaegisub/ass/uuencode.h>
 
 #include <main.h>
+#include <util.h>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <cstring>
 
 using namespace agi::ass;
 
@@ -55,3 +57,49 @@ TEST(lagi_uuencode, random_blobs_roundtrip) {
 		data.push_back(rand());
 	}
 }
+
+TEST(lagi_uuencode, encode_in_pieces) {
+	std::vector<char> data(1000);
+	for (auto& c : data) c = rand();
+	auto whole = UUEncode(data.data(), data.data() + data.size());
+
+	for (size_t piece = 3; piece < 300; piece += 3) {
+		std::string encoded = "fontname: a.ttf\r\n";
+		for (size_t pos = 0; pos < data.size(); pos += piece)
+			UUEncode(data.data() + pos, data.data() + std::min(pos + piece, data.size()), encoded);
+		EXPECT_EQ("fontname: a.ttf\r\n" + whole, encoded) << "piece size " << piece;
+	}
+}
+
+TEST(lagi_uuencode, decode_by_line) {
+	std::vector<char> data(1000);
+	for (auto& c : data) c = rand();
+	auto encoded = UUEncode(data.data(), data.data() + data.size());
+
+	std::vector<char> decoded;
+	for (size_t pos = 0; pos < encoded.size(); ) {
+		auto end = std::min(encoded.find('\n', pos), encoded.size() - 1) + 1;
+		UUDecode(encoded.data() + pos, encoded.data() + end, decoded);
+		pos = end;
+	}
+	EXPECT_EQ(data, decoded);
+}
+
+TEST(lagi_uuencode, decode_skips_line_breaks_within_groups) {
+	const char *str = "?(\r\nF[?\n(E";
+	std::vector<char> expected = {120, 121, 122, 120, 121};
+	EXPECT_EQ(expected, UUDecode(str, str + strlen(str)));
+}
+
+TEST(DISABLED_lagi_uuencode_bench, font) {
+	std::vector<char> data(20 * 1024 * 1024);
+	for (auto& c : data) c = rand();
+	std::string encoded;
+
+	util::benchmark("uuencode (bytes)", data.size(), [&] {
+		encoded = UUEncode(data.data(), data.data() + data.size());
+	});
+	util::benchmark("uudecode (bytes)", data.size(), [&] {
+		EXPECT_EQ(data.size(), UUDecode(encoded.data(), encoded.data() + encoded.size()).size());
+	});
+}
@@ -17,9 +17,12 @@
 #include <libaegisub/fs.h>
 #include <libaegisub/vfr.h>
 
+#include <algorithm>
 #include <climits>
 #include <fstream>
 #include <iterator>
+#include <random>
+#include <vector>
 
 #include <main.h>
 #include <util.h>
@@ -767,3 +770,155 @@ TEST(lagi_vfr, from_smpte_ntsc_nodrop) {
 		++f;
 	}
 }
+
+namespace {
+/// Timecodes for frames at each of several frame rates in turn, rounded from
+/// an unrounded running time like a v1 file
+std::vector<int> mixed_timecodes(std::initializer_list<std::pair<int, double>> ranges) {
+	std::vector<int> timecodes;
+	double time = 0;
+	for (auto const& range : ranges) {
+		for (int i = 0; i < range.first; ++i) {
+			timecodes.push_back(int(time + .5));
+			time += 1000. / range.second;
+		}
+	}
+	return timecodes;
+}
+
+/// Timecodes with random gaps between frames
+std::vector<int> irregular_timecodes(size_t count, int max_gap) {
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> gap(0, max_gap);
+	std::vector<int> timecodes(1, 0);
+	while (timecodes.size() < count)
+		timecodes.push_back(timecodes.back() + gap(rng));
+	return timecodes;
+}
+
+/// FrameAtTime(ms, EXACT) as a search of the full list of timecodes
+int table_frame_at_time(std::vector<int> const& timecodes, int ms) {
+	return (int)distance(lower_bound(timecodes.rbegin(), timecodes.rend(), ms, std::greater<int>()), timecodes.rend()) - 1;
+}
+
+void expect_matches_timecodes(std::vector<int> const& timecodes) {
+	Framerate fps(timecodes);
+	for (size_t i = 0; i < timecodes.size(); ++i)
+		ASSERT_EQ(timecodes[i], fps.TimeAtFrame((int)i)) << "frame " << i;
+	for (int ms = 0; ms <= timecodes.back(); ++ms)
+		ASSERT_EQ(table_frame_at_time(timecodes, ms), fps.FrameAtTime(ms)) << "time " << ms;
+}
+}
+
+TEST(lagi_vfr, segments_rounded_cfr) {
+	expect_matches_timecodes(mixed_timecodes({{20000, 24000 / 1001.}}));
+	expect_matches_timecodes(mixed_timecodes({{20000, 30000 / 1001.}}));
+	expect_matches_timecodes(mixed_timecodes({{20000, 25.}}));
+}
+
+TEST(lagi_vfr, segments_mixed_rates) {
+	expect_matches_timecodes(mixed_timecodes({
+		{5000, 24000 / 1001.}, {3000, 30000 / 1001.}, {1000, 120000 / 1001.},
+		{2, 1.}, {5000, 24000 / 1001.}, {17, 60.}, {4000, 30000 / 1001.}}));
+}
+
+TEST(lagi_vfr, segments_irregular) {
+	expect_matches_timecodes(irregular_timecodes(20000, 80));
+	expect_matches_timecodes(irregular_timecodes(20000, 2));
+}
+
+TEST(lagi_vfr, segments_duplicate_timestamps) {
+	auto timecodes = mixed_timecodes({{20000, 24000 / 1001.}});
+	for (size_t i = 500; i < timecodes.size(); i += 500)
+		timecodes.insert(timecodes.begin() + i, timecodes[i]);
+	timecodes.insert(timecodes.end(), 100, timecodes.back());
+	expect_matches_timecodes(timecodes);
+}
+
+TEST(lagi_vfr, segments_save) {
+	auto timecodes = mixed_timecodes({{3000, 24000 / 1001.}, {3000, 30000 / 1001.}});
+	Framerate fps(timecodes);
+	ASSERT_NO_THROW(fps.Save("data/vfr/out/v2_segments.txt", 6100));
+
+	Framerate saved;
+	ASSERT_NO_THROW(saved = Framerate("data/vfr/out/v2_segments.txt"));
+	for (int frame = 0; frame < 6100; ++frame)
+		ASSERT_EQ(fps.TimeAtFrame(frame), saved.TimeAtFrame(frame)) << "frame " << frame;
+}
+
+TEST(lagi_vfr, batch_matches_single) {
+	std::mt19937 rng(0);
+	for (auto const& timecodes : {mixed_timecodes({{3000, 24000 / 1001.}, {3000, 30000 / 1001.}}), irregular_timecodes(3000, 80), std::vector<int>{0, 0, 1, 2, 2, 3}}) {
+		Framerate fps(timecodes);
+		int end = timecodes.back();
+
+		// Ascending, then shuffled, with times and frames past each end
+		std::vector<int> times, frames;
+		for (int ms = -1000; ms < end + 1000; ms += 7)
+			times.push_back(ms);
+		for (int frame = -20; frame < (int)timecodes.size() + 20; ++frame)
+			frames.push_back(frame);
+		for (int pass = 0; pass < 2; ++pass) {
+			for (auto type : {EXACT, START, END}) {
+				std::vector<int> out(times.size());
+				fps.FramesAtTimes(times.data(), out.data(), times.size(), type);
+				for (size_t i = 0; i < times.size(); ++i)
+					ASSERT_EQ(fps.FrameAtTime(times[i], type), out[i]) << "time " << times[i] << " type " << type;
+
+				out.resize(frames.size());
+				fps.TimesAtFrames(frames.data(), out.data(), frames.size(), type);
+				for (size_t i = 0; i < frames.size(); ++i)
+					ASSERT_EQ(fps.TimeAtFrame(frames[i], type), out[i]) << "frame " << frames[i] << " type " << type;
+			}
+			std::shuffle(times.begin(), times.end(), rng);
+			std::shuffle(frames.begin(), frames.end(), rng);
+		}
+	}
+}
+
+TEST(DISABLED_lagi_vfr_bench, lookups) {
+	// A couple of hours of anime with the usual mix of frame rates, and the
+	// start and end times of a few thousand lines looked up repeatedly as
+	// when retiming a file to a new frame rate
+	auto timecodes = mixed_timecodes({
+		{40000, 24000 / 1001.}, {5000, 30000 / 1001.}, {2000, 120000 / 1001.},
+		{60000, 24000 / 1001.}, {10000, 30000 / 1001.}, {60000, 24000 / 1001.}});
+	Framerate fps(timecodes);
+
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> time(0, timecodes.back());
+	std::vector<int> times(200000);
+	for (auto& t : times) t = time(rng);
+	std::sort(times.begin(), times.end());
+	std::vector<int> frames(times.size()), out(times.size());
+	for (size_t i = 0; i < times.size(); ++i)
+		frames[i] = fps.FrameAtTime(times[i]);
+
+	benchmark("timecode table FrameAtTime (lookups)", times.size(), [&] {
+		for (size_t i = 0; i < times.size(); ++i)
+			out[i] = table_frame_at_time(timecodes, times[i]);
+	});
+	benchmark("FrameAtTime (lookups)", times.size(), [&] {
+		for (size_t i = 0; i < times.size(); ++i)
+			out[i] = fps.FrameAtTime(times[i]);
+	});
+	benchmark("FramesAtTimes (lookups)", times.size(), [&] {
+		fps.FramesAtTimes(times.data(), out.data(), times.size());
+	});
+	benchmark("TimeAtFrame START (lookups)", frames.size(), [&] {
+		for (size_t i = 0; i < frames.size(); ++i)
+			out[i] = fps.TimeAtFrame(frames[i], START);
+	});
+	benchmark("TimesAtFrames START (lookups)", frames.size(), [&] {
+		fps.TimesAtFrames(frames.data(), out.data(), frames.size(), START);
+	});
+
+	Framerate irregular(irregular_timecodes(timecodes.size(), 80));
+	benchmark("irregular FrameAtTime (lookups)", times.size(), [&] {
+		for (size_t i = 0; i < times.size(); ++i)
+			out[i] = irregular.FrameAtTime(times[i]);
+	});
+	benchmark("irregular FramesAtTimes (lookups)", times.size(), [&] {
+		irregular.FramesAtTimes(times.data(), out.data(), times.size());
+	});
+}
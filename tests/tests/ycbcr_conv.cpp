@@ -0,0 +1,264 @@
+// Copyright (c) 2026, agent <agent@local>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <libaegisub/ycbcr_conv.h>
+
+#include <main.h>
+#include <util.h>
+
+#include <random>
+#include <vector>
+
+using namespace agi;
+
+namespace {
+/// A planar image, with chroma planes of (width >> shift_x) by (height >> shift_y)
+/// rounded up
+struct Image {
+	std::vector<uint8_t> planes[3];
+	ycbcr_planar_image img;
+
+	Image(int width, int height, int shift_x, int shift_y, int bit_depth) {
+		int sample_sz = bit_depth > 8 ? 2 : 1;
+		int chroma_w = (width + (1 << shift_x) - 1) >> shift_x;
+		int chroma_h = (height + (1 << shift_y) - 1) >> shift_y;
+		planes[0].resize(width * height * sample_sz);
+		planes[1].resize(chroma_w * chroma_h * sample_sz);
+		planes[2].resize(chroma_w * chroma_h * sample_sz);
+
+		for (int i = 0; i < 3; ++i)
+			img.planes[i] = planes[i].data();
+		img.strides[0] = width * sample_sz;
+		img.strides[1] = img.strides[2] = chroma_w * sample_sz;
+		img.width = width;
+		img.height = height;
+		img.chroma_shift_x = shift_x;
+		img.chroma_shift_y = shift_y;
+		img.bit_depth = bit_depth;
+	}
+
+	void Set(int plane, int x, int y, int value) {
+		if (img.bit_depth == 8)
+			planes[plane][y * img.strides[plane] + x] = static_cast<uint8_t>(value);
+		else {
+			planes[plane][y * img.strides[plane] + x * 2] = static_cast<uint8_t>(value);
+			planes[plane][y * img.strides[plane] + x * 2 + 1] = static_cast<uint8_t>(value >> 8);
+		}
+	}
+
+	std::vector<uint8_t> Convert(ycbcr_converter const& conv) const {
+		std::vector<uint8_t> out(img.width * img.height * 4, 0xFF);
+		conv.planar_to_bgrx(img, out.data(), img.width * 4);
+		return out;
+	}
+};
+
+const ycbcr_matrix matrices[] = {ycbcr_matrix::bt601, ycbcr_matrix::bt709, ycbcr_matrix::fcc, ycbcr_matrix::smpte_240m};
+const ycbcr_range ranges[] = {ycbcr_range::tv, ycbcr_range::pc};
+}
+
+TEST(lagi_ycbcr_conv, matches_per_pixel_conversion) {
+	// Every luma value along each row, and a spread of chroma values
+	const int width = 256, height = 52 * 52;
+	for (int bit_depth : {8, 10, 16}) {
+		Image image(width, height, 0, 0, bit_depth);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				image.Set(0, x, y, x << (bit_depth - 8));
+				image.Set(1, x, y, y / 52 * 5 << (bit_depth - 8));
+				image.Set(2, x, y, y % 52 * 5 << (bit_depth - 8));
+			}
+		}
+
+		for (auto matrix : matrices) {
+			for (auto range : ranges) {
+				ycbcr_converter conv(matrix, range);
+				auto out = image.Convert(conv);
+				for (int y = 0; y < height; ++y) {
+					for (int x = 0; x < width; ++x) {
+						auto rgb = conv.ycbcr_to_rgb({{(uint8_t)x, (uint8_t)(y / 52 * 5), (uint8_t)(y % 52 * 5)}});
+						const uint8_t *pixel = &out[(y * width + x) * 4];
+						for (int c = 0; c < 3; ++c)
+							ASSERT_NEAR(rgb[2 - c], pixel[c], 1) << "bit depth " << bit_depth << " pixel " << x << "," << y;
+						ASSERT_EQ(0, pixel[3]);
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(lagi_ycbcr_conv, chroma_subsampling) {
+	ycbcr_converter conv(ycbcr_matrix::bt709, ycbcr_range::tv);
+	for (int shift_x = 0; shift_x < 3; ++shift_x) {
+		for (int shift_y = 0; shift_y < 2; ++shift_y) {
+			// Odd sizes, so that the last chroma sample covers a partial block
+			const int width = 7, height = 5;
+			Image image(width, height, shift_x, shift_y, 8);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x)
+					image.Set(0, x, y, 16 + x * 30);
+			}
+			for (int y = 0; y <= (height - 1) >> shift_y; ++y) {
+				for (int x = 0; x <= (width - 1) >> shift_x; ++x) {
+					image.Set(1, x, y, 40 + x * 40);
+					image.Set(2, x, y, 200 - y * 40);
+				}
+			}
+
+			auto out = image.Convert(conv);
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x) {
+					auto cx = x >> shift_x, cy = y >> shift_y;
+					auto rgb = conv.ycbcr_to_rgb({{(uint8_t)(16 + x * 30), (uint8_t)(40 + cx * 40), (uint8_t)(200 - cy * 40)}});
+					for (int c = 0; c < 3; ++c)
+						ASSERT_NEAR(rgb[2 - c], out[(y * width + x) * 4 + c], 1) << shift_x << "," << shift_y << " pixel " << x << "," << y;
+				}
+			}
+		}
+	}
+}
+
+TEST(lagi_ycbcr_conv, odd_widths) {
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> sample(0, 1023);
+	ycbcr_converter conv(ycbcr_matrix::bt601, ycbcr_range::tv);
+
+	// Widths which leave a remainder for each vector size. Converting one
+	// pixel at a time always uses the scalar version, so this also checks that
+	// the SIMD versions give exactly the same results.
+	for (int width = 1; width < 40; ++width) {
+		const int height = 3;
+		Image image(width, height, 0, 0, 10);
+		for (int p = 0; p < 3; ++p) {
+			for (int y = 0; y < height; ++y) {
+				for (int x = 0; x < width; ++x)
+					image.Set(p, x, y, sample(rng));
+			}
+		}
+		auto out = image.Convert(conv);
+
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				auto pixel = image;
+				for (int p = 0; p < 3; ++p)
+					pixel.img.planes[p] = &image.planes[p][y * image.img.strides[p] + x * 2];
+				pixel.img.width = pixel.img.height = 1;
+
+				uint8_t expected[4];
+				conv.planar_to_bgrx(pixel.img, expected, 4);
+				ASSERT_TRUE(std::equal(expected, expected + 4, &out[(y * width + x) * 4])) << "width " << width << " pixel " << x << "," << y;
+			}
+		}
+	}
+}
+
+TEST(lagi_ycbcr_conv, zero_stride) {
+	// Grayscale, with a single row of neutral chroma used for every row
+	ycbcr_converter conv(ycbcr_matrix::bt601, ycbcr_range::pc);
+	std::vector<uint8_t> luma = {0, 64, 128, 255, 10, 20, 30, 40};
+	std::vector<uint8_t> chroma(4, 128);
+
+	ycbcr_planar_image img;
+	img.planes[0] = luma.data();
+	img.planes[1] = img.planes[2] = chroma.data();
+	img.strides[0] = 4;
+	img.strides[1] = img.strides[2] = 0;
+	img.width = 4;
+	img.height = 2;
+	img.chroma_shift_x = img.chroma_shift_y = 0;
+	img.bit_depth = 8;
+
+	std::vector<uint8_t> out(4 * 2 * 4);
+	conv.planar_to_bgrx(img, out.data(), 16);
+	for (size_t i = 0; i < luma.size(); ++i) {
+		EXPECT_EQ(luma[i], out[i * 4]);
+		EXPECT_EQ(luma[i], out[i * 4 + 1]);
+		EXPECT_EQ(luma[i], out[i * 4 + 2]);
+	}
+}
+
+TEST(lagi_ycbcr_conv, large_images) {
+	// Big enough to be split between threads, with each row different
+	const int width = 1920, height = 1080;
+	Image image(width, height, 1, 1, 8);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x)
+			image.Set(0, x, y, (x + y) & 0xFF);
+	}
+	for (int y = 0; y < height / 2; ++y) {
+		for (int x = 0; x < width / 2; ++x) {
+			image.Set(1, x, y, x & 0xFF);
+			image.Set(2, x, y, y & 0xFF);
+		}
+	}
+
+	ycbcr_converter conv(ycbcr_matrix::bt709, ycbcr_range::tv);
+	auto out = image.Convert(conv);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			auto rgb = conv.ycbcr_to_rgb({{(uint8_t)(x + y), (uint8_t)(x / 2), (uint8_t)(y / 2)}});
+			for (int c = 0; c < 3; ++c)
+				ASSERT_NEAR(rgb[2 - c], out[(y * width + x) * 4 + c], 1) << "pixel " << x << "," << y;
+		}
+	}
+}
+
+TEST(DISABLED_lagi_ycbcr_conv_bench, frames) {
+	std::mt19937 rng(0);
+	ycbcr_converter conv(ycbcr_matrix::bt709, ycbcr_range::tv);
+
+	struct Size { const char *name; int width, height; };
+	for (auto size : {Size{"1080p", 1920, 1080}, Size{"4K", 3840, 2160}}) {
+		Image image(size.width, size.height, 1, 1, 8);
+		for (auto& plane : image.planes) {
+			for (auto& s : plane) s = (uint8_t)rng();
+		}
+		std::vector<uint8_t> out(size.width * size.height * 4);
+		size_t pixels = size.width * size.height;
+
+		// How YUV4MPEGVideoProvider converted frames before planar_to_bgrx
+		util::benchmark((std::string(size.name) + " 4:2:0 per pixel (pixels)").c_str(), pixels, [&] {
+			uint8_t *dst = out.data();
+			for (int y = 0; y < size.height; ++y) {
+				const uint8_t *src_y = &image.planes[0][y * size.width];
+				const uint8_t *src_u = &image.planes[1][y / 2 * image.img.strides[1]];
+				const uint8_t *src_v = &image.planes[2][y / 2 * image.img.strides[2]];
+				for (int x = 0; x < size.width; ++x) {
+					auto rgb = conv.ycbcr_to_rgb({{src_y[x], src_u[x / 2], src_v[x / 2]}});
+					*dst++ = rgb[2];
+					*dst++ = rgb[1];
+					*dst++ = rgb[0];
+					*dst++ = 0;
+				}
+			}
+		});
+		util::benchmark((std::string(size.name) + " 4:2:0 8-bit (pixels)").c_str(), pixels, [&] {
+			conv.planar_to_bgrx(image.img, out.data(), size.width * 4);
+		});
+
+		Image deep(size.width, size.height, 1, 1, 10);
+		for (auto& plane : deep.planes) {
+			for (size_t i = 0; i < plane.size(); i += 2) {
+				plane[i] = (uint8_t)rng();
+				plane[i + 1] = (uint8_t)(rng() & 3);
+			}
+		}
+		util::benchmark((std::string(size.name) + " 4:2:0 10-bit (pixels)").c_str(), pixels, [&] {
+			conv.planar_to_bgrx(deep.img, out.data(), size.width * 4);
+		});
+	}
+}